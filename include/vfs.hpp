@@ -6,3 +6,10 @@
 #include "vfs/shared_memory.hpp"
 #include "vfs/directory.hpp"
 #include "vfs/watcher.hpp"
+#include "vfs/group_commit.hpp"
+#include "vfs/transfer.hpp"
+#if VFS_PLATFORM_POSIX
+#   include "vfs/shm_ring.hpp"
+#   include "vfs/mirrored_view.hpp"
+#   include "vfs/reactor.hpp"
+#endif
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include "vfs/file_flags.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Pipes tell how many bytes can be read without blocking.
+    template<typename _Stream, typename = void>
+    struct has_available_bytes : std::false_type {};
+
+    template<typename _Stream>
+    struct has_available_bytes<_Stream, std::void_t<decltype(std::declval<_Stream&>().availableBytesToRead())>> : std::true_type {};
+
+    template<typename _Stream>
+    inline constexpr auto has_available_bytes_v = has_available_bytes<_Stream>::value;
+
+    //----------------------------------------------------------------------------------------------
+    // Files can be read and written at an offset, leaving the cursor alone, and move their cursor.
+    template<typename _Stream, typename = void>
+    struct is_positional_stream : std::false_type {};
+
+    template<typename _Stream>
+    struct is_positional_stream<_Stream, std::void_t<decltype(std::declval<_Stream&>().readAt(int64_t(0), std::declval<uint8_t*>(), int64_t(0)))>> : std::true_type {};
+
+    template<typename _Stream>
+    inline constexpr auto is_positional_stream_v = is_positional_stream<_Stream>::value;
+
+    //
+    // Adds read-ahead and write-behind buffering to any stream implementation (file, pipe...).
+    // Small writes are coalesced in memory and only reach the underlying stream when the buffer
+    // is full or when flush() is called, reads are served from a buffer refilled in large chunks.
+    // The write buffer is flushed on destruction, call flush() explicitly whenever the peer
+    // needs to see the data (e.g. before waiting for an answer on a pipe).
+    //
+    template<typename _StreamImpl>
+    class buffered_stream
+        : public _StreamImpl
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using base_type = _StreamImpl;
+        using self_type = buffered_stream<_StreamImpl>;
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto default_buffer_size = int64_t(64 * 1024);
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Forward all other construction parameters to the implementation
+        template<typename... _Args>
+        buffered_stream(int64_t bufferSize, _Args &&...args)
+            : base_type(std::forward<_Args>(args)...)
+            , bufferSize_(std::max(bufferSize, int64_t(1)))
+            , readPosition_(0)
+            , readEnd_(0)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        ~buffered_stream()
+        {
+            if (base_type::isValid())
+            {
+                flush();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        buffered_stream(const buffered_stream &)                = delete;
+        buffered_stream& operator =(const buffered_stream &)    = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        int64_t bufferSize() const
+        {
+            return bufferSize_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Writes the pending bytes to the underlying stream.
+        bool flush()
+        {
+            if (writeBuffer_.empty())
+            {
+                return true;
+            }
+
+            const auto sizeInBytes  = int64_t(writeBuffer_.size());
+            const auto bytesWritten = writeAll(writeBuffer_.data(), sizeInBytes);
+            writeBuffer_.erase(writeBuffer_.begin(), writeBuffer_.begin() + bytesWritten);
+            return bytesWritten == sizeInBytes;
+        }
+        //------------------------------------------------------------------------------------------
+        // Writes the pending bytes, then flushes the range of the underlying file.
+        bool flush(int64_t offset, int64_t sizeInBytes, flush_mode mode)
+        {
+            static_assert(is_positional_stream_v<base_type>, "Only files flush a range");
+            return flush() && base_type::flush(offset, sizeInBytes, mode);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Moves the cursor of seekable streams, staying inside the read buffer when possible.
+        bool skip(int64_t offset)
+        {
+            if (!flush())
+            {
+                return false;
+            }
+
+            const auto newReadPosition = readPosition_ + offset;
+            if (newReadPosition >= 0 && newReadPosition <= readEnd_)
+            {
+                readPosition_ = newReadPosition;
+                return true;
+            }
+
+            discardReadBuffer();
+            return base_type::skip(offset);
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t read(uint8_t *dst, int64_t sizeInBytes)
+        {
+            // Make sure a reader of the same file sees what was written before.
+            if (!flush())
+            {
+                return 0;
+            }
+
+            auto totalBytesRead = consumeReadBuffer(dst, sizeInBytes);
+
+            while (totalBytesRead < sizeInBytes)
+            {
+                const auto remainingBytes = sizeInBytes - totalBytesRead;
+
+                if (remainingBytes >= bufferSize_)
+                {
+                    // Big enough to skip the intermediate copy.
+                    const auto bytesRead = base_type::read(dst + totalBytesRead, remainingBytes);
+                    if (bytesRead <= 0)
+                    {
+                        break;
+                    }
+                    totalBytesRead += bytesRead;
+                    continue;
+                }
+
+                if (!refillReadBuffer(remainingBytes))
+                {
+                    break;
+                }
+                totalBytesRead += consumeReadBuffer(dst + totalBytesRead, remainingBytes);
+            }
+
+            return totalBytesRead;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t write(const uint8_t *src, int64_t sizeInBytes)
+        {
+            discardReadBuffer();
+
+            if (writeBuffer_.capacity() == 0)
+            {
+                writeBuffer_.reserve(bufferSize_);
+            }
+
+            if (int64_t(writeBuffer_.size()) + sizeInBytes <= bufferSize_)
+            {
+                writeBuffer_.insert(writeBuffer_.end(), src, src + sizeInBytes);
+                return sizeInBytes;
+            }
+
+            if (!flush())
+            {
+                return 0;
+            }
+
+            if (sizeInBytes >= bufferSize_)
+            {
+                // Would fill the buffer by itself, write it through.
+                return writeAll(src, sizeInBytes);
+            }
+
+            writeBuffer_.insert(writeBuffer_.end(), src, src + sizeInBytes);
+            return sizeInBytes;
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Positional reads see the pending writes, the read buffer and the cursor are left alone.
+        int64_t readAt(int64_t offset, uint8_t *dst, int64_t sizeInBytes)
+        {
+            static_assert(is_positional_stream_v<base_type>, "Only streams with positional reads and writes, such as files");
+            return flush() ? base_type::readAt(offset, dst, sizeInBytes) : 0;
+        }
+        //------------------------------------------------------------------------------------------
+        int64_t readvAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            static_assert(is_positional_stream_v<base_type>, "Only streams with positional reads and writes, such as files");
+            return flush() ? base_type::readvAt(offset, buffers, bufferCount) : 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Positional writes go after the pending ones and may overwrite what was read ahead.
+        int64_t writeAt(int64_t offset, const uint8_t *src, int64_t sizeInBytes)
+        {
+            static_assert(is_positional_stream_v<base_type>, "Only streams with positional reads and writes, such as files");
+            discardReadBuffer();
+            return flush() ? base_type::writeAt(offset, src, sizeInBytes) : 0;
+        }
+        //------------------------------------------------------------------------------------------
+        int64_t writevAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            static_assert(is_positional_stream_v<base_type>, "Only streams with positional reads and writes, such as files");
+            discardReadBuffer();
+            return flush() ? base_type::writevAt(offset, buffers, bufferCount) : 0;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        int64_t writeAll(const uint8_t *src, int64_t sizeInBytes)
+        {
+            auto totalBytesWritten = int64_t(0);
+            while (totalBytesWritten < sizeInBytes)
+            {
+                const auto bytesWritten = base_type::write(src + totalBytesWritten, sizeInBytes - totalBytesWritten);
+                if (bytesWritten <= 0)
+                {
+                    break;
+                }
+                totalBytesWritten += bytesWritten;
+            }
+            return totalBytesWritten;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t consumeReadBuffer(uint8_t *dst, int64_t sizeInBytes)
+        {
+            const auto count = std::min(sizeInBytes, readEnd_ - readPosition_);
+            if (count > 0)
+            {
+                memcpy(dst, readBuffer_.data() + readPosition_, count);
+                readPosition_ += count;
+            }
+            return count;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool refillReadBuffer(int64_t neededBytes)
+        {
+            auto refillSize = bufferSize_;
+
+            if constexpr (has_available_bytes_v<base_type>)
+            {
+                // Pipes block until the whole requested size arrives, only read ahead what is already there.
+                const auto availableBytes = base_type::availableBytesToRead();
+                refillSize = std::clamp(availableBytes, neededBytes, bufferSize_);
+            }
+
+            readBuffer_.resize(bufferSize_);
+            const auto bytesRead = base_type::read(readBuffer_.data(), refillSize);
+
+            readPosition_   = 0;
+            readEnd_        = std::max(bytesRead, int64_t(0));
+            return readEnd_ > 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void discardReadBuffer()
+        {
+            const auto unconsumedBytes = readEnd_ - readPosition_;
+
+            if constexpr (is_positional_stream_v<base_type>)
+            {
+                // The underlying cursor went past what the caller consumed, bring it back.
+                if (unconsumedBytes > 0)
+                {
+                    base_type::skip(-unconsumedBytes);
+                }
+            }
+
+            readPosition_ = readEnd_ = 0;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        int64_t                 bufferSize_;
+        std::vector<uint8_t>    writeBuffer_;
+        std::vector<uint8_t>    readBuffer_;
+        int64_t                 readPosition_;
+        int64_t                 readEnd_;
+    };
+
+} /*vfs*/
@@ -73,6 +73,30 @@ namespace vfs {
         return true;
     }
 
+    //----------------------------------------------------------------------------------------------
+    // Returns the files below dirPath accepted by filter(const directory_entry &), the order is not
+    // deterministic. The filter also sees the directories, rejecting one skips its whole subtree.
+    template<typename _Filter>
+    inline std::vector<path> find_files(const path &dirPath, _Filter &&filter, const scan_options &options = {})
+    {
+        auto filesPerWorker = std::vector<std::vector<path>>(directory_scanner::worker_count(options));
+
+        directory::parallel_scan(dirPath, std::forward<_Filter>(filter), [&filesPerWorker](const directory_entry &entry, path &entryPath)
+        {
+            if (entry.type == entry_type::file)
+            {
+                filesPerWorker[entry.workerIndex].emplace_back(std::move(entryPath));
+            }
+        }, options);
+
+        auto files = std::move(filesPerWorker[0]);
+        for (auto i = size_t(1); i < filesPerWorker.size(); ++i)
+        {
+            files.insert(files.end(), std::make_move_iterator(filesPerWorker[i].begin()), std::make_move_iterator(filesPerWorker[i].end()));
+        }
+        return files;
+    }
+
     //----------------------------------------------------------------------------------------------
     inline bool delete_directory(const path &dirPath, bool recursivelyDeleteFiles = false)
     {
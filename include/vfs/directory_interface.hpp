@@ -3,6 +3,8 @@
 #include <vector>
 
 #include "vfs/path.hpp"
+#include "vfs/directory_scanner.hpp"
+#include "vfs/directory_snapshot.hpp"
 
 
 namespace vfs {
@@ -70,6 +72,34 @@ namespace vfs {
             }
         }
 
+        //------------------------------------------------------------------------------------------
+        // Scans the whole tree below dirPath with a pool of threads, see directory_scanner::scan().
+        // filter(entry) and visitor(entry, entryPath) are called concurrently from the workers.
+        template<typename _Filter, typename _Visitor>
+        static void parallel_scan(const path &dirPath, _Filter &&filter, _Visitor &&visitor, const scan_options &options = {})
+        {
+            auto scanner = directory_scanner(options);
+            scanner.scan
+            (
+                dirPath,
+                [](const path &p, auto &&callback) { return base_type::read_entries(p, callback); },
+                std::forward<_Filter>(filter),
+                std::forward<_Visitor>(visitor)
+            );
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Compact alternative to scan() for big trees, see directory_snapshot.
+        static directory_snapshot snapshot(const path &dirPath, int32_t recurseToDepth = std::numeric_limits<int32_t>::max())
+        {
+            return directory_snapshot::build
+            (
+                dirPath,
+                [](const path &p, auto &&callback) { return base_type::read_entries_with_stats(p, callback); },
+                recurseToDepth
+            );
+        }
+
     private:
         path                    path_;
         std::vector<self_type>  subDirectories_;
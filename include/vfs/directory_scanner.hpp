@@ -0,0 +1,297 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <condition_variable>
+#include <limits>
+#include <algorithm>
+
+#include "vfs/path.hpp"
+#include "vfs/file_flags.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Entry handed to the filter and the visitor of a parallel scan.
+    // name and parentPath are only valid during the call.
+    struct directory_entry
+    {
+        const path              &parentPath;
+        path::string_view_type  name;
+        entry_type              type;
+        // 0 for the entries of the scanned directory.
+        int32_t                 depth;
+        // In [0, directory_scanner::worker_count(options)), lets visitors keep per thread results
+        // without locking.
+        int32_t                 workerIndex;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    struct scan_options
+    {
+        // Same meaning as in directory::scan(), 0 only lists the entries of the scanned directory.
+        int32_t recurseToDepth  = std::numeric_limits<int32_t>::max();
+        // 0 uses one thread per hardware thread, the calling thread is one of them.
+        int32_t threadCount     = 0;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // Scans a directory tree with a pool of threads.
+    // Each worker owns a queue of directories: subdirectories it finds are pushed to it and it pops
+    // the most recent one (depth first, the parent inode is still hot), idle workers steal the oldest
+    // directory of another queue, which tends to be the biggest subtree left.
+    class directory_scanner
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        explicit directory_scanner(const scan_options &options)
+            : recurseToDepth_(options.recurseToDepth)
+            , queues_(worker_count(options))
+            , pendingCount_(0)
+            , queuedCount_(0)
+            , idleCount_(0)
+            , isAborted_(false)
+        {}
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static int32_t worker_count(const scan_options &options)
+        {
+            if (options.threadCount > 0)
+            {
+                return options.threadCount;
+            }
+            return std::max(int32_t(std::thread::hardware_concurrency()), int32_t(1));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // reader(dirPath, callback) calls callback(name, type) for each entry of dirPath.
+        // filter(entry) is called before anything is allocated for the entry, returning false skips
+        // it and, for a directory, everything below it. visitor(entry, path &entryPath) is then called
+        // for each accepted entry and may keep entryPath by moving it. Both are called concurrently
+        // from all the workers. The first exception thrown by any of them stops the scan, it is
+        // rethrown once every worker has returned.
+        template<typename _Reader, typename _Filter, typename _Visitor>
+        void scan(const path &dirPath, _Reader &&reader, _Filter &&filter, _Visitor &&visitor)
+        {
+            push(0, pending_directory{ dirPath, 0 });
+
+            auto threads = std::vector<std::thread>{};
+            try
+            {
+                for (auto i = 1; i < int32_t(queues_.size()); ++i)
+                {
+                    threads.emplace_back([this, i, &reader, &filter, &visitor]
+                    {
+                        workOrAbort(i, reader, filter, visitor);
+                    });
+                }
+            }
+            catch (...)
+            {
+                abort(std::current_exception());
+            }
+
+            workOrAbort(0, reader, filter, visitor);
+
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+            if (exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        struct pending_directory
+        {
+            path    dirPath;
+            int32_t depth;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Padded so that workers don't share cache lines when locking their own queue.
+        struct alignas(64) worker_queue
+        {
+            std::mutex                      mutex;
+            std::deque<pending_directory>   directories;
+        };
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Exceptions must not escape the thread function nor leave the other threads joinable.
+        template<typename _Reader, typename _Filter, typename _Visitor>
+        void workOrAbort(int32_t workerIndex, _Reader &reader, _Filter &filter, _Visitor &visitor)
+        {
+            try
+            {
+                work(workerIndex, reader, filter, visitor);
+            }
+            catch (...)
+            {
+                abort(std::current_exception());
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Reader, typename _Filter, typename _Visitor>
+        void work(int32_t workerIndex, _Reader &reader, _Filter &filter, _Visitor &visitor)
+        {
+            auto directory = pending_directory{};
+
+            // A directory is only accounted as done once its subdirectories were pushed, so the count
+            // can't drop to 0 while there is still work to steal.
+            while (!isAborted_ && pendingCount_.load(std::memory_order_acquire) > 0)
+            {
+                if (!pop(workerIndex, directory) && !steal(workerIndex, directory))
+                {
+                    waitForWork();
+                    continue;
+                }
+
+                reader(directory.dirPath, [&](path::string_view_type name, entry_type type)
+                {
+                    const auto entry = directory_entry{ directory.dirPath, name, type, directory.depth, workerIndex };
+                    if (!filter(entry))
+                    {
+                        return;
+                    }
+
+                    auto entryPath = path::combine(directory.dirPath, path(path::string_type(name)));
+                    if (type == entry_type::directory && directory.depth < recurseToDepth_)
+                    {
+                        push(workerIndex, pending_directory{ entryPath, directory.depth + 1 });
+                    }
+
+                    visitor(entry, entryPath);
+                });
+
+                if (pendingCount_.fetch_sub(1) == 1)
+                {
+                    // The scan is over, let the idle workers return.
+                    wakeIdleWorkers(true);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Parks the worker until a directory is queued somewhere or the scan is over, a slow
+        // directory read by one worker must not keep the others spinning.
+        void waitForWork()
+        {
+            auto lock = std::unique_lock<std::mutex>(idleMutex_);
+            ++idleCount_;
+            idleCv_.wait(lock, [this] { return queuedCount_ > 0 || pendingCount_ == 0 || isAborted_; });
+            --idleCount_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Keeps the first exception and makes every worker return, the directories left are dropped.
+        void abort(std::exception_ptr exception)
+        {
+            {
+                const auto lock = std::lock_guard<std::mutex>(idleMutex_);
+                if (!exception_)
+                {
+                    exception_ = exception;
+                }
+                isAborted_ = true;
+            }
+            idleCv_.notify_all();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wakeIdleWorkers(bool all)
+        {
+            if (idleCount_ == 0)
+            {
+                return;
+            }
+            // Going through the mutex makes sure a worker that just checked the counts is waiting.
+            {
+                const auto lock = std::lock_guard<std::mutex>(idleMutex_);
+            }
+            if (all)
+            {
+                idleCv_.notify_all();
+            }
+            else
+            {
+                idleCv_.notify_one();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void push(int32_t workerIndex, pending_directory &&directory)
+        {
+            pendingCount_.fetch_add(1, std::memory_order_relaxed);
+
+            {
+                auto &queue = queues_[workerIndex];
+                const auto lock = std::lock_guard<std::mutex>(queue.mutex);
+                queue.directories.emplace_back(std::move(directory));
+            }
+            ++queuedCount_;
+            wakeIdleWorkers(false);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool pop(int32_t workerIndex, pending_directory &directory)
+        {
+            auto &queue = queues_[workerIndex];
+            const auto lock = std::lock_guard<std::mutex>(queue.mutex);
+            if (queue.directories.empty())
+            {
+                return false;
+            }
+            directory = std::move(queue.directories.back());
+            queue.directories.pop_back();
+            --queuedCount_;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool steal(int32_t workerIndex, pending_directory &directory)
+        {
+            const auto workerCount = int32_t(queues_.size());
+            for (auto i = 1; i < workerCount; ++i)
+            {
+                auto &queue = queues_[(workerIndex + i) % workerCount];
+                const auto lock = std::unique_lock<std::mutex>(queue.mutex, std::try_to_lock);
+                if (!lock.owns_lock() || queue.directories.empty())
+                {
+                    continue;
+                }
+                directory = std::move(queue.directories.front());
+                queue.directories.pop_front();
+                --queuedCount_;
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        int32_t                     recurseToDepth_;
+        std::vector<worker_queue>   queues_;
+        std::atomic<int64_t>        pendingCount_;
+        // Directories waiting in the queues and workers waiting for them.
+        std::atomic<int64_t>        queuedCount_;
+        std::atomic<int32_t>        idleCount_;
+        std::mutex                  idleMutex_;
+        std::condition_variable     idleCv_;
+        // Set by the first worker an exception escapes from, both are written under idleMutex_.
+        std::atomic<bool>           isAborted_;
+        std::exception_ptr          exception_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <limits>
+
+#include "vfs/path.hpp"
+#include "vfs/file_flags.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Flat picture of a directory tree: one table of fixed size entries plus a single arena holding
+    // all the names, so a tree of millions of entries is two allocations.
+    // Entries are stored in breadth first order and the children of a directory are contiguous,
+    // index 0 is the scanned directory itself and its name is the path it was scanned with.
+    class directory_snapshot
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using char_type = path::string_type::value_type;
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto invalid_index = uint32_t(-1);
+
+        //------------------------------------------------------------------------------------------
+        struct entry
+        {
+            uint32_t    parentIndex;
+            uint32_t    nameOffset;
+            // Children are only known for directories that were read.
+            uint32_t    firstChildIndex;
+            uint32_t    childCount;
+            uint16_t    nameSize;
+            // 0 for the scanned directory.
+            uint16_t    depth;
+            entry_type  type;
+            int64_t     sizeInBytes;
+            // Same unit as file::get_last_write_time().
+            uint64_t    lastWriteTime;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        directory_snapshot() = default;
+
+        //------------------------------------------------------------------------------------------
+        // reader(dirPath, callback) calls callback(name, type, sizeInBytes, lastWriteTime) for each
+        // entry of dirPath. Directories up to recurseToDepth are read, 0 only reads the root.
+        template<typename _Reader>
+        static directory_snapshot build(const path &dirPath, _Reader &&reader, int32_t recurseToDepth)
+        {
+            auto snapshot = directory_snapshot{};
+            snapshot.append(invalid_index, dirPath.str(), entry_type::directory, 0, 0, 0);
+
+            // Reading directories in the order they were appended keeps the table breadth first.
+            for (auto i = uint32_t(0); i < snapshot.entries_.size(); ++i)
+            {
+                const auto current = snapshot.entries_[i];
+                if (current.type != entry_type::directory || current.depth > recurseToDepth)
+                {
+                    continue;
+                }
+
+                const auto firstChildIndex = uint32_t(snapshot.entries_.size());
+                reader(snapshot.fullPath(i), [&](path::string_view_type name, entry_type type, int64_t sizeInBytes, uint64_t lastWriteTime)
+                {
+                    snapshot.append(i, name, type, sizeInBytes, lastWriteTime, current.depth + 1);
+                });
+
+                snapshot.entries_[i].firstChildIndex    = firstChildIndex;
+                snapshot.entries_[i].childCount         = uint32_t(snapshot.entries_.size()) - firstChildIndex;
+            }
+
+            snapshot.entries_.shrink_to_fit();
+            snapshot.names_.shrink_to_fit();
+            return snapshot;
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        size_t size() const
+        {
+            return entries_.size();
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool empty() const
+        {
+            return entries_.empty();
+        }
+
+        //------------------------------------------------------------------------------------------
+        const entry& operator [](uint32_t index) const
+        {
+            return entries_[index];
+        }
+
+        //------------------------------------------------------------------------------------------
+        // All the entries in breadth first order.
+        std::span<const entry> entries() const
+        {
+            return entries_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        std::span<const entry> children(uint32_t index) const
+        {
+            const auto &e = entries_[index];
+            return std::span<const entry>(entries_).subspan(e.firstChildIndex, e.childCount);
+        }
+
+        //------------------------------------------------------------------------------------------
+        path::string_view_type name(uint32_t index) const
+        {
+            const auto &e = entries_[index];
+            return path::string_view_type(names_.data() + e.nameOffset, e.nameSize);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Rebuilds the path of an entry from its ancestors' names.
+        path fullPath(uint32_t index) const
+        {
+            auto ancestors = std::vector<uint32_t>{};
+            for (auto i = index; i != invalid_index; i = entries_[i].parentIndex)
+            {
+                ancestors.push_back(i);
+            }
+
+            auto fullPathStr = path::string_type{};
+            for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+            {
+                if (!fullPathStr.empty() && fullPathStr.back() != path::separator()[0])
+                {
+                    fullPathStr += path::separator();
+                }
+                fullPathStr += name(*it);
+            }
+            return path(fullPathStr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // visitor(index, entry) in breadth first order, which is the table order.
+        template<typename _Visitor>
+        void visit_breadth_first(_Visitor &&visitor) const
+        {
+            for (auto i = uint32_t(0); i < entries_.size(); ++i)
+            {
+                visitor(i, entries_[i]);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // visitor(index, entry) in depth first pre-order, a directory comes before its children.
+        template<typename _Visitor>
+        void visit_depth_first(_Visitor &&visitor) const
+        {
+            if (entries_.empty())
+            {
+                return;
+            }
+
+            auto pending = std::vector<uint32_t>{ 0 };
+            while (!pending.empty())
+            {
+                const auto i = pending.back();
+                pending.pop_back();
+
+                const auto &e = entries_[i];
+                visitor(i, e);
+
+                // Pushed in reverse so that children are visited in table order.
+                for (auto child = e.childCount; child > 0; --child)
+                {
+                    pending.push_back(e.firstChildIndex + child - 1);
+                }
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void append(uint32_t parentIndex, path::string_view_type name, entry_type type, int64_t sizeInBytes, uint64_t lastWriteTime, int32_t depth)
+        {
+            entries_.push_back(entry
+            {
+                parentIndex,
+                uint32_t(names_.size()),
+                0,
+                0,
+                uint16_t(name.size()),
+                uint16_t(depth),
+                type,
+                sizeInBytes,
+                lastWriteTime
+            });
+            names_.insert(names_.end(), name.begin(), name.end());
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        std::vector<entry>      entries_;
+        std::vector<char_type>  names_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
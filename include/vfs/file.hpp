@@ -10,6 +10,7 @@
 #	include "vfs/win_file.hpp"
 #elif VFS_PLATFORM_POSIX
 #   include "vfs/posix_file.hpp"
+#   include "vfs/posix_async_file.hpp"
 #else
 #	error No file implementation defined for the current platform
 #endif
@@ -17,6 +18,7 @@
 #include "vfs/path.hpp"
 #include "vfs/file_flags.hpp"
 #include "vfs/stream_interface.hpp"
+#include "vfs/buffered_stream.hpp"
 
 
 namespace vfs {
@@ -28,6 +30,18 @@ namespace vfs {
     using file_sptr     = std::shared_ptr<file_stream>;
     using file_wptr     = std::weak_ptr<file_stream>;
     //----------------------------------------------------------------------------------------------
+    using buffered_file_stream  = stream_interface<buffered_stream<file>>;
+    using buffered_file_sptr    = std::shared_ptr<buffered_file_stream>;
+    using buffered_file_wptr    = std::weak_ptr<buffered_file_stream>;
+    //----------------------------------------------------------------------------------------------
+#if VFS_PLATFORM_POSIX
+    using async_file        = file_interface<async_file_impl>;
+    using async_file_stream = stream_interface<async_file>;
+    //----------------------------------------------------------------------------------------------
+    using async_file_sptr   = std::shared_ptr<async_file_stream>;
+    using async_file_wptr   = std::weak_ptr<async_file_stream>;
+    //----------------------------------------------------------------------------------------------
+#endif
 
     //----------------------------------------------------------------------------------------------
     inline auto open_read_only
@@ -70,4 +84,35 @@ namespace vfs {
     }
     //----------------------------------------------------------------------------------------------
 
+    //----------------------------------------------------------------------------------------------
+    inline auto open_buffered
+    (
+        const path              &fileName,
+        file_access             fileAccess,
+        file_creation_options   creationOptions,
+        int64_t                 bufferSize = buffered_file_stream::default_buffer_size,
+        file_flags              fileFlags = file_flags::none,
+        file_attributes         fileAttributes = file_attributes::normal
+    )
+    {
+        return buffered_file_sptr(new buffered_file_stream(bufferSize, fileName, fileAccess, creationOptions, fileFlags, fileAttributes));
+    }
+    //----------------------------------------------------------------------------------------------
+
+#if VFS_PLATFORM_POSIX
+    //----------------------------------------------------------------------------------------------
+    inline auto open_async
+    (
+        const path              &fileName,
+        file_access             fileAccess,
+        file_creation_options   creationOptions,
+        file_flags              fileFlags = file_flags::none,
+        file_attributes         fileAttributes = file_attributes::normal
+    )
+    {
+        return async_file_sptr(new async_file_stream(fileName, fileAccess, creationOptions, fileFlags, fileAttributes));
+    }
+    //----------------------------------------------------------------------------------------------
+#endif
+
 } /*vfs*/
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 
 namespace vfs {
@@ -30,6 +31,57 @@ namespace vfs {
         write_through       = 1 << 2
     };
 
+    // Expected access pattern of a file or a view, lets the system tune read-ahead and caching.
+    enum class access_hint : uint32_t
+    {
+        normal,
+        sequential,
+        random,
+        will_need,
+        dont_need,
+        huge_page
+    };
+
+    // Options of a memory mapping, trading a more expensive mapping for cheaper accesses.
+    enum class mapping_flags : uint32_t
+    {
+        none                    = 0,
+        // Fault every page in when mapping instead of on first access.
+        populate                = 1 << 0,
+        // Back shared memory with huge pages, its size is rounded up to the huge page size.
+        huge_pages              = 1 << 1,
+        // Ask for transparent huge pages, the system still decides whether to use them.
+        transparent_huge_pages  = 1 << 2,
+        // Keep the mapping resident, within the limit of locked memory of the process.
+        lock                    = 1 << 3,
+        // Writes past the end of a view of a file extend the file instead of failing, and the
+        // view keeps its address. The file is truncated to what was written when the view closes.
+        growable                = 1 << 4
+    };
+
+    constexpr mapping_flags operator |(mapping_flags lhs, mapping_flags rhs)
+    {
+        return mapping_flags(uint32_t(lhs) | uint32_t(rhs));
+    }
+
+    // How far a flush goes before returning.
+    enum class flush_mode : uint32_t
+    {
+        // Start writing the data back to the storage and return right away.
+        async,
+        // Return once the data is on the storage.
+        sync
+    };
+
+    // Kind of a directory entry, symbolic links are reported as such and never followed.
+    enum class entry_type : uint8_t
+    {
+        file,
+        directory,
+        symlink,
+        other
+    };
+
     enum class file_attributes : uint32_t
     {
         none                = 0,
@@ -51,4 +103,20 @@ namespace vfs {
         duplex,
     };
 
+    // Scatter/gather buffer used by vectored operations.
+    // The layout matches posix struct iovec so arrays of it can be handed directly to the system.
+    struct io_vector
+    {
+        void        *data;
+        size_t      size;
+    };
+
+    // Result of an asynchronous operation.
+    // result is the number of bytes transferred, or a negated error code on failure.
+    struct io_completion
+    {
+        uint64_t    userData;
+        int64_t     result;
+    };
+
 } /*vfs*/
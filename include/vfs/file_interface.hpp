@@ -103,6 +103,72 @@ namespace vfs {
         {
             return base_type::resize(newSize);
         }
+        //------------------------------------------------------------------------------------------
+        // Hints the expected access pattern of a range of the file, a size of 0 means up to the end of the file.
+        bool advise(access_hint hint, int64_t offset = 0, int64_t sizeInBytes = 0)
+        {
+            return base_type::advise(hint, offset, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        // An asynchronous flush starts writing back the range (write-behind), a size of 0 means up
+        // to the end of the file. A synchronous flush makes the data of the whole file durable.
+        bool flush(int64_t offset = 0, int64_t sizeInBytes = 0, flush_mode mode = flush_mode::sync)
+        {
+            return base_type::flush(offset, sizeInBytes, mode);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Positional operations, they don't use nor move the file cursor so many threads can share a single descriptor.
+        int64_t readAt(int64_t offset, uint8_t *dst, int64_t sizeInBytes)
+        {
+            return base_type::readAt(offset, dst, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        int64_t writeAt(int64_t offset, const uint8_t *src, int64_t sizeInBytes)
+        {
+            return base_type::writeAt(offset, src, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        int64_t readvAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            return base_type::readvAt(offset, buffers, bufferCount);
+        }
+        //------------------------------------------------------------------------------------------
+        int64_t writevAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            return base_type::writevAt(offset, buffers, bufferCount);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Asynchronous operations, only available on implementations providing a submission queue.
+        // Requests are queued by readAsync/writeAsync, sent in a single batch by submit() and reaped by complete().
+        // The buffers must stay alive until the matching completion has been reaped.
+        bool readAsync(int64_t offset, uint8_t *dst, int64_t sizeInBytes, uint64_t userData = 0)
+        {
+            return base_type::readAsync(offset, dst, sizeInBytes, userData);
+        }
+        //------------------------------------------------------------------------------------------
+        bool writeAsync(int64_t offset, const uint8_t *src, int64_t sizeInBytes, uint64_t userData = 0)
+        {
+            return base_type::writeAsync(offset, src, sizeInBytes, userData);
+        }
+        //------------------------------------------------------------------------------------------
+        int32_t submit()
+        {
+            return base_type::submit();
+        }
+        //------------------------------------------------------------------------------------------
+        int32_t complete(io_completion *completions, int32_t maxCount, int32_t minCount = 0)
+        {
+            return base_type::complete(completions, maxCount, minCount);
+        }
+        //------------------------------------------------------------------------------------------
+        int32_t inFlightCount() const
+        {
+            return base_type::inFlightCount();
+        }
     };
     //----------------------------------------------------------------------------------------------
 
@@ -46,11 +46,77 @@ namespace vfs {
         file_creation_options   creationOptions,
         file_flags              fileFlags = file_flags::none,
         file_attributes         fileAttributes = file_attributes::normal,
-        int64_t                 viewSize = 0
+        int64_t                 viewSize = 0,
+        mapping_flags           mappingFlags = mapping_flags::none
     )
     {
         auto spFile = open_read_write(fileName, creationOptions, fileFlags, fileAttributes);
-        return spFile->isValid() ? file_view_sptr(new file_view_stream(std::move(spFile), viewSize)) : nullptr;
+        return spFile->isValid() ? file_view_sptr(new file_view_stream(std::move(spFile), viewSize, mappingFlags)) : nullptr;
+    }
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    // Writable view that grows along with the writes, see mapping_flags::growable.
+    inline auto open_growable_view
+    (
+        const path              &fileName,
+        file_creation_options   creationOptions,
+        file_flags              fileFlags = file_flags::none,
+        file_attributes         fileAttributes = file_attributes::normal,
+        mapping_flags           mappingFlags = mapping_flags::none
+    )
+    {
+        return open_read_write_view(fileName, creationOptions, fileFlags, fileAttributes, 0, mappingFlags | mapping_flags::growable);
+    }
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    inline auto open_read_only_window_view
+    (
+        const path              &fileName,
+        file_creation_options   creationOptions,
+        int64_t                 windowSize,
+        bool                    prefetchNextWindow = true,
+        file_flags              fileFlags = file_flags::none,
+        file_attributes         fileAttributes = file_attributes::normal,
+        mapping_flags           mappingFlags = mapping_flags::none
+    )
+    {
+        auto spFile = open_read_only(fileName, creationOptions, fileFlags, fileAttributes);
+        return spFile->isValid() ? file_view_sptr(new file_view_stream(std::move(spFile), 0, windowSize, prefetchNextWindow, mappingFlags)) : nullptr;
+    }
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    inline auto open_read_write_window_view
+    (
+        const path              &fileName,
+        file_creation_options   creationOptions,
+        int64_t                 windowSize,
+        bool                    prefetchNextWindow = true,
+        file_flags              fileFlags = file_flags::none,
+        file_attributes         fileAttributes = file_attributes::normal,
+        int64_t                 viewSize = 0,
+        mapping_flags           mappingFlags = mapping_flags::none
+    )
+    {
+        auto spFile = open_read_write(fileName, creationOptions, fileFlags, fileAttributes);
+        return spFile->isValid() ? file_view_sptr(new file_view_stream(std::move(spFile), viewSize, windowSize, prefetchNextWindow, mappingFlags)) : nullptr;
+    }
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    // Maps a file or shared memory received from another process with pipe_interface::readHandle(),
+    // both processes see the same pages. The view owns the handle, a viewSize of 0 maps everything.
+    inline auto open_view_from_handle
+    (
+        file_view::native_handle    handle,
+        file_access                 fileAccess,
+        int64_t                     viewSize = 0,
+        mapping_flags               mappingFlags = mapping_flags::none
+    )
+    {
+        return file_view_sptr(new file_view_stream(handle, viewSize, fileAccess, mappingFlags));
     }
     //----------------------------------------------------------------------------------------------
 
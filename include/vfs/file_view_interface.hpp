@@ -16,18 +16,38 @@ namespace vfs {
         using base_type = _Impl;
         using self_type = file_view_interface<_Impl>;
 
+        //------------------------------------------------------------------------------------------
+        using native_handle = typename base_type::native_handle;
+
     public:
         //------------------------------------------------------------------------------------------
-        file_view_interface(file_sptr spFile, int64_t viewSize)
-            : base_type(std::move(spFile), viewSize)
+        file_view_interface(file_sptr spFile, int64_t viewSize, mapping_flags mappingFlags = mapping_flags::none)
+            : base_type(std::move(spFile), viewSize, mappingFlags)
         {}
         //------------------------------------------------------------------------------------------
         file_view_interface(file_sptr spFile)
             : file_view_interface(std::move(spFile), 0ull)
         {}
         //------------------------------------------------------------------------------------------
-        file_view_interface(const path &name, int64_t size, bool openExisting)
-            : base_type(name, size, openExisting)
+        // Sliding window view: only windowSize bytes are mapped at a time and the mapping follows the cursor,
+        // which bounds the address space used by views over very large files. The mapping flags apply to
+        // every window.
+        file_view_interface(file_sptr spFile, int64_t viewSize, int64_t windowSize, bool prefetchNextWindow, mapping_flags mappingFlags = mapping_flags::none)
+            : base_type(std::move(spFile), viewSize, windowSize, prefetchNextWindow, mappingFlags)
+        {}
+        //------------------------------------------------------------------------------------------
+        file_view_interface(const path &name, int64_t size, bool openExisting, mapping_flags mappingFlags = mapping_flags::none)
+            : base_type(name, size, openExisting, mappingFlags)
+        {}
+        //------------------------------------------------------------------------------------------
+        // Maps an object whose handle was received from another process, the view owns the handle.
+        file_view_interface(native_handle handle, int64_t viewSize, file_access access, mapping_flags mappingFlags = mapping_flags::none)
+            : base_type(handle, viewSize, access, mappingFlags)
+        {}
+        //------------------------------------------------------------------------------------------
+        // Shared memory without a name.
+        file_view_interface(int64_t size, mapping_flags mappingFlags)
+            : base_type(size, mappingFlags)
         {}
 
         //------------------------------------------------------------------------------------------
@@ -42,6 +62,13 @@ namespace vfs {
             return base_type::getFile();
         }
         //------------------------------------------------------------------------------------------
+        // Handle of the mapped file or shared memory, it can be sent to another process with
+        // pipe_interface::writeHandle() and stays owned by the view.
+        native_handle nativeHandle() const
+        {
+            return base_type::nativeHandle();
+        }
+        //------------------------------------------------------------------------------------------
         int64_t totalSize() const
         {
             return base_type::totalSize();
@@ -64,6 +91,19 @@ namespace vfs {
             return base_type::skip(offsetInBytes);
         }
         //------------------------------------------------------------------------------------------
+        // Hints the expected access pattern of a range of the mapping, a size of 0 means the whole mapping.
+        bool advise(access_hint hint, int64_t offset = 0, int64_t sizeInBytes = 0)
+        {
+            return base_type::advise(hint, offset, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        // Writes the modified pages of a range back to the file, a size of 0 means up to the end of the view.
+        // Shared memory has nothing to flush.
+        bool flush(int64_t offset = 0, int64_t sizeInBytes = 0, flush_mode mode = flush_mode::async)
+        {
+            return base_type::flush(offset, sizeInBytes, mode);
+        }
+        //------------------------------------------------------------------------------------------
         template<typename T = uint8_t>
         auto cursor()
         {
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <condition_variable>
+
+#include "vfs/file_flags.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Makes the writes of many threads durable with as few synchronous flushes as possible.
+    // A thread calls commit() once its writes are done: if no flush is running it flushes for every
+    // thread that committed so far, otherwise it waits for the running flush to end and the next one
+    // covers all the threads that piled up in the meantime. Under load there is one flush per batch
+    // of commits instead of one per commit.
+    // _Stream is anything with flush(offset, sizeInBytes, flush_mode), a file or a file_view.
+    template<typename _Stream>
+    class group_commit
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        explicit group_commit(std::shared_ptr<_Stream> spStream)
+            : spStream_(std::move(spStream))
+            , requestedCount_(0)
+            , committedCount_(0)
+            , failedCount_(0)
+            , flushCount_(0)
+            , isFlushing_(false)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        group_commit(const group_commit &)              = delete;
+        group_commit& operator =(const group_commit &)  = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Returns once everything the calling thread wrote before is durable, false if the flush
+        // covering it failed.
+        bool commit()
+        {
+            auto lock           = std::unique_lock<std::mutex>(mutex_);
+            const auto ticket   = ++requestedCount_;
+
+            while (true)
+            {
+                // A failed flush may have dropped the dirty pages, a later successful one proves nothing.
+                if (failedCount_ >= ticket)
+                {
+                    return false;
+                }
+                if (committedCount_ >= ticket)
+                {
+                    return true;
+                }
+
+                if (isFlushing_)
+                {
+                    flushed_.wait(lock);
+                    continue;
+                }
+
+                // Flush for every ticket handed out so far.
+                const auto target   = requestedCount_;
+                isFlushing_         = true;
+                ++flushCount_;
+                lock.unlock();
+
+                const auto isFlushed = spStream_->flush(0, 0, flush_mode::sync);
+
+                lock.lock();
+                isFlushing_ = false;
+                if (isFlushed)
+                {
+                    committedCount_ = target;
+                }
+                else
+                {
+                    failedCount_    = target;
+                }
+                flushed_.notify_all();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Number of synchronous flushes issued so far.
+        uint64_t flushCount() const
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            return flushCount_;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        std::shared_ptr<_Stream>    spStream_;
+        mutable std::mutex          mutex_;
+        std::condition_variable     flushed_;
+        uint64_t                    requestedCount_;
+        uint64_t                    committedCount_;
+        uint64_t                    failedCount_;
+        uint64_t                    flushCount_;
+        bool                        isFlushing_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "vfs/platform.hpp"
+
+// Mirrored view interface
+#include "vfs/mirrored_view_interface.hpp"
+#include "vfs/stream_interface.hpp"
+// Platform specific implementations
+#if VFS_PLATFORM_POSIX
+#   include "vfs/posix_mirrored_view.hpp"
+#else
+#	error No mirrored_view implementation defined for the current platform
+#endif
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using mirrored_view         = mirrored_view_interface<mirrored_view_impl>;
+    using mirrored_view_stream  = stream_interface<mirrored_view>;
+    //----------------------------------------------------------------------------------------------
+    using mirrored_view_sptr    = std::shared_ptr<mirrored_view_stream>;
+    using mirrored_view_wptr    = std::weak_ptr<mirrored_view_stream>;
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    inline auto create_mirrored_view(const path &name, int64_t size)
+    {
+        return mirrored_view_sptr(new mirrored_view_stream(name, size));
+    }
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "vfs/path.hpp"
+#include "vfs/file_flags.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Memory of totalSize() bytes mapped twice in a row, so the byte at position i is also at
+    // position i + totalSize(). Any span of up to totalSize() bytes starting in the buffer is
+    // contiguous in memory, records crossing the end of a ring never have to be split.
+    // The cursor wraps around instead of stopping at the end of the view.
+    template<typename _Impl>
+    class mirrored_view_interface
+        : _Impl
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using base_type = _Impl;
+        using self_type = mirrored_view_interface<_Impl>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // The size is rounded up to the page size, the name is only used to identify the memory.
+        mirrored_view_interface(const path &name, int64_t size)
+            : base_type(name, size)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return base_type::isValid();
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t totalSize() const
+        {
+            return base_type::totalSize();
+        }
+        //------------------------------------------------------------------------------------------
+        // Descriptor of the memory, it can be handed to another process to map the same buffer.
+        auto nativeHandle() const
+        {
+            return base_type::nativeHandle();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Both fail without moving the cursor when sizeInBytes is larger than the view.
+        int64_t read(uint8_t *dst, int64_t sizeInBytes)
+        {
+            return base_type::read(dst, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        int64_t write(const uint8_t *src, int64_t sizeInBytes)
+        {
+            return base_type::write(src, sizeInBytes);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool skip(int64_t offsetInBytes)
+        {
+            return base_type::skip(offsetInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        // Address of the byte at the given position, modulo the size of the view.
+        template<typename T = uint8_t>
+        auto data(int64_t position)
+        {
+            return base_type::template data<T>(position);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename T = uint8_t>
+        auto cursor()
+        {
+            return base_type::template cursor<T>();
+        }
+        //------------------------------------------------------------------------------------------
+        uint8_t* cursor()
+        {
+            return cursor<>();
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <type_traits>
 
@@ -17,6 +18,7 @@ namespace vfs {
         //------------------------------------------------------------------------------------------
         // If the system is set to Unicode use wide char otherwise use regular char.
         using string_type       = std::conditional<VFS_USE_UNICODE, std::wstring, std::string>::type;
+        using string_view_type  = std::basic_string_view<string_type::value_type>;
         using converter_type    = string_converter<string_type>;
 
     public:
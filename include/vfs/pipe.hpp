@@ -5,11 +5,13 @@
 
 // Pipe interface
 #include "vfs/pipe_interface.hpp"
+#include "vfs/pipe_server_interface.hpp"
 // Platform specific implementations
 #if VFS_PLATFORM_WIN
 #	include "vfs/win_pipe.hpp"
 #elif VFS_PLATFORM_POSIX
 #   include "vfs/posix_pipe.hpp"
+#   include "vfs/posix_pipe_server.hpp"
 #else
 #	error No pipe implementation defined for the current platform
 #endif
@@ -17,6 +19,7 @@
 #include "vfs/path.hpp"
 #include "vfs/file_flags.hpp"
 #include "vfs/stream_interface.hpp"
+#include "vfs/buffered_stream.hpp"
 
 
 namespace vfs {
@@ -28,6 +31,14 @@ namespace vfs {
     using pipe_sptr     = std::shared_ptr<pipe_stream>;
     using pipe_wptr     = std::weak_ptr<pipe_stream>;
     //----------------------------------------------------------------------------------------------
+    using buffered_pipe_stream  = stream_interface<buffered_stream<pipe>>;
+    using buffered_pipe_sptr    = std::shared_ptr<buffered_pipe_stream>;
+    using buffered_pipe_wptr    = std::weak_ptr<buffered_pipe_stream>;
+    //----------------------------------------------------------------------------------------------
+#if VFS_PLATFORM_POSIX
+    using pipe_server           = pipe_server_interface<pipe_server_impl>;
+#endif
+    //----------------------------------------------------------------------------------------------
     
     //----------------------------------------------------------------------------------------------
     inline auto connect_to_named_pipe
@@ -54,4 +65,32 @@ namespace vfs {
     }
     //----------------------------------------------------------------------------------------------
 
+
+    //----------------------------------------------------------------------------------------------
+    inline auto connect_to_buffered_named_pipe
+    (
+        const path              &pipeName,
+        file_access             fileAccess,
+        int64_t                 bufferSize = buffered_pipe_stream::default_buffer_size,
+        file_flags              fileFlags = file_flags::none,
+        file_attributes         fileAttributes = file_attributes::normal
+    )
+    {
+        return buffered_pipe_sptr(new buffered_pipe_stream(bufferSize, pipeName, fileAccess, fileFlags, fileAttributes));
+    }
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    inline auto create_buffered_named_pipe
+    (
+        const path              &pipeName,
+        pipe_access             pipeAccess,
+        int64_t                 bufferSize = buffered_pipe_stream::default_buffer_size
+    )
+    {
+        return buffered_pipe_sptr(new buffered_pipe_stream(bufferSize, pipeName, pipeAccess));
+    }
+    //----------------------------------------------------------------------------------------------
+
 } /*vfs*/
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <utility>
+
 #include "vfs/path.hpp"
 #include "vfs/file_flags.hpp"
 #include "vfs/stream_interface.hpp"
@@ -47,6 +50,13 @@ namespace vfs {
         {
             return base_type::nativeHandle();
         }
+
+        //------------------------------------------------------------------------------------------
+        // Readable once a client connects, waitForConnection() then returns without blocking.
+        native_handle listeningHandle() const
+        {
+            return base_type::listeningHandle();
+        }
 		//------------------------------------------------------------------------------------------
 		bool isValid()
 		{
@@ -71,6 +81,13 @@ namespace vfs {
         {
             return base_type::availableBytesToRead();
         }
+        //------------------------------------------------------------------------------------------
+        // Bytes message reads received ahead of time, read() returns them before reading the pipe
+        // again. Anything reading the native handle directly must consume them first.
+        int64_t bufferedBytesToRead() const
+        {
+            return base_type::bufferedBytesToRead();
+        }
 
         //------------------------------------------------------------------------------------------
         int64_t read(uint8_t *dst, int64_t sizeInBytes)
@@ -82,6 +99,63 @@ namespace vfs {
         {
             return base_type::write(src, sizeInBytes);
         }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Message mode: each message is sent with its size in front so the reader gets it whole.
+        // Both ends of the pipe must use the message functions.
+        bool writeMessage(const uint8_t *src, int64_t sizeInBytes)
+        {
+            return base_type::writeMessage(src, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        // Sends many messages with as few system calls as possible, returns how many were sent.
+        int64_t writeMessages(const io_vector *messages, int64_t messageCount)
+        {
+            return base_type::writeMessages(messages, messageCount);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Largest message the reads accept, a pipe announcing a larger one is closed before
+        // anything is allocated for it.
+        void setMaxMessageSize(int64_t maxMessageSize)
+        {
+            base_type::setMaxMessageSize(maxMessageSize);
+        }
+        //------------------------------------------------------------------------------------------
+        // Blocks until a message arrives. Returns its size, or -1 if the pipe was closed or the
+        // message is larger than capacity, it then stays in the pipe for a larger buffer.
+        int64_t readMessage(uint8_t *dst, int64_t capacity)
+        {
+            return base_type::readMessage(dst, capacity);
+        }
+        //------------------------------------------------------------------------------------------
+        // Blocks until a message arrives, then calls visitor(const uint8_t *data, int64_t size) for
+        // it and each message already received, up to maxMessageCount. The data is only valid
+        // during the call. Returns the number of messages visited, 0 if the pipe was closed.
+        template<typename _Visitor>
+        int64_t readMessages(_Visitor &&visitor, int64_t maxMessageCount = INT64_MAX)
+        {
+            return base_type::readMessages(std::forward<_Visitor>(visitor), maxMessageCount);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Sends a message along with a handle to a file or shared memory (see file_view::nativeHandle()),
+        // the reader maps the same pages with open_view_from_handle() instead of receiving a copy.
+        // The handle stays owned by the caller.
+        bool writeHandle(native_handle handle, const uint8_t *src = nullptr, int64_t sizeInBytes = 0)
+        {
+            return base_type::writeHandle(handle, src, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        // Reads a message like readMessage(), handle is set to the one sent along with it or to an
+        // invalid handle. The caller owns the handle. The other message reads close the handles
+        // that come with their messages.
+        int64_t readHandle(native_handle &handle, uint8_t *dst = nullptr, int64_t capacity = 0)
+        {
+            return base_type::readHandle(handle, dst, capacity);
+        }
     };
     //----------------------------------------------------------------------------------------------
 
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "vfs/path.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Serves many clients of a named pipe from a single thread instead of one pipe object (and its
+    // thread) per client. Clients talk to it in message mode, see pipe_interface::writeMessage().
+    // Callbacks run on the server thread, they can send messages and disconnect clients but should
+    // not block as every other client waits meanwhile.
+    template<typename _Impl>
+    class pipe_server_interface
+        : _Impl
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using connection_id         = uint64_t;
+        using connect_callback_t    = std::function<void(connection_id)>;
+        using message_callback_t    = std::function<void(connection_id, const uint8_t*, int64_t)>;
+        using disconnect_callback_t = std::function<void(connection_id)>;
+
+        //------------------------------------------------------------------------------------------
+        struct callbacks
+        {
+            connect_callback_t      onConnect;
+            // The message is only valid during the call.
+            message_callback_t      onMessage;
+            disconnect_callback_t   onDisconnect;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        using base_type = _Impl;
+        using self_type = pipe_server_interface<_Impl>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Clients can connect as soon as the server is created, they are accepted once it starts.
+        // Connections announcing a message larger than maxMessageSize are closed before anything
+        // is allocated for it.
+        pipe_server_interface(const path &pipeName, const callbacks &handlers, int64_t maxMessageSize = base_type::default_max_message_size)
+            : base_type(pipeName, handlers.onConnect, handlers.onMessage, handlers.onDisconnect, maxMessageSize)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        ~pipe_server_interface()
+        {
+            stop();
+            wait();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return base_type::isValid();
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool start()
+        {
+            return base_type::start();
+        }
+        //------------------------------------------------------------------------------------------
+        bool stop()
+        {
+            return base_type::stop();
+        }
+        //------------------------------------------------------------------------------------------
+        void wait()
+        {
+            return base_type::wait();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Queues a message for the client, from any thread. What the socket cannot take right away
+        // is sent by the server thread. False if the client is gone.
+        bool send(connection_id id, const uint8_t *src, int64_t sizeInBytes)
+        {
+            return base_type::send(id, src, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        // The disconnect callback is called once the server thread has closed the connection.
+        bool disconnect(connection_id id)
+        {
+            return base_type::disconnect(id);
+        }
+        //------------------------------------------------------------------------------------------
+        size_t connectionCount() const
+        {
+            return base_type::connectionCount();
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
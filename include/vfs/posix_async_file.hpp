@@ -0,0 +1,91 @@
+#pragma once
+
+#include "vfs/platform.hpp"
+#include "vfs/posix_file.hpp"
+#include "vfs/posix_io_ring.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using async_file_impl = class posix_async_file;
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Regular posix_file with an io_uring submission queue attached to it.
+    // Synchronous read/write keep working as usual, readAsync/writeAsync only queue requests which are
+    // sent to the kernel by submit() and reaped by complete(), so a single thread can keep many
+    // operations in flight on the same descriptor.
+    class posix_async_file
+        : public posix_file
+    {
+    protected:
+        //------------------------------------------------------------------------------------------
+        posix_async_file
+        (
+            const path              &name,
+            file_access             access,
+            file_creation_options   creationOption,
+            file_flags              flags,
+            file_attributes         attributes
+        )
+            : posix_file(name, access, creationOption, flags, attributes)
+        {}
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool isUsingIoUring() const
+        {
+            return ring_.isUsingIoUring();
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t inFlightCount() const
+        {
+            return ring_.inFlightCount();
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool readAsync(int64_t offset, uint8_t *dst, int64_t sizeInBytes, uint64_t userData)
+        {
+            vfs_check(isValid());
+            return ring_.prepareRead(nativeHandle(), offset, dst, sizeInBytes, userData);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool writeAsync(int64_t offset, const uint8_t *src, int64_t sizeInBytes, uint64_t userData)
+        {
+            vfs_check(isValid());
+            return ring_.prepareWrite(nativeHandle(), offset, src, sizeInBytes, userData);
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t submit()
+        {
+            return ring_.submit();
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t complete(io_completion *completions, int32_t maxCount, int32_t minCount)
+        {
+            const auto count = ring_.complete(completions, maxCount, minCount);
+
+            for (auto i = 0; i < count; ++i)
+            {
+                if (completions[i].result < 0)
+                {
+                    vfs_errorf("Asynchronous operation on %s failed with error: %s", fileName().c_str(), get_last_error_as_string(int32_t(-completions[i].result)).c_str());
+                }
+            }
+
+            return count;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        posix_io_ring ring_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <dirent.h>
+#include <vector>
 
 #include "vfs/platform.hpp"
 #include "vfs/path.hpp"
+#include "vfs/file_flags.hpp"
 
 
 namespace vfs {
@@ -61,33 +63,126 @@ namespace vfs {
         template<typename _Dir>
         static void scan(const path &dirPath, std::vector<_Dir> &subDirectories, std::vector<path> &files)
         {
-            DIR *pDir = opendir(dirPath.c_str());
-            if (pDir == nullptr)
+            read_entries(dirPath, [&](path::string_view_type name, entry_type type)
             {
-                return;
-            }
+                if (type == entry_type::file)
+                {
+                    files.emplace_back(path::combine(dirPath, path(path::string_type(name))));
+                }
+                else if (type == entry_type::directory)
+                {
+                    subDirectories.emplace_back(path::combine(dirPath, path(path::string_type(name))));
+                }
+            });
+        }
 
-            struct dirent *pEntry = nullptr;
-            while ((pEntry = readdir(pDir)) != nullptr)
+        //------------------------------------------------------------------------------------------
+        // Calls callback(name, type) for every entry of the directory except . and ..
+        // No path is built, names point into the read buffer and are only valid during the call.
+        template<typename _Callback>
+        static bool read_entries(const path &dirPath, _Callback &&callback)
+        {
+            return read_directory(dirPath, [&](int32_t dirFd, const struct dirent64 *pEntry)
             {
-                const auto &currentFilePath = path::combine(dirPath, pEntry->d_name);
+                auto type = pEntry->d_type;
+                if (type == DT_UNKNOWN)
+                {
+                    // Some filesystems don't fill d_type.
+                    struct stat st{};
+                    if (fstatat(dirFd, pEntry->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1)
+                    {
+                        return;
+                    }
+                    type = IFTODT(st.st_mode);
+                }
+
+                callback(path::string_view_type(pEntry->d_name), to_entry_type(type));
+            });
+        }
 
-                if (pEntry->d_type == DT_REG)
+        //------------------------------------------------------------------------------------------
+        // Same as read_entries() with callback(name, type, sizeInBytes, lastWriteTime), the last write
+        // time has the same unit as get_last_write_time(). Costs an additional fstatat() per entry.
+        template<typename _Callback>
+        static bool read_entries_with_stats(const path &dirPath, _Callback &&callback)
+        {
+            return read_directory(dirPath, [&](int32_t dirFd, const struct dirent64 *pEntry)
+            {
+                struct stat st{};
+                if (fstatat(dirFd, pEntry->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1)
                 {
-                    files.emplace_back(std::move(currentFilePath));
+                    // Removed in the meantime.
+                    return;
                 }
-                else if (pEntry->d_type == DT_DIR)
+
+                const auto lastWriteTime = uint64_t(st.st_mtim.tv_sec) * 1000000000ull + uint64_t(st.st_mtim.tv_nsec);
+                callback(path::string_view_type(pEntry->d_name), to_entry_type(IFTODT(st.st_mode)), int64_t(st.st_size), lastWriteTime);
+            });
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto getdents_buffer_size = size_t(256 * 1024);
+
+        //------------------------------------------------------------------------------------------
+        // Calls callback(dirFd, pEntry) for every raw entry except . and ..
+        template<typename _Callback>
+        static bool read_directory(const path &dirPath, _Callback &&callback)
+        {
+            const auto dirFd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dirFd == -1)
+            {
+                return false;
+            }
+
+            // Large enough to get a few thousand entries per system call, one per thread since the
+            // parallel scanner reads many directories at once.
+            thread_local auto buffer = std::vector<uint8_t>(getdents_buffer_size);
+
+            auto success = true;
+            while (true)
+            {
+                const auto bytesRead = getdents64(dirFd, buffer.data(), buffer.size());
+                if (bytesRead <= 0)
                 {
-                    const auto nameLen = strlen(pEntry->d_name);
-                    if (!((nameLen == 1 && pEntry->d_name[0] == '.') ||
-                          (nameLen == 2 && strncmp(pEntry->d_name, "..", 2) == 0)))
+                    if (bytesRead == -1)
                     {
-                        subDirectories.emplace_back(std::move(currentFilePath));
+                        vfs_errorf("getdents64(%s) returned error code: %s", dirPath.c_str(),
+                                   get_last_error_as_string(errno).c_str());
+                        success = false;
                     }
+                    break;
+                }
+
+                for (auto offset = ssize_t(0); offset < bytesRead;)
+                {
+                    const auto *pEntry = reinterpret_cast<const struct dirent64 *>(buffer.data() + offset);
+                    offset += pEntry->d_reclen;
+
+                    const auto name = path::string_view_type(pEntry->d_name);
+                    if (name == "." || name == "..")
+                    {
+                        continue;
+                    }
+
+                    callback(dirFd, pEntry);
                 }
             }
 
-            closedir(pDir);
+            close(dirFd);
+            return success;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static entry_type to_entry_type(uint8_t type)
+        {
+            switch (type)
+            {
+            case DT_REG: return entry_type::file;
+            case DT_DIR: return entry_type::directory;
+            case DT_LNK: return entry_type::symlink;
+            default:     return entry_type::other;
+            }
         }
     };
     //----------------------------------------------------------------------------------------------
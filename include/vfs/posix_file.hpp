@@ -1,7 +1,9 @@
 #pragma once
 
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <stdio.h>
+#include <cstddef>
 
 #include "vfs/platform.hpp"
 #include "vfs/posix_file_flags.hpp"
@@ -15,6 +17,13 @@ namespace vfs {
     using file_impl = class posix_file;
     //----------------------------------------------------------------------------------------------
 
+    //----------------------------------------------------------------------------------------------
+    static_assert(sizeof(io_vector) == sizeof(iovec)
+        && offsetof(io_vector, data) == offsetof(iovec, iov_base)
+        && offsetof(io_vector, size) == offsetof(iovec, iov_len),
+        "io_vector must be layout compatible with iovec.");
+    //----------------------------------------------------------------------------------------------
+
 
     //----------------------------------------------------------------------------------------------
     class posix_file
@@ -93,6 +102,12 @@ namespace vfs {
             if (fileDescriptor_  == -1)
             {
                 vfs_errorf("open(%s) failed with error: %s", fileName_.c_str(), get_last_error_as_string(errno).c_str());
+                return;
+            }
+
+            if (uint32_t(flags) & uint32_t(file_flags::sequential_scan))
+            {
+                advise(access_hint::sequential, 0, 0);
             }
         }
 
@@ -112,10 +127,16 @@ namespace vfs {
         }
         
         //------------------------------------------------------------------------------------------
+        // Nanoseconds since the epoch.
         static uint64_t get_last_write_time(const path &filePath)
         {
-            ///TODO
-            return 0ull;
+            struct stat st{};
+            if (stat(filePath.c_str(), &st) == -1)
+            {
+                return 0ull;
+            }
+
+            return uint64_t(st.st_mtim.tv_sec) * 1000000000ull + uint64_t(st.st_mtim.tv_nsec);
         }
 
         //------------------------------------------------------------------------------------------
@@ -169,6 +190,55 @@ namespace vfs {
             return true;
         }
 
+        //------------------------------------------------------------------------------------------
+        // Tells the kernel how the range will be accessed, a size of 0 extends the range to the end of the file.
+        bool advise(access_hint hint, int64_t offset, int64_t sizeInBytes)
+        {
+            vfs_check(isValid());
+
+            const auto advice = posix_fadvise_advice(hint);
+            if (advice == -1)
+            {
+                // Nothing to do for this hint on a file descriptor.
+                return true;
+            }
+
+            // posix_fadvise() returns the error code instead of setting errno.
+            const auto errorCode = posix_fadvise(fileDescriptor_, offset, sizeInBytes, advice);
+            if (errorCode != 0)
+            {
+                vfs_errorf("posix_fadvise(%s, %ld, %ld, %d) failed with error: %s", fileName_.c_str(), offset, sizeInBytes, advice, get_last_error_as_string(errorCode).c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // sync_file_range() only queues the dirty pages of the range for writeback, durability needs
+        // fdatasync() which has no range.
+        bool flush(int64_t offset, int64_t sizeInBytes, flush_mode mode)
+        {
+            vfs_check(isValid());
+
+            if (mode == flush_mode::async)
+            {
+                if (sync_file_range(fileDescriptor_, offset, sizeInBytes, SYNC_FILE_RANGE_WRITE) == -1)
+                {
+                    vfs_errorf("sync_file_range(%s, %ld, %ld) failed with error: %s", fileName_.c_str(), offset, sizeInBytes, get_last_error_as_string(errno).c_str());
+                    return false;
+                }
+                return true;
+            }
+
+            if (fdatasync(fileDescriptor_) == -1)
+            {
+                vfs_errorf("fdatasync(%s) failed with error: %s", fileName_.c_str(), get_last_error_as_string(errno).c_str());
+                return false;
+            }
+            return true;
+        }
+
         //------------------------------------------------------------------------------------------
         bool skip(int64_t offset)
         {
@@ -217,6 +287,70 @@ namespace vfs {
             return numberOfBytesWritten;
         }
 
+        //------------------------------------------------------------------------------------------
+        int64_t readAt(int64_t offset, uint8_t *dst, int64_t sizeInBytes)
+        {
+            vfs_check(isValid());
+
+            const auto numberOfBytesRead = ::pread64(fileDescriptor_, dst, sizeInBytes, offset);
+
+            if (numberOfBytesRead == -1)
+            {
+                vfs_errorf("::pread64(%s, %ld, %ld) failed with error: %s", fileName_.c_str(), offset, sizeInBytes, get_last_error_as_string(errno).c_str());
+                return 0;
+            }
+
+            return numberOfBytesRead;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t writeAt(int64_t offset, const uint8_t *src, int64_t sizeInBytes)
+        {
+            vfs_check(isValid());
+
+            const auto numberOfBytesWritten = ::pwrite64(fileDescriptor_, src, sizeInBytes, offset);
+
+            if (numberOfBytesWritten == -1)
+            {
+                vfs_errorf("::pwrite64(%s, %ld, %ld) failed with error: %s", fileName_.c_str(), offset, sizeInBytes, get_last_error_as_string(errno).c_str());
+                return 0;
+            }
+
+            return numberOfBytesWritten;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t readvAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            vfs_check(isValid());
+
+            const auto numberOfBytesRead = ::preadv2(fileDescriptor_, reinterpret_cast<const iovec*>(buffers), bufferCount, offset, 0);
+
+            if (numberOfBytesRead == -1)
+            {
+                vfs_errorf("::preadv2(%s, %ld, %d) failed with error: %s", fileName_.c_str(), offset, bufferCount, get_last_error_as_string(errno).c_str());
+                return 0;
+            }
+
+            return numberOfBytesRead;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t writevAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            vfs_check(isValid());
+
+            const auto numberOfBytesWritten = ::pwritev2(fileDescriptor_, reinterpret_cast<const iovec*>(buffers), bufferCount, offset, 0);
+
+            if (numberOfBytesWritten == -1)
+            {
+                vfs_errorf("::pwritev2(%s, %ld, %d) failed with error: %s", fileName_.c_str(), offset, bufferCount, get_last_error_as_string(errno).c_str());
+                return 0;
+            }
+
+            return numberOfBytesWritten;
+        }
+
     private:
        //------------------------------------------------------------------------------------------
         path            fileName_;
@@ -81,8 +81,7 @@ namespace vfs {
             // deleted on close.
             f |= O_TMPFILE;
 
-        if (uint32_t(flags) & uint32_t(file_flags::sequential_scan))
-            // f |= ;
+        // There is no open flag for file_flags::sequential_scan, posix_file applies it with posix_fadvise() once opened.
 
         if (uint32_t(flags) & uint32_t(file_flags::write_through))
             f |= O_DIRECT;
@@ -90,6 +89,42 @@ namespace vfs {
         return f;
     }
 
+    //----------------------------------------------------------------------------------------------
+    // Returns -1 for hints that have no posix_fadvise() equivalent.
+    inline int32_t posix_fadvise_advice(access_hint hint)
+    {
+        switch (hint)
+        {
+            case access_hint::normal:       return POSIX_FADV_NORMAL;
+            case access_hint::sequential:   return POSIX_FADV_SEQUENTIAL;
+            case access_hint::random:       return POSIX_FADV_RANDOM;
+            case access_hint::will_need:    return POSIX_FADV_WILLNEED;
+            case access_hint::dont_need:    return POSIX_FADV_DONTNEED;
+            // Page size of the page cache cannot be chosen per file.
+            case access_hint::huge_page:    return -1;
+        }
+
+        vfs_check(false);
+        return -1;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    inline int32_t posix_madvise_advice(access_hint hint)
+    {
+        switch (hint)
+        {
+            case access_hint::normal:       return MADV_NORMAL;
+            case access_hint::sequential:   return MADV_SEQUENTIAL;
+            case access_hint::random:       return MADV_RANDOM;
+            case access_hint::will_need:    return MADV_WILLNEED;
+            case access_hint::dont_need:    return MADV_DONTNEED;
+            case access_hint::huge_page:    return MADV_HUGEPAGE;
+        }
+
+        vfs_check(false);
+        return MADV_NORMAL;
+    }
+
     //----------------------------------------------------------------------------------------------
     inline uint64_t posix_file_attributes(file_attributes attributes)
     {
@@ -1,15 +1,19 @@
 #pragma once
 
 #include <cstring>
+#include <algorithm>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <limits.h>
+#include <mntent.h>
+#include <sys/vfs.h>
 
 #include "vfs/platform.hpp"
 #include "vfs/posix_file_flags.hpp"
+#include "vfs/posix_virtual_allocator.hpp"
 
 
 namespace vfs {
@@ -22,9 +26,19 @@ namespace vfs {
     //----------------------------------------------------------------------------------------------
     class posix_file_view
     {
+    protected:
+        //------------------------------------------------------------------------------------------
+        using native_handle = int32_t;
+
 	protected:
 		//------------------------------------------------------------------------------------------
-        posix_file_view(file_sptr spFile, int64_t viewSize)
+        posix_file_view(file_sptr spFile, int64_t viewSize, mapping_flags mappingFlags)
+            : posix_file_view(std::move(spFile), viewSize, 0, false, mappingFlags)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // A non zero windowSize only maps a window of that size at a time, the window slides along with the cursor.
+        posix_file_view(file_sptr spFile, int64_t viewSize, int64_t windowSize, bool prefetchNextWindow, mapping_flags mappingFlags = mapping_flags::none)
             : spFile_(spFile)
             , sharedMemory_(false)
             , name_(spFile->fileName())
@@ -33,13 +47,59 @@ namespace vfs {
             , pCursor_(nullptr)
             , fileTotalSize_(0)
             , mappedTotalSize_(0)
+            , windowSize_(round_up_to_page_size(windowSize))
+            , windowOffset_(0)
+            , viewTotalSize_(0)
+            , protection_(PROT_NONE)
+            , windowHint_(access_hint::normal)
+            , prefetchNextWindow_(prefetchNextWindow)
+            , mappingFlags_(mappingFlags)
+            , reservedSize_(0)
+            , usedSize_(0)
         {
 			vfs_check(spFile->isValid());
             map(viewSize, false, spFile->fileAccess());
         }
 
         //------------------------------------------------------------------------------------------
-        posix_file_view(const path &name, int64_t size, bool openExisting)
+        // Maps an object opened by another process and sent over a pipe, see posix_pipe::readHandle().
+        // The view owns the descriptor, a viewSize of 0 maps the whole object.
+        posix_file_view(native_handle handle, int64_t viewSize, file_access access, mapping_flags mappingFlags)
+            : spFile_(nullptr)
+            , sharedMemory_(false)
+            , name_("/proc/self/fd/" + std::to_string(handle))
+            , fileDescriptor_(handle)
+            , pData_(nullptr)
+            , pCursor_(nullptr)
+            , fileTotalSize_(0)
+            , mappedTotalSize_(0)
+            , windowSize_(0)
+            , windowOffset_(0)
+            , viewTotalSize_(0)
+            , protection_(PROT_NONE)
+            , windowHint_(access_hint::normal)
+            , prefetchNextWindow_(false)
+            , mappingFlags_(mappingFlags)
+            , reservedSize_(0)
+            , usedSize_(0)
+        {
+            if (fileDescriptor_ == -1)
+            {
+                vfs_errorf("Cannot map an invalid handle");
+                return;
+            }
+            map(viewSize, false, access);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Shared memory without a name (a memfd), other processes can only map it once its handle is
+        // sent to them.
+        posix_file_view(int64_t size, mapping_flags mappingFlags)
+            : posix_file_view(create_anonymous_memory(mappingFlags), has_huge_pages(mappingFlags) ? round_up_to_huge_page_size(size) : size, file_access::read_write, mappingFlags)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        posix_file_view(const path &name, int64_t size, bool openExisting, mapping_flags mappingFlags)
             : spFile_(nullptr)
             , sharedMemory_(true)
             , name_(name)
@@ -48,6 +108,15 @@ namespace vfs {
             , pCursor_(nullptr)
             , fileTotalSize_(0)
             , mappedTotalSize_(0)
+            , windowSize_(0)
+            , windowOffset_(0)
+            , viewTotalSize_(0)
+            , protection_(PROT_NONE)
+            , windowHint_(access_hint::normal)
+            , prefetchNextWindow_(false)
+            , mappingFlags_(mappingFlags)
+            , reservedSize_(0)
+            , usedSize_(0)
         {
             map(size, openExisting, file_access::read_write);
         }
@@ -57,10 +126,21 @@ namespace vfs {
         {
             unmap();
 
-            if (sharedMemory_ && shm_unlink(name_.c_str()) == -1)
+            // Drops what was allocated ahead of the writes.
+            if (isGrowable() && ftruncate(fileDescriptor_, usedSize_) == -1)
+            {
+                vfs_errorf("ftruncate(%s, %ld) failed with error %s", name_.c_str(), usedSize_, get_last_error_as_string(errno).c_str());
+            }
+
+            if (sharedMemory_ && !unlinkSharedMemory())
             {
                 vfs_errorf("shm_unlink(%s) failed with error: %s", name_.c_str(), get_last_error_as_string(errno).c_str());
             }
+            // Descriptors of files belong to spFile_, the view owns the other ones.
+            if (!spFile_ && fileDescriptor_ != -1)
+            {
+                close(fileDescriptor_);
+            }
         }
 
 		//------------------------------------------------------------------------------------------
@@ -75,6 +155,12 @@ namespace vfs {
                 // Multiple processes can share a view of this same file by calling mmap() with the same file descriptor.
                 fileTotalSize_              = calculateCurrentFileSize();
                 mappedTotalSize_            = viewSize == 0 ? fileTotalSize_ : viewSize;
+                if (canGrow(access))
+                {
+                    // The view starts with the content of the file, the rest of the mapping is room to grow.
+                    usedSize_           = fileTotalSize_;
+                    mappedTotalSize_    = round_up_to_page_size(std::max(mappedTotalSize_, page_size()));
+                }
                 if (fileTotalSize_ < mappedTotalSize_)
                 {
                     // Make file bigger.
@@ -104,7 +190,7 @@ namespace vfs {
 
                 // name_ will specify the name of the shared-memory object.
                 // Processes that wish to access this shared memory must refer to the object by this name.
-                fileDescriptor_ = shm_open(name_.c_str(), flags, mode);
+                fileDescriptor_ = openSharedMemory(flags, mode);
 
                 if (openExisting)
                 {
@@ -114,7 +200,6 @@ namespace vfs {
                     if (!shmAlreadyExists)
                     {
                         // Then the memory opened didn't exist previously.
-                        close(fileDescriptor_);
                         return false;
                     }
                     else if (errno != EEXIST)
@@ -126,7 +211,7 @@ namespace vfs {
                     {
                         // Intended behavior.
                         flags           &= ~O_EXCL;
-                        fileDescriptor_ = shm_open(name_.c_str(), flags, mode);
+                        fileDescriptor_ = openSharedMemory(flags, mode);
 
                         if (fileDescriptor_ == -1)
                         {
@@ -138,10 +223,15 @@ namespace vfs {
                         mappedTotalSize_    = viewSize == 0 ? fileTotalSize_ : viewSize;
                     }
                 }
+                else if (fileDescriptor_ == -1)
+                {
+                    vfs_errorf("shm_open() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return false;
+                }
                 else
                 {
                     // We just created a new shared memory object, we need to truncate it to desired view size.
-                    fileTotalSize_  = mappedTotalSize_ = viewSize;
+                    fileTotalSize_  = mappedTotalSize_ = usesHugePages() ? round_up_to_huge_page_size(viewSize) : viewSize;
                     truncate        = true;
                 }
             }
@@ -150,23 +240,27 @@ namespace vfs {
             {
                 if (ftruncate(fileDescriptor_, fileTotalSize_) == -1)
                 {
-                    if (sharedMemory_)
-                    {
-                        close(fileDescriptor_);
-                    }
                     vfs_errorf("ftruncate() failed with error %s", get_last_error_as_string(errno).c_str());
                     return false;
                 }
             }
 
-            pCursor_ = pData_ = reinterpret_cast<uint8_t *>(mmap(nullptr, mappedTotalSize_, protection, MAP_SHARED, fileDescriptor_, 0));
+            viewTotalSize_ = mappedTotalSize_;
+            if (isWindowed())
+            {
+                protection_ = protection;
+                return mapWindow(0);
+            }
 
-            if (sharedMemory_)
+            if (canGrow(access))
             {
-                // Once mapped into memory, we can close the file descriptor. However we do not want to close a file descriptor possibly still used by spFile_ object.
-                close(fileDescriptor_);
+                protection_ = protection;
+                return mapGrowable();
             }
 
+            pCursor_ = pData_ = reinterpret_cast<uint8_t *>(mmap(nullptr, mappedTotalSize_, protection, mmapFlags(), fileDescriptor_, 0));
+
+            // Shared memory keeps its descriptor open until the view is destroyed so it can be sent to other processes.
             if (pData_ == MAP_FAILED)
             {
                 pData_ = pCursor_ = nullptr;
@@ -174,9 +268,312 @@ namespace vfs {
                 return false;
             }
 
+            applyMappingFlags(0, mappedTotalSize_);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Maps the file at the beginning of an address range reserved for the view to grow in place.
+        bool mapGrowable()
+        {
+            const auto reservedSize = std::max(growable_reserved_size, round_up_to_page_size(mappedTotalSize_ * 2));
+            const auto pReserved    = posix_virtual_allocator::reserve(reservedSize);
+            if (pReserved == nullptr)
+            {
+                vfs_errorf("Reserving %ld bytes for %s failed with error: %s", reservedSize, name_.c_str(), get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            if (mmap(pReserved, mappedTotalSize_, protection_, mmapFlags() | MAP_FIXED, fileDescriptor_, 0) == MAP_FAILED)
+            {
+                vfs_errorf("mmap() failed with error: %s", get_last_error_as_string(errno).c_str());
+                munmap(pReserved, reservedSize);
+                return false;
+            }
+
+            pCursor_ = pData_   = reinterpret_cast<uint8_t*>(pReserved);
+            reservedSize_       = reservedSize;
+            viewTotalSize_      = mappedTotalSize_;
+            applyMappingFlags(0, mappedTotalSize_);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Extends the file and maps the new part right after the current mapping, at least doubling
+        // its size so appending stays amortized O(1). Addresses already handed out stay valid.
+        bool grow(int64_t requiredSize)
+        {
+            if (requiredSize > reservedSize_)
+            {
+                vfs_errorf("%s cannot grow past the %ld bytes reserved for its view", name_.c_str(), reservedSize_);
+                return false;
+            }
+
+            const auto newSize = std::min(round_up_to_page_size(std::max(requiredSize, mappedTotalSize_ * 2)), reservedSize_);
+            if (ftruncate(fileDescriptor_, newSize) == -1)
+            {
+                vfs_errorf("ftruncate(%s, %ld) failed with error %s", name_.c_str(), newSize, get_last_error_as_string(errno).c_str());
+                return false;
+            }
+            fileTotalSize_ = newSize;
+
+            if (mmap(pData_ + mappedTotalSize_, newSize - mappedTotalSize_, protection_, mmapFlags() | MAP_FIXED, fileDescriptor_, mappedTotalSize_) == MAP_FAILED)
+            {
+                vfs_errorf("mmap(%s, %ld, %ld) failed with error: %s", name_.c_str(), newSize - mappedTotalSize_, mappedTotalSize_, get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            const auto oldSize  = mappedTotalSize_;
+            mappedTotalSize_    = viewTotalSize_ = newSize;
+            applyMappingFlags(oldSize, newSize - oldSize);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool canGrow(const file_access &access) const
+        {
+            if (!hasMappingFlag(mapping_flags::growable))
+            {
+                return false;
+            }
+            if (sharedMemory_ || isWindowed() || access != file_access::read_write)
+            {
+                vfs_errorf("Only views of whole files opened for reading and writing can grow, %s keeps its size", name_.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isGrowable() const
+        {
+            return reservedSize_ > 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Extends the part of the file in use up to the cursor.
+        void updateUsedSize()
+        {
+            if (isGrowable())
+            {
+                usedSize_ = std::max(usedSize_, position());
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Replaces the current window by the one containing the given offset of the view.
+        bool mapWindow(int64_t offset)
+        {
+            vfs_check(offset >= 0 && offset <= viewTotalSize_);
+
+            // mmap offsets must be page aligned. Map the window containing the last byte when asked for the end of the view.
+            const auto windowOffset = std::max(std::min(offset, viewTotalSize_ - 1), int64_t(0)) & ~(page_size() - 1);
+            const auto windowLength = std::min(windowSize_, viewTotalSize_ - windowOffset);
+
+            unmap();
+            pData_ = pCursor_ = nullptr;
+            mappedTotalSize_ = 0;
+
+            if (windowLength <= 0)
+            {
+                vfs_errorf("Cannot map an empty window of %s", name_.c_str());
+                return false;
+            }
+
+            auto pWindow = mmap(nullptr, windowLength, protection_, mmapFlags(), fileDescriptor_, windowOffset);
+            if (pWindow == MAP_FAILED)
+            {
+                vfs_errorf("mmap(%s, %ld, %ld) failed with error: %s", name_.c_str(), windowLength, windowOffset, get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            pData_              = reinterpret_cast<uint8_t*>(pWindow);
+            pCursor_            = pData_ + (offset - windowOffset);
+            windowOffset_       = windowOffset;
+            mappedTotalSize_    = windowLength;
+
+            applyMappingFlags(0, mappedTotalSize_);
+            if (windowHint_ != access_hint::normal)
+            {
+                adviseMapped(windowHint_, 0, mappedTotalSize_);
+            }
+
+            const auto nextWindowOffset = windowOffset_ + mappedTotalSize_;
+            if (prefetchNextWindow_ && nextWindowOffset < viewTotalSize_)
+            {
+                // Start reading the next window from disk while the caller processes this one.
+                posix_fadvise(fileDescriptor_, nextWindowOffset, std::min(windowSize_, viewTotalSize_ - nextWindowOffset), POSIX_FADV_WILLNEED);
+            }
+
             return true;
         }
 
+        //------------------------------------------------------------------------------------------
+        // Makes sure the next sizeInBytes bytes after the cursor are mapped (as long as they fit in a window),
+        // a growable view grows to hold them.
+        void ensureMapped(int64_t sizeInBytes)
+        {
+            if (isGrowable() && position() + sizeInBytes > mappedTotalSize_)
+            {
+                grow(position() + sizeInBytes);
+                return;
+            }
+
+            const auto cursorOffset = pCursor_ - pData_;
+            if (isWindowed() && isValid() && cursorOffset + sizeInBytes > mappedTotalSize_ && position() < viewTotalSize_)
+            {
+                mapWindow(position());
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool hasMappingFlag(mapping_flags flag) const
+        {
+            return uint32_t(mappingFlags_) & uint32_t(flag);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Regular files cannot be mapped with MAP_HUGETLB, only shared memory is moved to hugetlbfs.
+        bool usesHugePages() const
+        {
+            return sharedMemory_ && hasMappingFlag(mapping_flags::huge_pages);
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t mmapFlags() const
+        {
+            return MAP_SHARED | (hasMappingFlag(mapping_flags::populate) ? MAP_POPULATE : 0) | (usesHugePages() ? MAP_HUGETLB : 0);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Applied to every newly mapped range, failures leave a valid but slower mapping.
+        void applyMappingFlags(int64_t offset, int64_t sizeInBytes)
+        {
+            if (hasMappingFlag(mapping_flags::transparent_huge_pages))
+            {
+                adviseMapped(access_hint::huge_page, offset, sizeInBytes);
+            }
+
+            if (hasMappingFlag(mapping_flags::lock) && mlock(pData_ + offset, sizeInBytes) == -1)
+            {
+                vfs_errorf("mlock(%s, %ld) failed with error: %s", name_.c_str(), sizeInBytes, get_last_error_as_string(errno).c_str());
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        static bool has_huge_pages(mapping_flags mappingFlags)
+        {
+            return uint32_t(mappingFlags) & uint32_t(mapping_flags::huge_pages);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // A memfd backed by huge pages already lives in a hugetlbfs, it is mapped like any other file.
+        static int32_t create_anonymous_memory(mapping_flags mappingFlags)
+        {
+            const auto fd = memfd_create("vfs", MFD_CLOEXEC | (has_huge_pages(mappingFlags) ? MFD_HUGETLB : 0));
+            if (fd == -1)
+            {
+                vfs_errorf("memfd_create() failed with error: %s", get_last_error_as_string(errno).c_str());
+            }
+            return fd;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Shared memory backed by huge pages lives in a hugetlbfs mount instead of /dev/shm, with the same name.
+        int32_t openSharedMemory(int32_t flags, mode_t mode) const
+        {
+            if (!usesHugePages())
+            {
+                return shm_open(name_.c_str(), flags, mode);
+            }
+
+            if (hugetlbfs_mount().empty())
+            {
+                vfs_errorf("No hugetlbfs is mounted, %s cannot be backed by huge pages", name_.c_str());
+                errno = ENOENT;
+                return -1;
+            }
+            return open((hugetlbfs_mount() + name_.str()).c_str(), flags | O_CLOEXEC, mode);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool unlinkSharedMemory() const
+        {
+            if (!usesHugePages())
+            {
+                return shm_unlink(name_.c_str()) == 0;
+            }
+            return !hugetlbfs_mount().empty() && unlink((hugetlbfs_mount() + name_.str()).c_str()) == 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static const std::string& hugetlbfs_mount()
+        {
+            static const auto mountPath = []
+            {
+                auto pMounts = setmntent("/proc/mounts", "r");
+                if (pMounts == nullptr)
+                {
+                    return std::string{};
+                }
+
+                auto result = std::string{};
+                while (auto pEntry = getmntent(pMounts))
+                {
+                    if (strcmp(pEntry->mnt_type, "hugetlbfs") == 0)
+                    {
+                        result = pEntry->mnt_dir;
+                        break;
+                    }
+                }
+                endmntent(pMounts);
+                return result;
+            }();
+            return mountPath;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static int64_t round_up_to_huge_page_size(int64_t size)
+        {
+            // The block size of a hugetlbfs is its page size.
+            static const auto hugePageSize = []
+            {
+                struct statfs st;
+                return (!hugetlbfs_mount().empty() && statfs(hugetlbfs_mount().c_str(), &st) == 0) ? int64_t(st.f_bsize) : int64_t(2 * 1024 * 1024);
+            }();
+            return (size <= 0) ? 0 : (size + hugePageSize - 1) & ~(hugePageSize - 1);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isWindowed() const
+        {
+            return windowSize_ > 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Offset of the cursor from the beginning of the view.
+        int64_t position() const
+        {
+            return windowOffset_ + (pCursor_ - pData_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Address space reserved for a growable view, only what is actually mapped uses memory.
+        static constexpr auto growable_reserved_size = int64_t(64) * 1024 * 1024 * 1024;
+
+        //------------------------------------------------------------------------------------------
+        static int64_t page_size()
+        {
+            static const auto pageSize = int64_t(sysconf(_SC_PAGESIZE));
+            return pageSize;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static int64_t round_up_to_page_size(int64_t size)
+        {
+            return (size <= 0) ? 0 : (size + page_size() - 1) & ~(page_size() - 1);
+        }
+
         //------------------------------------------------------------------------------------------
         int64_t calculateCurrentFileSize() const
         {
@@ -200,7 +597,7 @@ namespace vfs {
         bool unmap()
         {
             // munmap will also flush contents back to underlying file if appropriate.
-            if (pData_ && munmap(pData_, mappedTotalSize_) == -1)
+            if (pData_ && munmap(pData_, isGrowable() ? reservedSize_ : mappedTotalSize_) == -1)
             {
                 vfs_errorf("munmap() failed with error: %s", get_last_error_as_string(errno).c_str());
                 return false;
@@ -210,11 +607,76 @@ namespace vfs {
         }
 
 		//------------------------------------------------------------------------------------------
-        bool flush()
+        // Offsets are relative to the beginning of the view, only the mapped part of the range is flushed.
+        // MS_ASYNC does nothing on Linux as dirty pages are tracked anyway, sync_file_range() is what
+        // actually starts the writeback.
+        bool flush(int64_t offset, int64_t sizeInBytes, flush_mode mode)
         {
-            if (!sharedMemory_ && msync(pData_, mappedTotalSize_, MS_ASYNC) == -1)
+            if (!isValid() || sharedMemory_)
+            {
+                return isValid();
+            }
+
+            const auto mappedOffset = offset - windowOffset_;
+            const auto end          = std::min(mappedOffset + ((sizeInBytes == 0) ? viewTotalSize_ - offset : sizeInBytes), mappedTotalSize_);
+            // msync() needs a page aligned address.
+            const auto begin        = std::max(mappedOffset, int64_t(0)) & ~(page_size() - 1);
+            if (begin >= end)
+            {
+                return true;
+            }
+
+            if (msync(pData_ + begin, end - begin, (mode == flush_mode::sync) ? MS_SYNC : MS_ASYNC) == -1)
+            {
+                vfs_errorf("msync(%s, %ld, %ld) failed with error: %s", name_.c_str(), begin, end - begin, get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            if (mode == flush_mode::async && sync_file_range(fileDescriptor_, windowOffset_ + begin, end - begin, SYNC_FILE_RANGE_WRITE) == -1)
+            {
+                vfs_errorf("sync_file_range(%s, %ld, %ld) failed with error: %s", name_.c_str(), windowOffset_ + begin, end - begin, get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+		//------------------------------------------------------------------------------------------
+        // Offsets are relative to the beginning of the view, a size of 0 means up to the end of the view.
+        // With a sliding window only the mapped part of the range is advised, a hint given for the whole
+        // view is applied again to every new window.
+        bool advise(access_hint hint, int64_t offset, int64_t sizeInBytes)
+        {
+            if (!isValid())
             {
-                vfs_errorf("msync() failed with error: %s", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            if (isWindowed() && offset == 0 && sizeInBytes == 0)
+            {
+                windowHint_ = hint;
+            }
+
+            return adviseMapped(hint, offset - windowOffset_, (sizeInBytes == 0) ? viewTotalSize_ - offset : sizeInBytes);
+        }
+
+		//------------------------------------------------------------------------------------------
+        // Offset is relative to the beginning of the current mapping.
+        bool adviseMapped(access_hint hint, int64_t offset, int64_t sizeInBytes)
+        {
+            const auto end      = std::min(offset + sizeInBytes, mappedTotalSize_);
+            // madvise() needs a page aligned address.
+            const auto begin    = std::max(offset, int64_t(0)) & ~(page_size() - 1);
+            if (begin >= end)
+            {
+                // Not mapped at the moment.
+                return true;
+            }
+
+            const auto advice = posix_madvise_advice(hint);
+            if (madvise(pData_ + begin, end - begin, advice) == -1)
+            {
+                vfs_errorf("madvise(%s, %ld, %ld, %d) failed with error: %s", name_.c_str(), begin, end - begin, advice, get_last_error_as_string(errno).c_str());
                 return false;
             }
 
@@ -224,6 +686,19 @@ namespace vfs {
 		//------------------------------------------------------------------------------------------
         int64_t read(uint8_t *dst, int64_t sizeInBytes)
         {
+            if (isWindowed())
+            {
+                return transferWindowed(sizeInBytes, [dst](uint8_t *pCursor, int64_t offset, int64_t size)
+                {
+                    memcpy(dst + offset, pCursor, size);
+                });
+            }
+
+            if (isGrowable() && position() + sizeInBytes > usedSize_)
+            {
+                return 0;
+            }
+
             if (canMoveCursor(sizeInBytes))
             {
                 memcpy(dst, pCursor_, sizeInBytes);
@@ -236,15 +711,52 @@ namespace vfs {
 		//------------------------------------------------------------------------------------------
         int64_t write(const uint8_t *src, int64_t sizeInBytes)
         {
+            if (isWindowed())
+            {
+                return transferWindowed(sizeInBytes, [src](uint8_t *pCursor, int64_t offset, int64_t size)
+                {
+                    memcpy(pCursor, src + offset, size);
+                });
+            }
+
+            ensureMapped(sizeInBytes);
             if (canMoveCursor(sizeInBytes))
             {
                 memcpy(pCursor_, src, sizeInBytes);
                 pCursor_ += sizeInBytes;
+                updateUsedSize();
                 return sizeInBytes;
             }
             return 0;
         }
 
+		//------------------------------------------------------------------------------------------
+        // Copies across as many windows as needed.
+        template<typename _Copy>
+        int64_t transferWindowed(int64_t sizeInBytes, _Copy &&copy)
+        {
+            if (!canMoveCursor(sizeInBytes))
+            {
+                return 0;
+            }
+
+            auto totalBytes = int64_t(0);
+            while (totalBytes < sizeInBytes)
+            {
+                ensureMapped(1);
+                if (!isValid())
+                {
+                    break;
+                }
+
+                const auto size = std::min(sizeInBytes - totalBytes, mappedTotalSize_ - (pCursor_ - pData_));
+                copy(pCursor_, totalBytes, size);
+                pCursor_    += size;
+                totalBytes  += size;
+            }
+            return totalBytes;
+        }
+
 		//------------------------------------------------------------------------------------------
         bool isValid() const
         {
@@ -254,7 +766,7 @@ namespace vfs {
 		//------------------------------------------------------------------------------------------
         int64_t totalSize() const
         {
-            return fileTotalSize_;
+            return isGrowable() ? usedSize_ : fileTotalSize_;
         }
 
 		//------------------------------------------------------------------------------------------
@@ -269,6 +781,10 @@ namespace vfs {
 
             // For posix this link specifies how memory mapping works for files larger than memory: https://stackoverflow.com/questions/41288602/how-does-a-memory-mapped-file-work-for-files-larger-than-memory
             // If we try to access a file that is so big it cannot fit in virtual memory, we're fucked. (This will probably never happen).
+            if (isWindowed())
+            {
+                return isValid() && position() + offsetInBytes >= 0 && position() + offsetInBytes <= viewTotalSize_;
+            }
             return isValid() && (pCursor_ - pData_ + offsetInBytes) <= mappedTotalSize_;
         }
 
@@ -289,15 +805,29 @@ namespace vfs {
         template<typename T = uint8_t>
         T* cursor()
         {
+            // A window always holds the page of the cursor and the ones after it.
+            ensureMapped(sizeof(T));
             return reinterpret_cast<T*>(pCursor_);
         }
 
 		//------------------------------------------------------------------------------------------
         bool skip(int64_t offsetInBytes)
         {
+            if (isGrowable())
+            {
+                ensureMapped(offsetInBytes);
+            }
+
             if (canMoveCursor(offsetInBytes))
             {
+                const auto cursorOffset = pCursor_ - pData_ + offsetInBytes;
+                if (isWindowed() && (cursorOffset < 0 || cursorOffset > mappedTotalSize_))
+                {
+                    return mapWindow(position() + offsetInBytes);
+                }
+
                 pCursor_ += offsetInBytes;
+                updateUsedSize();
                 return true;
             }
             return false;
@@ -309,16 +839,31 @@ namespace vfs {
             return spFile_;
         }
 
+        //------------------------------------------------------------------------------------------
+        native_handle nativeHandle() const
+        {
+            return fileDescriptor_;
+        }
+
 	private:
 		//------------------------------------------------------------------------------------------
-        file_sptr   spFile_;
-        bool        sharedMemory_;
-        path        name_;
-        int32_t     fileDescriptor_;
-        uint8_t     *pData_;
-        uint8_t     *pCursor_;
-        int64_t     fileTotalSize_;
-        int64_t     mappedTotalSize_;
+        file_sptr     spFile_;
+        bool          sharedMemory_;
+        path          name_;
+        int32_t       fileDescriptor_;
+        uint8_t       *pData_;
+        uint8_t       *pCursor_;
+        int64_t       fileTotalSize_;
+        int64_t       mappedTotalSize_;
+        int64_t       windowSize_;
+        int64_t       windowOffset_;
+        int64_t       viewTotalSize_;
+        int32_t       protection_;
+        access_hint   windowHint_;
+        bool          prefetchNextWindow_;
+        mapping_flags mappingFlags_;
+        int64_t       reservedSize_;
+        int64_t       usedSize_;
     };
     //----------------------------------------------------------------------------------------------
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "vfs/platform.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // The futexes are shared (no FUTEX_PRIVATE_FLAG) so they work between processes mapping the same
+    // memory, the kernel keys them on the underlying page instead of the virtual address.
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+
+    //----------------------------------------------------------------------------------------------
+    // Sleeps as long as word holds expected, until woken up or for timeout if it's not negative.
+    // Returns false on timeout, spurious wake ups return true and have to be handled by the caller.
+    inline bool posix_futex_wait(std::atomic<uint32_t> &word, uint32_t expected, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1))
+    {
+        struct timespec relativeTimeout = {};
+        if (timeout.count() >= 0)
+        {
+            relativeTimeout.tv_sec  = time_t(timeout.count() / 1000000000);
+            relativeTimeout.tv_nsec = long(timeout.count() % 1000000000);
+        }
+
+        const auto result = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, (timeout.count() >= 0) ? &relativeTimeout : nullptr, nullptr, 0);
+        if (result == -1)
+        {
+            if (errno == ETIMEDOUT)
+            {
+                return false;
+            }
+            if (errno != EAGAIN && errno != EINTR)
+            {
+                vfs_errorf("futex(FUTEX_WAIT) failed with error: %s", get_last_error_as_string(errno).c_str());
+            }
+        }
+
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    inline void posix_futex_wake(std::atomic<uint32_t> &word, int32_t count = INT_MAX)
+    {
+        if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, count, nullptr, nullptr, 0) == -1)
+        {
+            vfs_errorf("futex(FUTEX_WAKE) failed with error: %s", get_last_error_as_string(errno).c_str());
+        }
+    }
+
+} /*vfs*/
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "vfs/platform.hpp"
+#include "vfs/file_flags.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Submission/completion queue used by the asynchronous file implementation.
+    // Requests are prepared in user space, pushed to the kernel in a single batch by submit() and
+    // reaped with complete(). When io_uring is not available (old kernel, seccomp filter, disabled
+    // by sysctl...) the same interface is emulated with a small pool of threads issuing pread/pwrite.
+    // A ring is meant to be driven by a single thread, requests cannot be prepared or reaped concurrently.
+    class posix_io_ring
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto default_queue_depth   = uint32_t(128);
+        // Linux never transfers more than this in a single read/write call.
+        static constexpr auto max_transfer_size     = int64_t(0x7ffff000);
+
+    public:
+        //------------------------------------------------------------------------------------------
+        explicit posix_io_ring(uint32_t queueDepth = default_queue_depth, bool forceEmulation = false)
+            : ringFd_(-1)
+            , pSqRing_(nullptr)
+            , pCqRing_(nullptr)
+            , pSqes_(nullptr)
+            , sqRingSize_(0)
+            , cqRingSize_(0)
+            , sqeTail_(0)
+            , submittedTail_(0)
+            , running_(false)
+            , completionEventFd_(-1)
+            , inFlightCount_(0)
+        {
+            if (forceEmulation || !setupIoUring(queueDepth))
+            {
+                startEmulation();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~posix_io_ring()
+        {
+            if (isUsingIoUring())
+            {
+                releaseIoUring();
+            }
+            else
+            {
+                {
+                    std::lock_guard<std::mutex> _(mutex_);
+                    running_ = false;
+                }
+                requestCv_.notify_all();
+
+                for (auto &worker : workers_)
+                {
+                    worker.join();
+                }
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        posix_io_ring(const posix_io_ring &)                = delete;
+        posix_io_ring& operator =(const posix_io_ring &)    = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isUsingIoUring() const
+        {
+            return ringFd_ != -1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Number of requests submitted and not yet reaped by complete().
+        int32_t inFlightCount() const
+        {
+            return inFlightCount_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Signals eventFd (an eventfd) whenever a request completes, the owner can wait for
+        // completions along with other descriptors (epoll...) and reap them with complete().
+        bool notifyCompletions(int32_t eventFd)
+        {
+            if (!isUsingIoUring())
+            {
+                std::lock_guard<std::mutex> _(mutex_);
+                completionEventFd_ = eventFd;
+                return true;
+            }
+
+            if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_EVENTFD, &eventFd, 1) == -1)
+            {
+                vfs_errorf("io_uring_register(IORING_REGISTER_EVENTFD) failed with error: %s", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool prepareRead(int32_t fd, int64_t offset, uint8_t *dst, int64_t sizeInBytes, uint64_t userData)
+        {
+            return prepare(IORING_OP_READ, fd, offset, dst, sizeInBytes, userData);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool prepareWrite(int32_t fd, int64_t offset, const uint8_t *src, int64_t sizeInBytes, uint64_t userData)
+        {
+            return prepare(IORING_OP_WRITE, fd, offset, const_cast<uint8_t*>(src), sizeInBytes, userData);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Number of requests prepared and not yet taken by submit().
+        int32_t preparedCount()
+        {
+            if (!isUsingIoUring())
+            {
+                std::lock_guard<std::mutex> _(mutex_);
+                return int32_t(prepared_.size());
+            }
+            return int32_t(sqeTail_ - submittedTail_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Hands every prepared request to the kernel (or the emulation workers) at once.
+        // Returns the number of requests submitted, or -1 on error. When the kernel cannot take
+        // them all, the rest stays prepared and goes with the next submit().
+        int32_t submit()
+        {
+            if (!isUsingIoUring())
+            {
+                auto submittedCount = int32_t(0);
+                {
+                    std::lock_guard<std::mutex> _(mutex_);
+                    submittedCount = int32_t(prepared_.size());
+                    submitted_.insert(submitted_.end(), prepared_.begin(), prepared_.end());
+                    prepared_.clear();
+                }
+                inFlightCount_ += submittedCount;
+                requestCv_.notify_all();
+                return submittedCount;
+            }
+
+            auto sqTail                 = std::atomic_ref<uint32_t>(*sqTail_);
+            // Entries published by a previous submit() the kernel did not take are sent again.
+            const auto toSubmitCount    = sqeTail_ - submittedTail_;
+            // Publish the new entries before entering the kernel.
+            sqTail.store(sqeTail_, std::memory_order_release);
+
+            auto submittedCount = uint32_t(0);
+            while (submittedCount < toSubmitCount)
+            {
+                const auto result = enter(toSubmitCount - submittedCount, 0, 0);
+                if (result == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if ((errno == EAGAIN || errno == EBUSY) && inFlightCount_ > 0)
+                    {
+                        // The completion queue is full, the caller has to reap some completions first.
+                        break;
+                    }
+                    vfs_errorf("io_uring_enter() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return -1;
+                }
+                submittedCount += uint32_t(result);
+                submittedTail_ += uint32_t(result);
+            }
+
+            inFlightCount_ += int32_t(submittedCount);
+            return int32_t(submittedCount);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Reaps up to maxCount completions, blocking until at least minCount are available.
+        // Returns the number of completions written to the array, or -1 on error.
+        int32_t complete(io_completion *completions, int32_t maxCount, int32_t minCount = 0)
+        {
+            vfs_check(minCount <= maxCount);
+            minCount = std::min(minCount, inFlightCount_);
+
+            if (!isUsingIoUring())
+            {
+                std::unique_lock<std::mutex> lk(mutex_);
+                completionCv_.wait(lk, [this, minCount] { return int32_t(completed_.size()) >= minCount; });
+
+                const auto count = std::min(maxCount, int32_t(completed_.size()));
+                std::copy_n(completed_.begin(), count, completions);
+                completed_.erase(completed_.begin(), completed_.begin() + count);
+                inFlightCount_ -= count;
+                return count;
+            }
+
+            auto count = int32_t(0);
+            while (true)
+            {
+                auto cqHead         = std::atomic_ref<uint32_t>(*cqHead_);
+                const auto cqTail   = std::atomic_ref<uint32_t>(*cqTail_).load(std::memory_order_acquire);
+                auto head           = cqHead.load(std::memory_order_relaxed);
+
+                for (; head != cqTail && count < maxCount; ++head, ++count)
+                {
+                    const auto &cqe = pCqes_[head & *cqRingMask_];
+                    completions[count] = io_completion{ cqe.user_data, cqe.res };
+                }
+                // Give the slots back to the kernel.
+                cqHead.store(head, std::memory_order_release);
+
+                if (count >= minCount)
+                {
+                    break;
+                }
+
+                if (enter(0, uint32_t(minCount - count), IORING_ENTER_GETEVENTS) == -1 && errno != EINTR)
+                {
+                    vfs_errorf("io_uring_enter(IORING_ENTER_GETEVENTS) failed with error: %s", get_last_error_as_string(errno).c_str());
+                    inFlightCount_ -= count;
+                    return count > 0 ? count : -1;
+                }
+            }
+
+            inFlightCount_ -= count;
+            return count;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        struct request
+        {
+            uint8_t     opcode;
+            int32_t     fd;
+            int64_t     offset;
+            uint8_t     *pBuffer;
+            int64_t     sizeInBytes;
+            uint64_t    userData;
+        };
+
+    private:
+        //------------------------------------------------------------------------------------------
+        bool prepare(uint8_t opcode, int32_t fd, int64_t offset, uint8_t *pBuffer, int64_t sizeInBytes, uint64_t userData)
+        {
+            sizeInBytes = std::min(sizeInBytes, max_transfer_size);
+
+            if (!isUsingIoUring())
+            {
+                std::lock_guard<std::mutex> _(mutex_);
+                prepared_.push_back(request{ opcode, fd, offset, pBuffer, sizeInBytes, userData });
+                return true;
+            }
+
+            const auto sqHead = std::atomic_ref<uint32_t>(*sqHead_).load(std::memory_order_acquire);
+            if (sqeTail_ - sqHead >= params_.sq_entries)
+            {
+                // The submission queue is full, push what we have so far to make some room.
+                if (submit() <= 0)
+                {
+                    return false;
+                }
+            }
+
+            const auto index    = sqeTail_ & *sqRingMask_;
+            auto &sqe           = pSqes_[index];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode          = opcode;
+            sqe.fd              = fd;
+            sqe.off             = uint64_t(offset);
+            sqe.addr            = uint64_t(reinterpret_cast<uintptr_t>(pBuffer));
+            sqe.len             = uint32_t(sizeInBytes);
+            sqe.user_data       = userData;
+            sqArray_[index]     = index;
+            ++sqeTail_;
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t enter(uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+        {
+            return int32_t(syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, nullptr, 0));
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool setupIoUring(uint32_t queueDepth)
+        {
+            memset(&params_, 0, sizeof(params_));
+            ringFd_ = int32_t(syscall(__NR_io_uring_setup, queueDepth, &params_));
+            if (ringFd_ == -1)
+            {
+                vfs_warningf("io_uring_setup() failed with error: %s, falling back to thread pool emulation.", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            sqRingSize_ = params_.sq_off.array + params_.sq_entries * sizeof(uint32_t);
+            cqRingSize_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+
+            // Recent kernels map both rings with a single mmap() call.
+            const auto singleMmap = (params_.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMmap)
+            {
+                sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+            }
+
+            pSqRing_ = mapRing(sqRingSize_, IORING_OFF_SQ_RING);
+            pCqRing_ = singleMmap ? pSqRing_ : mapRing(cqRingSize_, IORING_OFF_CQ_RING);
+            pSqes_   = reinterpret_cast<io_uring_sqe*>(mapRing(params_.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+
+            if (pSqRing_ == nullptr || pCqRing_ == nullptr || pSqes_ == nullptr)
+            {
+                releaseIoUring();
+                return false;
+            }
+
+            sqHead_     = reinterpret_cast<uint32_t*>(pSqRing_ + params_.sq_off.head);
+            sqTail_     = reinterpret_cast<uint32_t*>(pSqRing_ + params_.sq_off.tail);
+            sqRingMask_ = reinterpret_cast<uint32_t*>(pSqRing_ + params_.sq_off.ring_mask);
+            sqArray_    = reinterpret_cast<uint32_t*>(pSqRing_ + params_.sq_off.array);
+            cqHead_     = reinterpret_cast<uint32_t*>(pCqRing_ + params_.cq_off.head);
+            cqTail_     = reinterpret_cast<uint32_t*>(pCqRing_ + params_.cq_off.tail);
+            cqRingMask_ = reinterpret_cast<uint32_t*>(pCqRing_ + params_.cq_off.ring_mask);
+            pCqes_      = reinterpret_cast<io_uring_cqe*>(pCqRing_ + params_.cq_off.cqes);
+            sqeTail_    = *sqTail_;
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void releaseIoUring()
+        {
+            // Closing the ring waits for or cancels any request still owned by the kernel.
+            if (pSqes_)
+            {
+                munmap(pSqes_, params_.sq_entries * sizeof(io_uring_sqe));
+            }
+            if (pCqRing_ && pCqRing_ != pSqRing_)
+            {
+                munmap(pCqRing_, cqRingSize_);
+            }
+            if (pSqRing_)
+            {
+                munmap(pSqRing_, sqRingSize_);
+            }
+            ::close(ringFd_);
+
+            ringFd_     = -1;
+            pSqRing_    = pCqRing_ = nullptr;
+            pSqes_      = nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        uint8_t* mapRing(size_t size, off_t offset)
+        {
+            auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, offset);
+            if (p == MAP_FAILED)
+            {
+                vfs_errorf("mmap() of io_uring failed with error: %s", get_last_error_as_string(errno).c_str());
+                return nullptr;
+            }
+            return reinterpret_cast<uint8_t*>(p);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void startEmulation()
+        {
+            running_ = true;
+
+            const auto workerCount = std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+            for (auto i = 0u; i < workerCount; ++i)
+            {
+                workers_.emplace_back([this] { runEmulation(); });
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void runEmulation()
+        {
+            while (true)
+            {
+                auto req = request{};
+                {
+                    std::unique_lock<std::mutex> lk(mutex_);
+                    requestCv_.wait(lk, [this] { return !submitted_.empty() || !running_; });
+                    if (submitted_.empty())
+                    {
+                        // Only leave once every submitted request has been processed.
+                        return;
+                    }
+                    req = submitted_.front();
+                    submitted_.pop_front();
+                }
+
+                const auto result = (req.opcode == IORING_OP_READ)
+                    ? pread64(req.fd, req.pBuffer, req.sizeInBytes, req.offset)
+                    : pwrite64(req.fd, req.pBuffer, req.sizeInBytes, req.offset);
+
+                {
+                    std::lock_guard<std::mutex> _(mutex_);
+                    // Report errors the same way io_uring does, as a negated errno.
+                    completed_.push_back(io_completion{ req.userData, result == -1 ? -int64_t(errno) : int64_t(result) });
+                    if (completionEventFd_ != -1)
+                    {
+                        const auto one = uint64_t(1);
+                        [[maybe_unused]] const auto bytesWritten = ::write(completionEventFd_, &one, sizeof(one));
+                    }
+                }
+                completionCv_.notify_all();
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // io_uring
+        int32_t                     ringFd_;
+        io_uring_params             params_;
+        uint8_t                     *pSqRing_;
+        uint8_t                     *pCqRing_;
+        io_uring_sqe                *pSqes_;
+        io_uring_cqe                *pCqes_;
+        size_t                      sqRingSize_;
+        size_t                      cqRingSize_;
+        uint32_t                    *sqHead_;
+        uint32_t                    *sqTail_;
+        uint32_t                    *sqRingMask_;
+        uint32_t                    *sqArray_;
+        uint32_t                    *cqHead_;
+        uint32_t                    *cqTail_;
+        uint32_t                    *cqRingMask_;
+        uint32_t                    sqeTail_;
+        // End of the entries the kernel took, entries up to sqeTail_ are still to be submitted.
+        uint32_t                    submittedTail_;
+        //------------------------------------------------------------------------------------------
+        // Emulation
+        bool                        running_;
+        std::mutex                  mutex_;
+        std::condition_variable     requestCv_;
+        std::condition_variable     completionCv_;
+        std::vector<request>        prepared_;
+        std::deque<request>         submitted_;
+        std::deque<io_completion>   completed_;
+        std::vector<std::thread>    workers_;
+        int32_t                     completionEventFd_;
+        //------------------------------------------------------------------------------------------
+        int32_t                     inFlightCount_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
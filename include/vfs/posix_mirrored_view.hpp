@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vfs/platform.hpp"
+#include "vfs/path.hpp"
+#include "vfs/posix_virtual_allocator.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using mirrored_view_impl = class posix_mirrored_view;
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // An anonymous memfd mapped twice over an address range reserved beforehand, so that nothing
+    // else can be mapped in between the two halves.
+    class posix_mirrored_view
+    {
+    protected:
+        //------------------------------------------------------------------------------------------
+        posix_mirrored_view(const path &name, int64_t size)
+            : name_(name)
+            , fileDescriptor_(-1)
+            , pData_(nullptr)
+            , pCursor_(nullptr)
+            , totalSize_(round_up_to_page_size(size))
+        {
+            map();
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~posix_mirrored_view()
+        {
+            unmap();
+            closeDescriptor();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        posix_mirrored_view(const posix_mirrored_view &)                = delete;
+        posix_mirrored_view& operator =(const posix_mirrored_view &)    = delete;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool map()
+        {
+            if (totalSize_ == 0)
+            {
+                vfs_errorf("Cannot map the empty mirrored view %s", name_.c_str());
+                return false;
+            }
+
+            fileDescriptor_ = memfd_create(name_.c_str(), MFD_CLOEXEC);
+            if (fileDescriptor_ == -1)
+            {
+                vfs_errorf("memfd_create(%s) failed with error: %s", name_.c_str(), get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            if (ftruncate(fileDescriptor_, totalSize_) == -1)
+            {
+                vfs_errorf("ftruncate() failed with error %s", get_last_error_as_string(errno).c_str());
+                closeDescriptor();
+                return false;
+            }
+
+            // Both halves replace the reserved pages, MAP_FIXED is safe as the range belongs to us.
+            auto pReserved = posix_virtual_allocator::reserve(totalSize_ * 2);
+            if (pReserved == nullptr)
+            {
+                vfs_errorf("Reserving %ld bytes for %s failed with error: %s", totalSize_ * 2, name_.c_str(), get_last_error_as_string(errno).c_str());
+                closeDescriptor();
+                return false;
+            }
+
+            auto pBase = reinterpret_cast<uint8_t*>(pReserved);
+            for (auto pHalf : { pBase, pBase + totalSize_ })
+            {
+                if (mmap(pHalf, totalSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fileDescriptor_, 0) == MAP_FAILED)
+                {
+                    vfs_errorf("mmap() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    munmap(pBase, totalSize_ * 2);
+                    closeDescriptor();
+                    return false;
+                }
+            }
+
+            pData_ = pCursor_ = pBase;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool unmap()
+        {
+            if (pData_ && munmap(pData_, totalSize_ * 2) == -1)
+            {
+                vfs_errorf("munmap() failed with error: %s", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void closeDescriptor()
+        {
+            if (fileDescriptor_ != -1)
+            {
+                close(fileDescriptor_);
+                fileDescriptor_ = -1;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        static int64_t round_up_to_page_size(int64_t size)
+        {
+            static const auto pageSize = int64_t(sysconf(_SC_PAGESIZE));
+            return (size <= 0) ? 0 : (size + pageSize - 1) & ~(pageSize - 1);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return pData_ != nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t totalSize() const
+        {
+            return totalSize_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t nativeHandle() const
+        {
+            return fileDescriptor_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t read(uint8_t *dst, int64_t sizeInBytes)
+        {
+            if (!canTransfer(sizeInBytes))
+            {
+                return 0;
+            }
+
+            memcpy(dst, pCursor_, sizeInBytes);
+            skip(sizeInBytes);
+            return sizeInBytes;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t write(const uint8_t *src, int64_t sizeInBytes)
+        {
+            if (!canTransfer(sizeInBytes))
+            {
+                return 0;
+            }
+
+            memcpy(pCursor_, src, sizeInBytes);
+            skip(sizeInBytes);
+            return sizeInBytes;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool canTransfer(int64_t sizeInBytes) const
+        {
+            return isValid() && sizeInBytes >= 0 && sizeInBytes <= totalSize_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool skip(int64_t offsetInBytes)
+        {
+            if (!isValid())
+            {
+                return false;
+            }
+
+            pCursor_ = data((pCursor_ - pData_) + offsetInBytes);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename T = uint8_t>
+        T* data(int64_t position)
+        {
+            if (!isValid())
+            {
+                return nullptr;
+            }
+
+            const auto offset = position % totalSize_;
+            return reinterpret_cast<T*>(pData_ + (offset < 0 ? offset + totalSize_ : offset));
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename T = uint8_t>
+        T* cursor()
+        {
+            return reinterpret_cast<T*>(pCursor_);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        path        name_;
+        int32_t     fileDescriptor_;
+        uint8_t     *pData_;
+        uint8_t     *pCursor_;
+        int64_t     totalSize_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
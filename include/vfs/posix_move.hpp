@@ -1,8 +1,13 @@
 #pragma once
 
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/sendfile.h>
 #include <sys/stat.h>
+#include <linux/fs.h>
+#include <vector>
+#include <algorithm>
 
 
 namespace vfs {
@@ -23,7 +28,7 @@ namespace vfs {
             {
                 if(errno == EXDEV)
                 {
-                    return move_across_different_filesystems(src, dst, overwrite);
+                    return move_across_different_filesystems(src, dst, overwrite, maxAttempts);
                 }
 
                 vfs_errorf("rename(%s, %s) returned error: %s", src.c_str(), dst.c_str(),
@@ -35,18 +40,55 @@ namespace vfs {
         }
 
         //----------------------------------------------------------------------------------------------
-        // Copies a file or a directory from src path to dst path.
-        // If src path is a directory, src and dst paths must be on the same drive.
+        // Copies a file from src path to dst path.
+        // The data is moved by the kernel whenever possible (reflink, copy_file_range, sendfile) and
+        // holes of sparse files are preserved. A destination created by a failed attempt is removed so
+        // the next attempt can create it again.
         static bool copy(const path &src, const path &dst, bool overwrite = false, int32_t maxAttempts = 1)
         {
-            // TODO.
-            vfs_check(false);
-            return false;
+            auto attempts = 0;
+            while (!copy_file(src, dst, overwrite))
+            {
+                if (++attempts >= maxAttempts)
+                {
+                    vfs_errorf("copy(%s, %s, %d) failed after %d attempts", src.c_str(), dst.c_str(), overwrite, attempts);
+                    return false;
+                }
+            }
+            return true;
         }
 
     private:
         //----------------------------------------------------------------------------------------------
-        static bool move_across_different_filesystems(const path &src, const path &dst, bool overwrite)
+        // Ordered from the cheapest to the most expensive, once a method is known not to work between
+        // two descriptors the next ones are used for the remaining ranges.
+        enum class copy_method
+        {
+            copy_file_range,
+            sendfile,
+            buffered
+        };
+
+        //----------------------------------------------------------------------------------------------
+        static bool move_across_different_filesystems(const path &src, const path &dst, bool overwrite, int32_t maxAttempts)
+        {
+            if (!copy(src, dst, overwrite, maxAttempts))
+            {
+                return false;
+            }
+
+            if (remove(src.c_str()) == -1)
+            {
+                vfs_errorf("remove(%s) returned error code: %s", src.c_str(),
+                           get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+        //----------------------------------------------------------------------------------------------
+        static bool copy_file(const path &src, const path &dst, bool overwrite)
         {
             const auto srcFd = open(src.c_str(), O_RDONLY);
             if(srcFd == -1)
@@ -56,39 +98,207 @@ namespace vfs {
                 return false;
             }
 
-            const auto dstFlags = overwrite ? O_WRONLY | O_CREAT | O_TRUNC : O_WRONLY | O_CREAT;
-            const auto dstFd    = open(dst.c_str(), dstFlags, S_IRWXU);
+            struct stat st;
+            if (fstat(srcFd, &st) == -1 || !S_ISREG(st.st_mode))
+            {
+                vfs_errorf("%s is not a regular file and cannot be copied", src.c_str());
+                close(srcFd);
+                return false;
+            }
+
+            // Creating the destination exclusively first tells whether it is ours to remove on failure,
+            // an existing file being overwritten is left in place.
+            const auto dstMode   = st.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO);
+            auto dstFd           = open(dst.c_str(), O_WRONLY | O_CREAT | O_EXCL, dstMode);
+            const auto isCreated = dstFd != -1;
+            if (dstFd == -1 && errno == EEXIST && overwrite)
+            {
+                dstFd = open(dst.c_str(), O_WRONLY | O_TRUNC);
+            }
             if(dstFd == -1)
             {
                 vfs_errorf("open(%s, ...) returned error: %s",
                            dst.c_str(), get_last_error_as_string(errno).c_str());
+                close(srcFd);
                 return false;
             }
 
-            auto success = true;
+            const auto success = copy_file_content(srcFd, dstFd, int64_t(st.st_size), src, dst);
 
-            struct stat st;
-            stat(src.c_str(), &st);
-            off_t offset = 0;
+            close(srcFd);
+            close(dstFd);
 
-            if(sendfile64(dstFd, srcFd, &offset, st.st_size) == -1)
+            if (!success && isCreated && unlink(dst.c_str()) == -1)
             {
-                vfs_errorf("sendfile64() returned error: %s",
-                           get_last_error_as_string(errno).c_str());
-                success = false;
+                vfs_errorf("unlink(%s) returned error: %s", dst.c_str(), get_last_error_as_string(errno).c_str());
             }
 
-            close(srcFd);
-            close(dstFd);
+            return success;
+        }
 
-            if (remove(src.c_str()) == -1)
+        //----------------------------------------------------------------------------------------------
+        static bool copy_file_content(int32_t srcFd, int32_t dstFd, int64_t fileSize, const path &src, const path &dst)
+        {
+            // Sharing the extents is instantaneous when both files are on the same CoW filesystem (btrfs, xfs...).
+            if (ioctl(dstFd, FICLONE, srcFd) == 0)
             {
-                vfs_errorf("remove(%s) returned error code: %s", src.c_str(),
+                return true;
+            }
+
+            auto method = copy_method::copy_file_range;
+            auto offset = int64_t(0);
+            while (offset < fileSize)
+            {
+                // Only copy the data segments, skipping holes leaves them unallocated in the destination.
+                auto dataBegin = int64_t(lseek64(srcFd, offset, SEEK_DATA));
+                if (dataBegin == -1)
+                {
+                    if (errno == ENXIO)
+                    {
+                        // Only a hole up to the end of the file.
+                        break;
+                    }
+                    // SEEK_DATA not supported, everything is data.
+                    dataBegin = offset;
+                }
+
+                auto dataEnd = int64_t(lseek64(srcFd, dataBegin, SEEK_HOLE));
+                if (dataEnd == -1)
+                {
+                    dataEnd = fileSize;
+                }
+                dataEnd = std::min(dataEnd, fileSize);
+
+                if (!copy_range(srcFd, dstFd, dataBegin, dataEnd - dataBegin, method))
+                {
+                    vfs_errorf("Copying %s to %s failed at offset %ld", src.c_str(), dst.c_str(), dataBegin);
+                    return false;
+                }
+                offset = dataEnd;
+            }
+
+            // Trailing holes have to be created explicitly.
+            if (ftruncate64(dstFd, fileSize) == -1)
+            {
+                vfs_errorf("ftruncate64(%s, %ld) returned error: %s", dst.c_str(), fileSize,
                            get_last_error_as_string(errno).c_str());
                 return false;
             }
 
-            return success;
+            return true;
+        }
+
+        //----------------------------------------------------------------------------------------------
+        // Copies [offset, offset + sizeInBytes) at the same offset in dstFd.
+        // The transfers can be short, each method loops until the whole range went through.
+        static bool copy_range(int32_t srcFd, int32_t dstFd, int64_t offset, int64_t sizeInBytes, copy_method &method)
+        {
+            auto srcOffset  = loff_t(offset);
+            auto dstOffset  = loff_t(offset);
+            const auto end  = offset + sizeInBytes;
+
+            while (method == copy_method::copy_file_range && srcOffset < end)
+            {
+                const auto bytesCopied = copy_file_range(srcFd, &srcOffset, dstFd, &dstOffset, size_t(end - srcOffset), 0);
+                if (bytesCopied == 0)
+                {
+                    // The source was truncated while copying.
+                    return true;
+                }
+                if (bytesCopied == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno != EXDEV && errno != ENOSYS && errno != EOPNOTSUPP && errno != EINVAL)
+                    {
+                        vfs_errorf("copy_file_range() returned error: %s", get_last_error_as_string(errno).c_str());
+                        return false;
+                    }
+                    method = copy_method::sendfile;
+                }
+            }
+
+            if (method == copy_method::sendfile && srcOffset < end)
+            {
+                // sendfile() writes at the current position of the destination.
+                if (lseek64(dstFd, dstOffset, SEEK_SET) == -1)
+                {
+                    vfs_errorf("lseek64() returned error: %s", get_last_error_as_string(errno).c_str());
+                    return false;
+                }
+            }
+
+            while (method == copy_method::sendfile && srcOffset < end)
+            {
+                auto sendOffset = off64_t(srcOffset);
+                // A single call transfers at most 0x7ffff000 bytes.
+                const auto bytesSent = sendfile64(dstFd, srcFd, &sendOffset, size_t(end - srcOffset));
+                if (bytesSent == 0)
+                {
+                    return true;
+                }
+                if (bytesSent == -1)
+                {
+                    if (errno == EINTR || errno == EAGAIN)
+                    {
+                        continue;
+                    }
+                    if (errno != EINVAL && errno != ENOSYS)
+                    {
+                        vfs_errorf("sendfile64() returned error: %s", get_last_error_as_string(errno).c_str());
+                        return false;
+                    }
+                    method = copy_method::buffered;
+                    break;
+                }
+                srcOffset = sendOffset;
+                dstOffset += bytesSent;
+            }
+
+            if (method == copy_method::buffered && srcOffset < end)
+            {
+                auto buffer = std::vector<uint8_t>(size_t(std::min(end - srcOffset, int64_t(1024 * 1024))));
+                while (srcOffset < end)
+                {
+                    const auto bytesRead = pread64(srcFd, buffer.data(), size_t(std::min(end - srcOffset, int64_t(buffer.size()))), srcOffset);
+                    if (bytesRead == 0)
+                    {
+                        return true;
+                    }
+                    if (bytesRead == -1)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        vfs_errorf("pread64() returned error: %s", get_last_error_as_string(errno).c_str());
+                        return false;
+                    }
+
+                    auto totalBytesWritten = ssize_t(0);
+                    while (totalBytesWritten < bytesRead)
+                    {
+                        const auto bytesWritten = pwrite64(dstFd, buffer.data() + totalBytesWritten, size_t(bytesRead - totalBytesWritten), dstOffset + totalBytesWritten);
+                        if (bytesWritten == -1)
+                        {
+                            if (errno == EINTR)
+                            {
+                                continue;
+                            }
+                            vfs_errorf("pwrite64() returned error: %s", get_last_error_as_string(errno).c_str());
+                            return false;
+                        }
+                        totalBytesWritten += bytesWritten;
+                    }
+
+                    srcOffset += bytesRead;
+                    dstOffset += bytesRead;
+                }
+            }
+
+            return true;
         }
     };
 
@@ -21,12 +21,20 @@
 // If we are the server, we MUST call waitForConnection() before read().
 
 #include <chrono>
+#include <deque>
+#include <vector>
+#include <climits>
+#include <cstring>
+#include <algorithm>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 
 #include "vfs/platform.hpp"
 #include "vfs/posix_file_flags.hpp"
+#include "vfs/posix_pipe_message.hpp"
 #include "vfs/path.hpp"
 
 // LISTEN_BACKLOG corresponds to the maximum length to which the queue of pending conections for socketFd_ may grow.
@@ -54,6 +62,13 @@ namespace vfs {
             return clientFd_;
         }
 
+        //------------------------------------------------------------------------------------------
+        // Socket accepting the connections of a server, readable once a client waits.
+        native_handle listeningHandle() const
+        {
+            return socketFd_;
+        }
+
         //------------------------------------------------------------------------------------------
         const path &fileName() const
         {
@@ -79,6 +94,9 @@ namespace vfs {
             , socketFd_(-1)
             , clientFd_(-1)
             , fileAccess_(access)
+            , receiveBegin_(0)
+            , receiveEnd_(0)
+            , maxMessageSize_(posix_pipe_message::default_max_size)
         {
             // CLIENT.
 
@@ -124,6 +142,9 @@ namespace vfs {
             : pipeName_(name)
             , socketFd_(-1)
             , clientFd_(-1)
+            , receiveBegin_(0)
+            , receiveEnd_(0)
+            , maxMessageSize_(posix_pipe_message::default_max_size)
         {
             // SERVER.
 
@@ -149,6 +170,16 @@ namespace vfs {
             {
                 vfs_errorf("bind() failed with error: %s", get_last_error_as_string(errno).c_str());
                 close();
+                return;
+            }
+
+            // Listen for connections with the listen() system call.
+            // listen() marks the socket referred to by socketFd_ as a passive socket, e.g. as a socket that will be used to accept incoming connection requests using accept().
+            // Done here rather than in waitForConnection() so clients can connect as soon as the pipe exists, they wait in the backlog until accepted.
+            if (listen(socketFd_, LISTEN_BACKLOG) == -1)
+            {
+                vfs_errorf("listen() failed with error: %s", get_last_error_as_string(errno).c_str());
+                close();
             }
         }
 
@@ -176,25 +207,29 @@ namespace vfs {
             {
                 ::close(clientFd_);
             }
-            if (isValid())
+            // Only the server owns the socket file, a client failing to connect must not remove it.
+            if (socketFd_ != -1)
             {
                 unlink(pipeName_.c_str());
-                clientFd_ = -1;
-                socketFd_ = -1;
             }
+            clientFd_ = -1;
+            socketFd_ = -1;
+            receiveBegin_   = 0;
+            receiveEnd_     = 0;
+
+            // Handles received but never read.
+            for (const auto handle : receivedHandles_)
+            {
+                ::close(handle);
+            }
+            receivedHandles_.clear();
         }
 
         //------------------------------------------------------------------------------------------
         bool waitForConnection()
         {
             // Server.
-
-            // Listen for connections with the listen() system call.
-            // listen() marks the socket referred to by socketFd_ as a passive socket, e.g. as a socket that will be used to accept incoming connection requests using accept().
-            if (listen(socketFd_, LISTEN_BACKLOG) == -1)
-            {
-                vfs_errorf("listen() failed with error: %s", get_last_error_as_string(errno).c_str());
-            }
+            vfs_check(socketFd_ != -1);
 
             // Now we can accept incoming connections.
             auto peer_addr_size = (uint32_t)sizeof(sockaddr_un);
@@ -215,12 +250,26 @@ namespace vfs {
         //------------------------------------------------------------------------------------------
         int64_t availableBytesToRead() const
         {
-            // There is no function for determining how many bytes are left to read on a unix domain socket.
-            // To read a message whose length cannot be determined in advance, just do a non-blocking reads until one returns EAGAIN or EWOULDBLOCK.
+            if (clientFd_ == -1)
+            {
+                return -1;
+            }
 
-            // Source: https://stackoverflow.com/questions/65204661/is-there-a-function-for-determining-how-many-bytes-are-left-to-read-on-a-unix-do
+            // FIONREAD gives the bytes queued on a stream unix socket, plus what message reads buffered already.
+            auto queuedBytes = int32_t(0);
+            if (ioctl(clientFd_, FIONREAD, &queuedBytes) == -1)
+            {
+                vfs_errorf("ioctl(FIONREAD) failed with error: %s", get_last_error_as_string(errno).c_str());
+                return -1;
+            }
+
+            return int64_t(queuedBytes) + bufferedBytesToRead();
+        }
 
-            return -1;
+        //------------------------------------------------------------------------------------------
+        int64_t bufferedBytesToRead() const
+        {
+            return receiveEnd_ - receiveBegin_;
         }
 
         //------------------------------------------------------------------------------------------
@@ -228,7 +277,14 @@ namespace vfs {
         {
             vfs_check(clientFd_ != -1);
 
-            auto totalBytesRead = int64_t(0);
+            // Bytes already received by message reads come first.
+            auto totalBytesRead = std::min(sizeInBytes, receiveEnd_ - receiveBegin_);
+            if (totalBytesRead > 0)
+            {
+                memcpy(dst, receiveBuffer_.data() + receiveBegin_, totalBytesRead);
+                receiveBegin_ += totalBytesRead;
+            }
+
             while(totalBytesRead < sizeInBytes)
             {
                 // Read() is nonblocking since we specified the flag O_NONBLOCK to clientFd_.
@@ -275,12 +331,336 @@ namespace vfs {
             return totalBytesWritten;
         }
 
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool writeMessage(const uint8_t *src, int64_t sizeInBytes)
+        {
+            const auto message = io_vector{ const_cast<uint8_t*>(src), size_t(sizeInBytes) };
+            return writeMessages(&message, 1) == 1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t writeMessages(const io_vector *messages, int64_t messageCount)
+        {
+            vfs_check(clientFd_ != -1);
+
+            // Each sendmsg() gathers the headers and bodies of up to messages_per_send messages.
+            uint32_t    headers[messages_per_send];
+            iovec       buffers[messages_per_send * 2];
+
+            for (auto firstMessage = int64_t(0); firstMessage < messageCount; firstMessage += messages_per_send)
+            {
+                const auto batchSize = std::min(messageCount - firstMessage, int64_t(messages_per_send));
+                for (auto i = 0; i < batchSize; ++i)
+                {
+                    const auto &message = messages[firstMessage + i];
+                    if (message.size > max_message_size)
+                    {
+                        vfs_errorf("Cannot send a message of %zu bytes, the maximum is %u", message.size, max_message_size);
+                        return firstMessage + i;
+                    }
+
+                    headers[i]          = uint32_t(message.size);
+                    buffers[i * 2]      = iovec{ &headers[i], sizeof(uint32_t) };
+                    buffers[i * 2 + 1]  = iovec{ message.data, message.size };
+                }
+
+                if (!sendAll(buffers, int32_t(batchSize * 2)))
+                {
+                    return firstMessage;
+                }
+            }
+
+            return messageCount;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setMaxMessageSize(int64_t maxMessageSize)
+        {
+            maxMessageSize_ = std::min(maxMessageSize, int64_t(max_message_size));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Size of the message or -1 if the connection was closed or the message is larger than
+        // capacity, in which case it stays in the pipe. A handle sent along with it is closed.
+        int64_t readMessage(uint8_t *dst, int64_t capacity)
+        {
+            auto handle             = native_handle(-1);
+            const auto messageSize  = readHandle(handle, dst, capacity);
+            if (handle != -1)
+            {
+                ::close(handle);
+            }
+            return messageSize;
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Visitor>
+        int64_t readMessages(_Visitor &&visitor, int64_t maxMessageCount)
+        {
+            auto messageCount = int64_t(0);
+            while (messageCount < maxMessageCount)
+            {
+                const auto messageSize = nextMessageSize(messageCount == 0);
+                if (messageSize == -1)
+                {
+                    break;
+                }
+
+                const auto handle = takeHandle();
+                if (handle != -1)
+                {
+                    ::close(handle);
+                }
+
+                const auto pMessage = receiveBuffer_.data() + receiveBegin_ + message_header_size;
+                receiveBegin_ += message_header_size + messageSize;
+                ++messageCount;
+                visitor(static_cast<const uint8_t*>(pMessage), messageSize);
+            }
+            return messageCount;
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        // Sends a message along with a duplicate of handle (SCM_RIGHTS), the receiving process gets
+        // its own descriptor to the same file, memfd or shared memory.
+        bool writeHandle(native_handle handle, const uint8_t *src, int64_t sizeInBytes)
+        {
+            vfs_check(clientFd_ != -1);
+
+            if (sizeInBytes > max_message_size)
+            {
+                vfs_errorf("Cannot send a message of %ld bytes, the maximum is %u", sizeInBytes, max_message_size);
+                return false;
+            }
+
+            auto header     = uint32_t(sizeInBytes) | handle_flag;
+            iovec buffers[] = { { &header, sizeof(header) }, { const_cast<uint8_t*>(src), size_t(sizeInBytes) } };
+            return sendAll(buffers, 2, handle);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Same as readMessage(), handle is set to the descriptor sent along with the message or to
+        // -1 if it came without one. The caller owns the descriptor.
+        int64_t readHandle(native_handle &handle, uint8_t *dst, int64_t capacity)
+        {
+            handle = -1;
+
+            const auto messageSize = nextMessageSize(true);
+            if (messageSize == -1)
+            {
+                return -1;
+            }
+            if (messageSize > capacity)
+            {
+                vfs_errorf("Message of %ld bytes does not fit in %ld bytes", messageSize, capacity);
+                return -1;
+            }
+
+            handle = takeHandle();
+            memcpy(dst, receiveBuffer_.data() + receiveBegin_ + message_header_size, messageSize);
+            receiveBegin_ += message_header_size + messageSize;
+            return messageSize;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto message_header_size       = posix_pipe_message::header_size;
+        static constexpr auto handle_flag               = posix_pipe_message::handle_flag;
+        static constexpr auto max_message_size          = posix_pipe_message::max_size;
+        static constexpr auto messages_per_send         = IOV_MAX / 2;
+        static constexpr auto receive_buffer_size       = int64_t(64 * 1024);
+        static constexpr auto max_handles_per_receive   = 16;
+
+        //------------------------------------------------------------------------------------------
+        // A handle goes with the first bytes sent, so it reaches the reader no later than its message.
+        bool sendAll(iovec *buffers, int32_t bufferCount, native_handle handle = -1)
+        {
+            auto message        = msghdr{};
+            message.msg_iov     = buffers;
+            message.msg_iovlen  = bufferCount;
+
+            alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(native_handle))];
+            if (handle != -1)
+            {
+                message.msg_control     = control;
+                message.msg_controllen  = sizeof(control);
+                auto pControl           = CMSG_FIRSTHDR(&message);
+                pControl->cmsg_level    = SOL_SOCKET;
+                pControl->cmsg_type     = SCM_RIGHTS;
+                pControl->cmsg_len      = CMSG_LEN(sizeof(native_handle));
+                memcpy(CMSG_DATA(pControl), &handle, sizeof(native_handle));
+            }
+
+            while (message.msg_iovlen > 0)
+            {
+                auto bytesSent = sendmsg(clientFd_, &message, MSG_NOSIGNAL);
+                if (bytesSent == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    vfs_errorf("sendmsg() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    close();
+                    return false;
+                }
+                message.msg_control     = nullptr;
+                message.msg_controllen  = 0;
+
+                // Skip what was sent, the socket buffer may have taken only part of the batch.
+                while (message.msg_iovlen > 0 && size_t(bytesSent) >= message.msg_iov->iov_len)
+                {
+                    bytesSent -= message.msg_iov->iov_len;
+                    ++message.msg_iov;
+                    --message.msg_iovlen;
+                }
+                if (message.msg_iovlen > 0)
+                {
+                    message.msg_iov->iov_base = static_cast<uint8_t*>(message.msg_iov->iov_base) + bytesSent;
+                    message.msg_iov->iov_len -= bytesSent;
+                }
+            }
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Handle of the next message in the receive buffer, -1 if it was sent without one. Handles
+        // are received in the order of their messages.
+        native_handle takeHandle()
+        {
+            auto header = uint32_t(0);
+            memcpy(&header, receiveBuffer_.data() + receiveBegin_, sizeof(header));
+            if ((header & handle_flag) == 0 || receivedHandles_.empty())
+            {
+                return -1;
+            }
+
+            const auto handle = receivedHandles_.front();
+            receivedHandles_.pop_front();
+            return handle;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Size of the next complete message in the receive buffer, receiving more if needed. Without
+        // wait it only takes what is already queued on the socket, -1 if there is no complete message.
+        int64_t nextMessageSize(bool wait)
+        {
+            if (clientFd_ == -1)
+            {
+                return -1;
+            }
+
+            while (true)
+            {
+                const auto bufferedSize = receiveEnd_ - receiveBegin_;
+                auto messageSize        = int64_t(-1);
+                if (bufferedSize >= message_header_size)
+                {
+                    auto header = uint32_t(0);
+                    memcpy(&header, receiveBuffer_.data() + receiveBegin_, sizeof(header));
+                    messageSize = posix_pipe_message::size(header);
+                    if (messageSize > maxMessageSize_)
+                    {
+                        vfs_errorf("Message of %ld bytes is larger than the maximum of %ld bytes, closing %s", messageSize, maxMessageSize_, pipeName_.c_str());
+                        close();
+                        return -1;
+                    }
+                    if (bufferedSize >= message_header_size + messageSize)
+                    {
+                        return messageSize;
+                    }
+                }
+
+                // Make room for the whole message at the end of the buffer.
+                const auto neededSize = std::max(message_header_size + std::max(messageSize, int64_t(0)), receive_buffer_size);
+                if (receiveBegin_ > 0)
+                {
+                    memmove(receiveBuffer_.data(), receiveBuffer_.data() + receiveBegin_, bufferedSize);
+                    receiveBegin_   = 0;
+                    receiveEnd_     = bufferedSize;
+                }
+                if (int64_t(receiveBuffer_.size()) < neededSize)
+                {
+                    receiveBuffer_.resize(neededSize);
+                }
+
+                // A single recvmsg() takes every message queued so far, as much as the buffer holds,
+                // and the handles sent along with them. Without room for them recv() would close them.
+                auto buffer             = iovec{ receiveBuffer_.data() + receiveEnd_, receiveBuffer_.size() - receiveEnd_ };
+                auto message            = msghdr{};
+                alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(native_handle) * max_handles_per_receive)];
+                message.msg_iov         = &buffer;
+                message.msg_iovlen      = 1;
+                message.msg_control     = control;
+                message.msg_controllen  = sizeof(control);
+
+                const auto bytesReceived = recvmsg(clientFd_, &message, MSG_CMSG_CLOEXEC | (wait ? 0 : MSG_DONTWAIT));
+                if (bytesReceived == 0)
+                {
+                    // Connection closed by peer.
+                    close();
+                    return -1;
+                }
+                if (bytesReceived == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    {
+                        vfs_errorf("recv() failed with error: %s", get_last_error_as_string(errno).c_str());
+                        close();
+                    }
+                    return -1;
+                }
+
+                receiveEnd_ += bytesReceived;
+                keepHandles(message);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void keepHandles(msghdr &message)
+        {
+            if (message.msg_flags & MSG_CTRUNC)
+            {
+                vfs_errorf("More than %d handles were received at once, the others were closed", max_handles_per_receive);
+            }
+
+            for (auto pControl = CMSG_FIRSTHDR(&message); pControl != nullptr; pControl = CMSG_NXTHDR(&message, pControl))
+            {
+                if (pControl->cmsg_level != SOL_SOCKET || pControl->cmsg_type != SCM_RIGHTS)
+                {
+                    continue;
+                }
+
+                const auto handleCount = (pControl->cmsg_len - CMSG_LEN(0)) / sizeof(native_handle);
+                for (auto i = size_t(0); i < handleCount; ++i)
+                {
+                    auto handle = native_handle(-1);
+                    memcpy(&handle, CMSG_DATA(pControl) + i * sizeof(native_handle), sizeof(native_handle));
+                    receivedHandles_.push_back(handle);
+                }
+            }
+        }
+
     private:
         //------------------------------------------------------------------------------------------
-        path        pipeName_;
-        int32_t     socketFd_;
-        int32_t     clientFd_;
-        file_access fileAccess_;
+        path                    pipeName_;
+        int32_t                 socketFd_;
+        int32_t                 clientFd_;
+        file_access             fileAccess_;
+        // Bytes received by message reads, [receiveBegin_, receiveEnd_) are not consumed yet.
+        std::vector<uint8_t>    receiveBuffer_;
+        int64_t                 receiveBegin_;
+        int64_t                 receiveEnd_;
+        int64_t                 maxMessageSize_;
+        // Handles received along with messages that were not read yet.
+        std::deque<native_handle>   receivedHandles_;
     };
 
 } /*vfs*/
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Framing of the messages sent over posix pipes, shared by both ends and by pipe_server. Each
+    // message starts with a 32 bits header holding its size, the top bit tells whether a handle was
+    // sent along with it.
+    struct posix_pipe_message
+    {
+        //------------------------------------------------------------------------------------------
+        static constexpr auto header_size   = int64_t(sizeof(uint32_t));
+        static constexpr auto handle_flag   = uint32_t(1) << 31;
+        static constexpr auto max_size      = handle_flag - 1;
+        // Receivers refuse larger messages unless told otherwise, their buffer grows to hold the
+        // size announced by the header.
+        static constexpr auto default_max_size  = int64_t(64 * 1024 * 1024);
+
+        //------------------------------------------------------------------------------------------
+        static constexpr int64_t size(uint32_t header)
+        {
+            return int64_t(header & ~handle_flag);
+        }
+    };
+
+} /*vfs*/
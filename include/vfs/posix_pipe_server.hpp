@@ -0,0 +1,552 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "vfs/platform.hpp"
+#include "vfs/path.hpp"
+#include "vfs/posix_pipe_message.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using pipe_server_impl = class posix_pipe_server;
+
+
+    //----------------------------------------------------------------------------------------------
+    // One epoll loop for the listening socket and every client. Client sockets are non-blocking and
+    // edge triggered: each readiness event is drained until EAGAIN into the buffer of the client,
+    // and the complete messages are handed to the callback straight from that buffer.
+    class posix_pipe_server
+    {
+        //------------------------------------------------------------------------------------------
+        using connection_id         = uint64_t;
+        using connect_callback_t    = std::function<void(connection_id)>;
+        using message_callback_t    = std::function<void(connection_id, const uint8_t*, int64_t)>;
+        using disconnect_callback_t = std::function<void(connection_id)>;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto default_max_message_size = posix_pipe_message::default_max_size;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        posix_pipe_server
+        (
+            const path                  &pipeName,
+            const connect_callback_t    &onConnect,
+            const message_callback_t    &onMessage,
+            const disconnect_callback_t &onDisconnect,
+            int64_t                     maxMessageSize
+        )
+            : pipeName_(pipeName)
+            , running_(false)
+            , onConnect_(onConnect)
+            , onMessage_(onMessage)
+            , onDisconnect_(onDisconnect)
+            , maxMessageSize_(std::min(maxMessageSize, int64_t(max_message_size)))
+            , epollFd_(epoll_create1(EPOLL_CLOEXEC))
+            , eventFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+            , listenFd_(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0))
+            , nextConnectionId_(first_connection_id)
+        {
+            if (epollFd_ == -1 || eventFd_ == -1 || listenFd_ == -1)
+            {
+                vfs_errorf("Could not create the descriptors of the pipe server %s, error: %s", pipeName_.c_str(), get_last_error_as_string(errno).c_str());
+                return;
+            }
+
+            auto address = sockaddr_un{};
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, pipeName_.c_str(), sizeof(address.sun_path) - 1);
+
+            if (bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1)
+            {
+                vfs_errorf("bind(%s) failed with error: %s", pipeName_.c_str(), get_last_error_as_string(errno).c_str());
+                closeListeningSocket(false);
+                return;
+            }
+            if (listen(listenFd_, SOMAXCONN) == -1)
+            {
+                vfs_errorf("listen(%s) failed with error: %s", pipeName_.c_str(), get_last_error_as_string(errno).c_str());
+                closeListeningSocket(true);
+                return;
+            }
+
+            addToEpoll(eventFd_, event_fd_tag, EPOLLIN);
+            addToEpoll(listenFd_, listen_fd_tag, EPOLLIN);
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~posix_pipe_server()
+        {
+            for (const auto &[id, spConnection] : connections_)
+            {
+                close(spConnection->fd);
+            }
+            closeListeningSocket(true);
+            for (const auto fd : { epollFd_, eventFd_ })
+            {
+                if (fd != -1)
+                {
+                    close(fd);
+                }
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        posix_pipe_server(const posix_pipe_server &)                = delete;
+        posix_pipe_server& operator =(const posix_pipe_server &)    = delete;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return epollFd_ != -1 && eventFd_ != -1 && listenFd_ != -1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool start()
+        {
+            if (!isValid())
+            {
+                return false;
+            }
+
+            running_ = true;
+            thread_ = std::thread([this]
+            {
+                run();
+            });
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool stop()
+        {
+            running_ = false;
+            signal();
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wait()
+        {
+            if (thread_.joinable())
+            {
+                thread_.join();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool send(connection_id id, const uint8_t *src, int64_t sizeInBytes)
+        {
+            if (sizeInBytes < 0 || sizeInBytes > int64_t(max_message_size))
+            {
+                vfs_errorf("Cannot send a message of %ld bytes, the maximum is %u", sizeInBytes, max_message_size);
+                return false;
+            }
+
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+            const auto it   = connections_.find(id);
+            if (it == connections_.end())
+            {
+                return false;
+            }
+
+            auto &c             = *it->second;
+            const auto header   = uint32_t(sizeInBytes);
+            auto bytesSent      = int64_t(0);
+
+            // Nothing queued, try to send it all right away without copying.
+            if (c.sendBuffer.empty())
+            {
+                iovec buffers[] = { { const_cast<uint32_t*>(&header), sizeof(header) }, { const_cast<uint8_t*>(src), size_t(sizeInBytes) } };
+                auto message        = msghdr{};
+                message.msg_iov     = buffers;
+                message.msg_iovlen  = 2;
+                bytesSent = sendmsg(c.fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (bytesSent == -1)
+                {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    {
+                        vfs_errorf("sendmsg() failed with error: %s", get_last_error_as_string(errno).c_str());
+                        shutdown(c.fd, SHUT_RDWR);
+                        return false;
+                    }
+                    bytesSent = 0;
+                }
+            }
+
+            // Queue the rest, the server thread sends it when the socket is writable again.
+            const auto pHeader = reinterpret_cast<const uint8_t*>(&header);
+            for (auto i = bytesSent; i < int64_t(sizeof(header)); ++i)
+            {
+                c.sendBuffer.push_back(pHeader[i]);
+            }
+            const auto bodyOffset = std::max(bytesSent - int64_t(sizeof(header)), int64_t(0));
+            c.sendBuffer.insert(c.sendBuffer.end(), src + bodyOffset, src + sizeInBytes);
+
+            return flushSendBuffer(c);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool disconnect(connection_id id)
+        {
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+            const auto it   = connections_.find(id);
+            if (it == connections_.end())
+            {
+                return false;
+            }
+
+            // The server thread gets a hang up event and closes the connection.
+            shutdown(it->second->fd, SHUT_RDWR);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t connectionCount() const
+        {
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+            return connections_.size();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Tags of the descriptors owned by the server in the epoll data, connection ids start after them.
+        static constexpr auto event_fd_tag          = connection_id(1);
+        static constexpr auto listen_fd_tag         = connection_id(2);
+        static constexpr auto first_connection_id   = connection_id(3);
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto max_epoll_events      = 64;
+        static constexpr auto message_header_size   = posix_pipe_message::header_size;
+        static constexpr auto max_message_size      = posix_pipe_message::max_size;
+        static constexpr auto receive_buffer_size   = int64_t(64 * 1024);
+
+        //------------------------------------------------------------------------------------------
+        struct connection
+        {
+            int32_t                 fd;
+            // Only used by the server thread, [receiveBegin, receiveEnd) is not consumed yet.
+            std::vector<uint8_t>    receiveBuffer;
+            int64_t                 receiveBegin;
+            int64_t                 receiveEnd;
+            // Protected by the mutex, [sendOffset, sendBuffer.size()) is not sent yet.
+            std::vector<uint8_t>    sendBuffer;
+            int64_t                 sendOffset;
+        };
+
+    private:
+        //------------------------------------------------------------------------------------------
+        bool addToEpoll(int32_t fd, connection_id tag, uint32_t events)
+        {
+            auto event      = epoll_event{};
+            event.events    = events;
+            event.data.u64  = tag;
+            if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) == -1)
+            {
+                vfs_errorf("epoll_ctl(EPOLL_CTL_ADD) failed with error: %s", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void closeListeningSocket(bool unlinkSocketFile)
+        {
+            if (listenFd_ != -1)
+            {
+                close(listenFd_);
+                listenFd_ = -1;
+                if (unlinkSocketFile)
+                {
+                    unlink(pipeName_.c_str());
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void signal()
+        {
+            const auto one = uint64_t(1);
+            if (eventFd_ != -1 && write(eventFd_, &one, sizeof(one)) == -1)
+            {
+                vfs_errorf("Could not signal the event to wake up the pipe server");
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void run()
+        {
+            auto events = std::array<epoll_event, max_epoll_events>{};
+
+            while (running_)
+            {
+                const auto eventCount = epoll_wait(epollFd_, events.data(), int32_t(events.size()), -1);
+                if (eventCount == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    vfs_errorf("epoll_wait() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return;
+                }
+
+                for (auto i = 0; i < eventCount && running_; ++i)
+                {
+                    const auto tag = events[i].data.u64;
+                    if (tag == event_fd_tag)
+                    {
+                        auto count = uint64_t(0);
+                        [[maybe_unused]] const auto bytesRead = read(eventFd_, &count, sizeof(count));
+                    }
+                    else if (tag == listen_fd_tag)
+                    {
+                        acceptClients();
+                    }
+                    else
+                    {
+                        serve(tag, events[i].events);
+                    }
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void acceptClients()
+        {
+            while (true)
+            {
+                const auto fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd == -1)
+                {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                    {
+                        continue;
+                    }
+                    if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    {
+                        vfs_errorf("accept4(%s) failed with error: %s", pipeName_.c_str(), get_last_error_as_string(errno).c_str());
+                    }
+                    return;
+                }
+
+                auto id = connection_id(0);
+                {
+                    const auto lock = std::lock_guard<std::mutex>(mutex_);
+                    id = nextConnectionId_++;
+                    connections_.emplace(id, std::make_shared<connection>(connection{ fd, {}, 0, 0, {}, 0 }));
+                }
+
+                if (onConnect_)
+                {
+                    onConnect_(id);
+                }
+
+                // Data sent before this point is reported right away.
+                if (!addToEpoll(fd, id, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET))
+                {
+                    closeConnection(id);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void serve(connection_id id, uint32_t events)
+        {
+            auto spConnection = std::shared_ptr<connection>{};
+            {
+                const auto lock = std::lock_guard<std::mutex>(mutex_);
+                const auto it   = connections_.find(id);
+                if (it == connections_.end())
+                {
+                    return;
+                }
+                spConnection = it->second;
+
+                if (events & EPOLLOUT)
+                {
+                    flushSendBuffer(*spConnection);
+                }
+            }
+
+            if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !receive(id, *spConnection))
+            {
+                closeConnection(id);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Reads until the socket is empty, as edge triggered events are not repeated. False once the
+        // connection is closed.
+        bool receive(connection_id id, connection &c)
+        {
+            while (true)
+            {
+                deliverMessages(id, c);
+
+                // Make room for at least the message being received.
+                const auto bufferedSize = c.receiveEnd - c.receiveBegin;
+                auto messageSize        = int64_t(0);
+                if (bufferedSize >= message_header_size)
+                {
+                    auto header = uint32_t(0);
+                    memcpy(&header, c.receiveBuffer.data() + c.receiveBegin, sizeof(header));
+                    messageSize = posix_pipe_message::size(header);
+                    if (messageSize > maxMessageSize_)
+                    {
+                        vfs_errorf("Message of %ld bytes is larger than the maximum of %ld bytes, closing the connection", messageSize, maxMessageSize_);
+                        return false;
+                    }
+                }
+                if (c.receiveBegin > 0)
+                {
+                    memmove(c.receiveBuffer.data(), c.receiveBuffer.data() + c.receiveBegin, bufferedSize);
+                    c.receiveBegin  = 0;
+                    c.receiveEnd    = bufferedSize;
+                }
+                const auto neededSize = std::max(message_header_size + messageSize, receive_buffer_size);
+                if (int64_t(c.receiveBuffer.size()) < neededSize)
+                {
+                    c.receiveBuffer.resize(neededSize);
+                }
+
+                const auto bytesReceived = recv(c.fd, c.receiveBuffer.data() + c.receiveEnd, c.receiveBuffer.size() - c.receiveEnd, 0);
+                if (bytesReceived == 0)
+                {
+                    // Connection closed by the client.
+                    return false;
+                }
+                if (bytesReceived == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        return true;
+                    }
+                    if (errno != ECONNRESET)
+                    {
+                        vfs_errorf("recv() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    }
+                    return false;
+                }
+
+                c.receiveEnd += bytesReceived;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deliverMessages(connection_id id, connection &c)
+        {
+            while (c.receiveEnd - c.receiveBegin >= message_header_size)
+            {
+                // Handles sent along with a message are not taken, recv() closes them and only the
+                // message is delivered.
+                auto header = uint32_t(0);
+                memcpy(&header, c.receiveBuffer.data() + c.receiveBegin, sizeof(header));
+                const auto messageSize = posix_pipe_message::size(header);
+                // Oversized messages are never delivered, receive() closes their connection.
+                if (messageSize > maxMessageSize_ || c.receiveEnd - c.receiveBegin < message_header_size + messageSize)
+                {
+                    return;
+                }
+
+                const auto pMessage = c.receiveBuffer.data() + c.receiveBegin + message_header_size;
+                c.receiveBegin += message_header_size + messageSize;
+                if (onMessage_)
+                {
+                    onMessage_(id, pMessage, messageSize);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called with the mutex held.
+        bool flushSendBuffer(connection &c)
+        {
+            while (c.sendOffset < int64_t(c.sendBuffer.size()))
+            {
+                const auto bytesSent = ::send(c.fd, c.sendBuffer.data() + c.sendOffset, c.sendBuffer.size() - c.sendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (bytesSent == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        return true;
+                    }
+                    vfs_errorf("send() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    shutdown(c.fd, SHUT_RDWR);
+                    return false;
+                }
+                c.sendOffset += bytesSent;
+            }
+
+            c.sendBuffer.clear();
+            c.sendOffset = 0;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void closeConnection(connection_id id)
+        {
+            {
+                const auto lock = std::lock_guard<std::mutex>(mutex_);
+                const auto it   = connections_.find(id);
+                if (it == connections_.end())
+                {
+                    return;
+                }
+                epoll_ctl(epollFd_, EPOLL_CTL_DEL, it->second->fd, nullptr);
+                close(it->second->fd);
+                connections_.erase(it);
+            }
+
+            if (onDisconnect_)
+            {
+                onDisconnect_(id);
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        path                                                            pipeName_;
+        std::atomic<bool>                                               running_;
+        connect_callback_t                                              onConnect_;
+        message_callback_t                                              onMessage_;
+        disconnect_callback_t                                           onDisconnect_;
+        int64_t                                                         maxMessageSize_;
+        int32_t                                                         epollFd_;
+        int32_t                                                         eventFd_;
+        int32_t                                                         listenFd_;
+        mutable std::mutex                                              mutex_;
+        std::unordered_map<connection_id, std::shared_ptr<connection>>  connections_;
+        connection_id                                                   nextConnectionId_;
+        std::thread                                                     thread_;
+    };
+
+} /*vfs*/
@@ -0,0 +1,624 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <vector>
+#include <coroutine>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "vfs/platform.hpp"
+#include "vfs/task.hpp"
+#include "vfs/posix_io_ring.hpp"
+#include "vfs/posix_watch_tree.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using reactor_impl = class posix_reactor;
+
+
+    //----------------------------------------------------------------------------------------------
+    // Runs coroutines on the thread calling run(). A coroutine waiting for a socket or an inotify
+    // descriptor is suspended until epoll reports it ready, file requests go through an io_uring
+    // ring that signals completions on the same epoll. Requests prepared during an iteration of the
+    // loop are submitted together.
+    class posix_reactor
+    {
+    protected:
+        //------------------------------------------------------------------------------------------
+        using native_handle = int32_t;
+        using event_watch   = posix_watch_tree;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        posix_reactor()
+            : epollFd_(-1)
+            , eventFd_(-1)
+            , liveTaskCount_(0)
+            , isStopRequested_(false)
+        {
+            epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd_ == -1)
+            {
+                vfs_errorf("epoll_create1() failed with error: %s", get_last_error_as_string(errno).c_str());
+                return;
+            }
+
+            // Wakes the loop up for tasks spawned from other threads, stop() and file completions.
+            eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            auto event      = epoll_event{};
+            event.events    = EPOLLIN;
+            event.data.fd   = eventFd_;
+            if (eventFd_ == -1 || epoll_ctl(epollFd_, EPOLL_CTL_ADD, eventFd_, &event) == -1 || !ring_.notifyCompletions(eventFd_))
+            {
+                vfs_errorf("Setting up the reactor wake up event failed with error: %s", get_last_error_as_string(errno).c_str());
+                close();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~posix_reactor()
+        {
+            // Requests in flight write to buffers and awaiters living in the frames of their tasks,
+            // wait for them before destroying the frames. Requests never submitted are dropped.
+            auto completions    = std::vector<io_completion>(max_events_per_wait);
+            auto isDrained      = true;
+            while (isDrained && ring_.inFlightCount() > 0)
+            {
+                isDrained = ring_.complete(completions.data(), int32_t(completions.size()), 1) != -1;
+            }
+
+            // Tasks still suspended are destroyed along with everything they await, or leaked if
+            // the kernel may still write to them.
+            if (isDrained)
+            {
+                for (const auto pFrame : rootTasks_)
+                {
+                    std::coroutine_handle<>::from_address(pFrame).destroy();
+                }
+            }
+            else
+            {
+                vfs_errorf("Could not wait for the requests in flight, %zu tasks are leaked", rootTasks_.size());
+            }
+            close();
+        }
+
+        //------------------------------------------------------------------------------------------
+        posix_reactor(const posix_reactor &)                = delete;
+        posix_reactor& operator =(const posix_reactor &)    = delete;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return epollFd_ != -1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void spawn(task<void> &&work)
+        {
+            auto handle = detach(std::move(work)).handle;
+            handle.promise().pReactor = this;
+            ++liveTaskCount_;
+            {
+                std::lock_guard<std::mutex> _(mutex_);
+                rootTasks_.insert(handle.address());
+                readyTasks_.push_back(handle);
+            }
+            wakeUp();
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool run()
+        {
+            vfs_check(isValid());
+
+            auto events         = std::vector<epoll_event>(max_events_per_wait);
+            auto completions    = std::vector<io_completion>(max_events_per_wait);
+            while (true)
+            {
+                resumeReadyTasks();
+                if (taskException_)
+                {
+                    std::rethrow_exception(std::exchange(taskException_, nullptr));
+                }
+                if (isStopRequested_.exchange(false) || liveTaskCount_ == 0)
+                {
+                    return true;
+                }
+
+                // What the kernel cannot take yet is submitted again once completions are reaped.
+                if (ring_.preparedCount() > 0 && ring_.submit() == -1)
+                {
+                    return false;
+                }
+
+                const auto eventCount = epoll_wait(epollFd_, events.data(), int32_t(events.size()), -1);
+                if (eventCount == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    vfs_errorf("epoll_wait() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return false;
+                }
+
+                for (auto i = 0; i < eventCount; ++i)
+                {
+                    if (events[i].data.fd == eventFd_)
+                    {
+                        auto count = uint64_t(0);
+                        [[maybe_unused]] const auto bytesRead = ::read(eventFd_, &count, sizeof(count));
+                        resumeCompletedRequests(completions);
+                    }
+                    else
+                    {
+                        resumeWaiters(events[i].data.fd, events[i].events);
+                    }
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void stop()
+        {
+            isStopRequested_ = true;
+            wakeUp();
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        // Resumes the awaiting coroutine once the descriptor is readable (or writable), its result
+        // is false if the descriptor cannot be waited for or was forgotten.
+        auto ready(native_handle handle, bool write)
+        {
+            return ready_awaiter{ this, handle, write, false, nullptr };
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Takes the descriptor out of the epoll, the coroutines waiting on it are resumed with false
+        // by the next iteration of the loop.
+        void forget(native_handle handle)
+        {
+            const auto it = waiters_.find(handle);
+            if (it == waiters_.end())
+            {
+                return;
+            }
+
+            if (it->second.isRegistered && epoll_ctl(epollFd_, EPOLL_CTL_DEL, handle, nullptr) == -1 && errno != ENOENT && errno != EBADF)
+            {
+                vfs_errorf("epoll_ctl(%d, EPOLL_CTL_DEL) failed with error: %s", handle, get_last_error_as_string(errno).c_str());
+            }
+
+            std::lock_guard<std::mutex> _(mutex_);
+            for (const auto pAwaiter : { it->second.pReader, it->second.pWriter })
+            {
+                if (pAwaiter != nullptr)
+                {
+                    pAwaiter->isArmed = false;
+                    readyTasks_.push_back(pAwaiter->awaiting);
+                }
+            }
+            waiters_.erase(it);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Reads or writes at an offset of a file, the result is the number of bytes transferred or
+        // -1 on error.
+        auto transferAt(native_handle handle, bool write, int64_t offset, uint8_t *pBuffer, int64_t sizeInBytes)
+        {
+            struct awaiter
+            {
+                posix_reactor               *pReactor;
+                native_handle               handle;
+                bool                        write;
+                int64_t                     offset;
+                uint8_t                     *pBuffer;
+                int64_t                     sizeInBytes;
+                int64_t                     result;
+                bool                        isQueued;
+                std::coroutine_handle<>     awaiting;
+
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                bool await_suspend(std::coroutine_handle<> awaitingCoroutine)
+                {
+                    awaiting            = awaitingCoroutine;
+                    const auto userData = uint64_t(reinterpret_cast<uintptr_t>(this));
+                    const auto isPrepared = write
+                        ? pReactor->ring_.prepareWrite(handle, offset, pBuffer, sizeInBytes, userData)
+                        : pReactor->ring_.prepareRead(handle, offset, pBuffer, sizeInBytes, userData);
+                    if (!isPrepared)
+                    {
+                        vfs_errorf("Could not queue a request of %ld bytes on descriptor %d", sizeInBytes, handle);
+                        return false;
+                    }
+                    isQueued = true;
+                    return true;
+                }
+
+                int64_t await_resume() noexcept
+                {
+                    if (!isQueued)
+                    {
+                        return -1;
+                    }
+                    if (result < 0)
+                    {
+                        vfs_errorf("%s(%d, %ld, %ld) failed with error: %s", write ? "write" : "read", handle, offset, sizeInBytes, get_last_error_as_string(int32_t(-result)).c_str());
+                        return -1;
+                    }
+                    return result;
+                }
+            };
+            return awaiter{ this, handle, write, offset, pBuffer, sizeInBytes, 0, false, nullptr };
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Receives sizeInBytes bytes from a socket, less if the peer closed it or on error.
+        task<int64_t> receive(native_handle handle, uint8_t *dst, int64_t sizeInBytes)
+        {
+            auto totalBytesReceived = int64_t(0);
+            while (totalBytesReceived < sizeInBytes)
+            {
+                const auto bytesReceived = recv(handle, dst + totalBytesReceived, size_t(sizeInBytes - totalBytesReceived), MSG_DONTWAIT);
+                if (bytesReceived > 0)
+                {
+                    totalBytesReceived += bytesReceived;
+                    continue;
+                }
+                if (bytesReceived == 0)
+                {
+                    // Connection closed by peer.
+                    break;
+                }
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    vfs_errorf("recv() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    break;
+                }
+                if (!co_await ready(handle, false))
+                {
+                    break;
+                }
+            }
+            co_return totalBytesReceived;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Sends sizeInBytes bytes on a socket, less on error.
+        task<int64_t> send(native_handle handle, const uint8_t *src, int64_t sizeInBytes)
+        {
+            auto totalBytesSent = int64_t(0);
+            while (totalBytesSent < sizeInBytes)
+            {
+                const auto bytesSent = ::send(handle, src + totalBytesSent, size_t(sizeInBytes - totalBytesSent), MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (bytesSent >= 0)
+                {
+                    totalBytesSent += bytesSent;
+                    continue;
+                }
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    vfs_errorf("send() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    break;
+                }
+                if (!co_await ready(handle, true))
+                {
+                    break;
+                }
+            }
+            co_return totalBytesSent;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Events are delivered as soon as they are read, there is no coalescing window.
+        std::unique_ptr<event_watch> watch(const path &dir, bool folders, bool files)
+        {
+            auto spWatch = std::make_unique<event_watch>(dir, event_watch::clock::duration(0), folders, files);
+            return spWatch->open() ? std::move(spWatch) : nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Waits for the next batch of events, empty on error.
+        task<std::vector<watch_event>> nextEvents(event_watch &watch)
+        {
+            auto events = std::vector<watch_event>{};
+            while (watch.readEvents())
+            {
+                watch.takeEvents(events);
+                if (!events.empty() || !co_await ready(watch.nativeHandle(), false))
+                {
+                    break;
+                }
+            }
+            co_return events;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto max_events_per_wait = 256;
+
+        //------------------------------------------------------------------------------------------
+        // Spawned tasks are wrapped in a coroutine that nothing awaits, it frees itself once done.
+        struct detached_task
+        {
+            struct promise_type
+            {
+                posix_reactor *pReactor = nullptr;
+
+                detached_task get_return_object()
+                {
+                    return detached_task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+                }
+
+                std::suspend_always initial_suspend() noexcept
+                {
+                    return {};
+                }
+
+                auto final_suspend() noexcept
+                {
+                    struct final_awaiter
+                    {
+                        bool await_ready() noexcept
+                        {
+                            return false;
+                        }
+
+                        void await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                        {
+                            handle.promise().pReactor->release(handle);
+                        }
+
+                        void await_resume() noexcept
+                        {}
+                    };
+                    return final_awaiter{};
+                }
+
+                void return_void()
+                {}
+
+                // The first exception is rethrown by run(), the task is done either way.
+                void unhandled_exception()
+                {
+                    if (!pReactor->taskException_)
+                    {
+                        pReactor->taskException_ = std::current_exception();
+                    }
+                }
+            };
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        //------------------------------------------------------------------------------------------
+        struct ready_awaiter
+        {
+            posix_reactor               *pReactor;
+            native_handle               handle;
+            bool                        write;
+            bool                        isArmed;
+            std::coroutine_handle<>     awaiting;
+
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> awaitingCoroutine)
+            {
+                awaiting    = awaitingCoroutine;
+                isArmed     = pReactor->waitFor(this);
+                return isArmed;
+            }
+
+            bool await_resume() noexcept
+            {
+                return isArmed;
+            }
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Descriptors are registered one shot, the coroutines waiting on them are resumed once.
+        struct waiters
+        {
+            ready_awaiter               *pReader = nullptr;
+            ready_awaiter               *pWriter = nullptr;
+            bool                        isRegistered = false;
+        };
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static detached_task detach(task<void> work)
+        {
+            co_await work;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void release(std::coroutine_handle<detached_task::promise_type> handle)
+        {
+            {
+                std::lock_guard<std::mutex> _(mutex_);
+                rootTasks_.erase(handle.address());
+            }
+            handle.destroy();
+            --liveTaskCount_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wakeUp()
+        {
+            const auto one = uint64_t(1);
+            if (eventFd_ != -1 && ::write(eventFd_, &one, sizeof(one)) == -1)
+            {
+                vfs_errorf("Could not signal the event to wake up the reactor");
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void close()
+        {
+            if (eventFd_ != -1)
+            {
+                ::close(eventFd_);
+                eventFd_ = -1;
+            }
+            if (epollFd_ != -1)
+            {
+                ::close(epollFd_);
+                epollFd_ = -1;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void resumeReadyTasks()
+        {
+            auto readyTasks = std::deque<std::coroutine_handle<>>{};
+            {
+                std::lock_guard<std::mutex> _(mutex_);
+                readyTasks.swap(readyTasks_);
+            }
+            for (const auto handle : readyTasks)
+            {
+                handle.resume();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void resumeCompletedRequests(std::vector<io_completion> &completions)
+        {
+            while (ring_.inFlightCount() > 0)
+            {
+                const auto count = ring_.complete(completions.data(), int32_t(completions.size()));
+                if (count <= 0)
+                {
+                    break;
+                }
+
+                for (auto i = 0; i < count; ++i)
+                {
+                    using request_awaiter = decltype(transferAt(0, false, 0, nullptr, 0));
+                    auto pRequest       = reinterpret_cast<request_awaiter*>(uintptr_t(completions[i].userData));
+                    pRequest->result    = completions[i].result;
+                    pRequest->awaiting.resume();
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool waitFor(ready_awaiter *pAwaiter)
+        {
+            auto &handleWaiters = waiters_[pAwaiter->handle];
+            (pAwaiter->write ? handleWaiters.pWriter : handleWaiters.pReader) = pAwaiter;
+            if (!arm(pAwaiter->handle, handleWaiters))
+            {
+                (pAwaiter->write ? handleWaiters.pWriter : handleWaiters.pReader) = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool arm(native_handle handle, waiters &handleWaiters)
+        {
+            auto event      = epoll_event{};
+            event.events    = uint32_t(EPOLLONESHOT) | (handleWaiters.pReader ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0u) | (handleWaiters.pWriter ? uint32_t(EPOLLOUT) : 0u);
+            event.data.fd   = handle;
+
+            // A descriptor closed since it was last armed left the epoll on its own.
+            if (handleWaiters.isRegistered && epoll_ctl(epollFd_, EPOLL_CTL_MOD, handle, &event) == 0)
+            {
+                return true;
+            }
+            if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, handle, &event) == 0 || (errno == EEXIST && epoll_ctl(epollFd_, EPOLL_CTL_MOD, handle, &event) == 0))
+            {
+                handleWaiters.isRegistered = true;
+                return true;
+            }
+
+            vfs_errorf("epoll_ctl(%d) failed with error: %s", handle, get_last_error_as_string(errno).c_str());
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void resumeWaiters(native_handle handle, uint32_t events)
+        {
+            const auto it = waiters_.find(handle);
+            if (it == waiters_.end())
+            {
+                return;
+            }
+
+            auto &handleWaiters = it->second;
+            auto pReader        = static_cast<ready_awaiter*>(nullptr);
+            auto pWriter        = static_cast<ready_awaiter*>(nullptr);
+            if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                pReader = std::exchange(handleWaiters.pReader, nullptr);
+            }
+            if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+            {
+                pWriter = std::exchange(handleWaiters.pWriter, nullptr);
+            }
+            // The registration is one shot, the other direction may still be waited for.
+            if (handleWaiters.pReader || handleWaiters.pWriter)
+            {
+                arm(handle, handleWaiters);
+            }
+
+            // Woken up coroutines try again, a wake up for a descriptor closed and reused meanwhile
+            // only costs them another wait.
+            if (pReader)
+            {
+                pReader->awaiting.resume();
+            }
+            if (pWriter)
+            {
+                pWriter->awaiting.resume();
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        int32_t                                                 epollFd_;
+        int32_t                                                 eventFd_;
+        posix_io_ring                                           ring_;
+        std::atomic<int64_t>                                    liveTaskCount_;
+        std::atomic<bool>                                       isStopRequested_;
+        // Thrown out of a spawned task, rethrown by run().
+        std::exception_ptr                                      taskException_;
+        std::unordered_map<native_handle, waiters>              waiters_;
+        // Guards what other threads touch through spawn().
+        std::mutex                                              mutex_;
+        std::deque<std::coroutine_handle<>>                     readyTasks_;
+        // Frames of the spawned tasks not done yet.
+        std::unordered_set<void*>                               rootTasks_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "vfs/platform.hpp"
+#include "vfs/path.hpp"
+#include "vfs/posix_watch_tree.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using recursive_watcher_impl = class posix_recursive_watcher;
+
+
+    //----------------------------------------------------------------------------------------------
+    // A single thread polls the inotify descriptor of the tree and an eventfd used to stop it or
+    // to flush the pending events early.
+    class posix_recursive_watcher
+    {
+        //------------------------------------------------------------------------------------------
+        using callback_t    = std::function<void(const std::vector<watch_event>&)>;
+        using clock         = posix_watch_tree::clock;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        template<typename R, typename P>
+        posix_recursive_watcher(const path &dir, std::chrono::duration<R, P> coalescingWindow, const callback_t &callback)
+            : running_(false)
+            , dir_(dir)
+            , coalescingWindow_(std::chrono::duration_cast<clock::duration>(coalescingWindow))
+            , callback_(callback)
+            , eventFd_(-1)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        ~posix_recursive_watcher()
+        {
+            if (eventFd_ != -1)
+            {
+                close(eventFd_);
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        posix_recursive_watcher(const posix_recursive_watcher &)                = delete;
+        posix_recursive_watcher& operator =(const posix_recursive_watcher &)    = delete;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool startWatching(bool folders, bool files)
+        {
+            if (callback_ == nullptr)
+            {
+                vfs_errorf("NULL callback specified to watcher %s", dir_.c_str());
+                return false;
+            }
+
+            spTree_ = std::make_unique<posix_watch_tree>(dir_, coalescingWindow_, folders, files);
+            if (!spTree_->open())
+            {
+                return false;
+            }
+
+            eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (eventFd_ == -1)
+            {
+                vfs_errorf("eventfd() failed with error: %s", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            running_ = true;
+            thread_ = std::thread([this]
+            {
+                run();
+            });
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool stopWatching()
+        {
+            running_ = false;
+            wakeUp();
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wakeUp()
+        {
+            if (eventFd_ != -1)
+            {
+                const auto one = uint64_t(1);
+                if (write(eventFd_, &one, sizeof(one)) == -1)
+                {
+                    vfs_errorf("Could not signal the event to wake up watcher %s", dir_.c_str());
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wait()
+        {
+            if (thread_.joinable())
+            {
+                thread_.join();
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void run()
+        {
+            auto events = std::vector<watch_event>{};
+            struct pollfd fds[] =
+            {
+                { spTree_->nativeHandle(),  POLLIN, 0 },
+                { eventFd_,                 POLLIN, 0 }
+            };
+
+            while (running_)
+            {
+                const auto deadline = spTree_->deadline();
+                auto timeoutInMs    = -1;
+                if (deadline != clock::time_point::max())
+                {
+                    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock::now()).count();
+                    timeoutInMs = int32_t(std::max<decltype(remaining)>(remaining, 0));
+                }
+
+                if (poll(fds, 2, timeoutInMs) == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    vfs_errorf("poll() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return;
+                }
+
+                auto flush = false;
+                if (fds[1].revents & POLLIN)
+                {
+                    auto count = uint64_t(0);
+                    flush = read(eventFd_, &count, sizeof(count)) == sizeof(count);
+                }
+
+                if ((fds[0].revents & POLLIN) && !spTree_->readEvents())
+                {
+                    return;
+                }
+
+                if (running_ && (flush || clock::now() >= spTree_->deadline()))
+                {
+                    spTree_->takeEvents(events);
+                    if (!events.empty())
+                    {
+                        callback_(events);
+                        events.clear();
+                    }
+                }
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        std::atomic<bool>                   running_;
+        path                                dir_;
+        clock::duration                     coalescingWindow_;
+        callback_t                          callback_;
+        std::unique_ptr<posix_watch_tree>   spTree_;
+        int32_t                             eventFd_;
+        std::thread                         thread_;
+    };
+
+} /*vfs*/
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "vfs/platform.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Moves data between two descriptors (files, sockets, pipes) with splice(). One end of a
+    // splice() must be a pipe, so the data goes through a kernel pipe kept by each thread: the pages
+    // are moved from the source to the pipe and from the pipe to the destination without ever being
+    // copied to user space.
+    class posix_transfer
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        // Both descriptors are read and written at their current position. Returns the number of
+        // bytes moved, less than sizeInBytes at the end of the source, on error or when splice() does
+        // not work between the two descriptors (a file opened with O_APPEND, a filesystem without
+        // splice support...) in which case isSupported is set to false. What was already taken from
+        // the source then reaches the destination through pBuffer.
+        static int64_t splice(int32_t srcFd, int32_t dstFd, int64_t sizeInBytes, bool &isSupported, uint8_t *pBuffer, int64_t bufferSize)
+        {
+            auto &pipe  = thread_pipe();
+            isSupported = pipe.isValid();
+
+            auto totalBytesMoved = int64_t(0);
+            while (isSupported && totalBytesMoved < sizeInBytes)
+            {
+                const auto bytesIn = ::splice(srcFd, nullptr, pipe.writeFd, nullptr, size_t(std::min(sizeInBytes - totalBytesMoved, pipe.capacity)), SPLICE_F_MOVE);
+                if (bytesIn == 0)
+                {
+                    // End of the source.
+                    break;
+                }
+                if (bytesIn == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno == EINVAL || errno == ENOSYS)
+                    {
+                        isSupported = false;
+                        break;
+                    }
+                    vfs_errorf("splice(%d) failed with error: %s", srcFd, get_last_error_as_string(errno).c_str());
+                    break;
+                }
+
+                const auto bytesOut = drain(pipe, dstFd, bytesIn, isSupported, pBuffer, bufferSize);
+                totalBytesMoved += bytesOut;
+                if (bytesOut < bytesIn)
+                {
+                    break;
+                }
+            }
+
+            return totalBytesMoved;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Pipes hold 64KB by default, larger ones move more per system call.
+        static constexpr auto pipe_size = int32_t(1024 * 1024);
+
+        //------------------------------------------------------------------------------------------
+        struct kernel_pipe
+        {
+            //--------------------------------------------------------------------------------------
+            kernel_pipe()
+            {
+                open();
+            }
+
+            //--------------------------------------------------------------------------------------
+            ~kernel_pipe()
+            {
+                close();
+            }
+
+            //--------------------------------------------------------------------------------------
+            bool isValid() const
+            {
+                return readFd != -1;
+            }
+
+            //--------------------------------------------------------------------------------------
+            void open()
+            {
+                int32_t fds[2];
+                if (pipe2(fds, O_CLOEXEC) == -1)
+                {
+                    vfs_errorf("pipe2() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return;
+                }
+                readFd  = fds[0];
+                writeFd = fds[1];
+
+                // Unprivileged processes are limited by /proc/sys/fs/pipe-max-size, keep the default size then.
+                fcntl(writeFd, F_SETPIPE_SZ, pipe_size);
+                capacity = std::max(int64_t(fcntl(writeFd, F_GETPIPE_SZ)), int64_t(4096));
+            }
+
+            //--------------------------------------------------------------------------------------
+            void close()
+            {
+                if (readFd != -1)
+                {
+                    ::close(readFd);
+                    ::close(writeFd);
+                }
+                readFd  = -1;
+                writeFd = -1;
+            }
+
+            //--------------------------------------------------------------------------------------
+            // Throws away whatever is left in the pipe.
+            void reset()
+            {
+                close();
+                open();
+            }
+
+            //--------------------------------------------------------------------------------------
+            int32_t readFd  = -1;
+            int32_t writeFd = -1;
+            int64_t capacity = 0;
+        };
+
+        //------------------------------------------------------------------------------------------
+        static kernel_pipe& thread_pipe()
+        {
+            thread_local auto pipe = kernel_pipe{};
+            return pipe;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Moves what the pipe holds to the destination. A destination splice() cannot write to
+        // gets it through a buffer, the pipe is emptied either way.
+        static int64_t drain(kernel_pipe &pipe, int32_t dstFd, int64_t sizeInBytes, bool &isSupported, uint8_t *pBuffer, int64_t bufferSize)
+        {
+            auto bytesMoved = int64_t(0);
+            while (bytesMoved < sizeInBytes)
+            {
+                const auto bytesOut = ::splice(pipe.readFd, nullptr, dstFd, nullptr, size_t(sizeInBytes - bytesMoved), SPLICE_F_MOVE);
+                if (bytesOut == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno == EINVAL || errno == ENOSYS)
+                    {
+                        isSupported = false;
+                        return bytesMoved + copy(pipe, dstFd, sizeInBytes - bytesMoved, pBuffer, bufferSize);
+                    }
+                    vfs_errorf("splice(%d) failed with error: %s", dstFd, get_last_error_as_string(errno).c_str());
+                    pipe.reset();
+                    return bytesMoved;
+                }
+                bytesMoved += bytesOut;
+            }
+            return bytesMoved;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Empties the pipe to the destination through the buffer, one chunk at a time.
+        static int64_t copy(kernel_pipe &pipe, int32_t dstFd, int64_t sizeInBytes, uint8_t *pBuffer, int64_t bufferSize)
+        {
+            auto totalBytesWritten = int64_t(0);
+            while (totalBytesWritten < sizeInBytes)
+            {
+                const auto bytesRead = ::read(pipe.readFd, pBuffer, size_t(std::min(sizeInBytes - totalBytesWritten, bufferSize)));
+                if (bytesRead <= 0)
+                {
+                    if (bytesRead == -1 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    pipe.reset();
+                    break;
+                }
+
+                for (auto bytesWritten = int64_t(0); bytesWritten < bytesRead;)
+                {
+                    const auto result = ::write(dstFd, pBuffer + bytesWritten, size_t(bytesRead - bytesWritten));
+                    if (result == -1)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        vfs_errorf("write(%d) failed with error: %s", dstFd, get_last_error_as_string(errno).c_str());
+                        // The rest of the chunk is lost, start again with an empty pipe.
+                        pipe.reset();
+                        return totalBytesWritten + bytesWritten;
+                    }
+                    bytesWritten += result;
+                }
+                totalBytesWritten += bytesRead;
+            }
+            return totalBytesWritten;
+        }
+    };
+
+} /*vfs*/
@@ -1,6 +1,15 @@
 #pragma once
 
+#include <cstdio>
+#include <vector>
+#include <algorithm>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+
+#include "vfs/logging.hpp"
+#include "vfs/virtual_allocator_interface.hpp"
 
 
 namespace vfs {
@@ -14,7 +23,8 @@ namespace vfs {
         //------------------------------------------------------------------------------------------
         static void* reserve(int64_t size)
         {
-            return mmap(nullptr, size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+            const auto pAddr = mmap(nullptr, size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+            return pAddr == MAP_FAILED ? nullptr : pAddr;
         }
         //------------------------------------------------------------------------------------------
         static void* commit(void *pAddr, int64_t size)
@@ -22,9 +32,134 @@ namespace vfs {
             return mprotect(pAddr, size, PROT_READ | PROT_WRITE) == 0 ? pAddr : nullptr;
         }
         //------------------------------------------------------------------------------------------
-        static bool deallocate(void *pAddr)
+        // Uses the mbind system call directly, libnuma is not required.
+        static void* commit(void *pAddr, int64_t size, numa_placement placement)
+        {
+            if (commit(pAddr, size) == nullptr)
+            {
+                return nullptr;
+            }
+
+            auto mode       = int32_t(MPOL_LOCAL);
+            auto nodeMask   = std::vector<unsigned long>{};
+            switch (placement.policy)
+            {
+            case numa_policy::local:
+                break;
+
+            case numa_policy::interleave:
+                mode        = MPOL_INTERLEAVE;
+                nodeMask    = online_numa_nodes();
+                break;
+
+            case numa_policy::bind:
+                if (placement.node < 0)
+                {
+                    vfs_errorf("Cannot bind memory to NUMA node %d", placement.node);
+                    return pAddr;
+                }
+                mode = MPOL_BIND;
+                nodeMask.resize(placement.node / bits_per_mask_word + 1, 0);
+                nodeMask[placement.node / bits_per_mask_word] |= 1ul << (placement.node % bits_per_mask_word);
+                break;
+            }
+
+            // The kernel reads one bit less than maxnode.
+            const auto maxNode = nodeMask.empty() ? 0ul : nodeMask.size() * bits_per_mask_word + 1;
+            if (syscall(SYS_mbind, pAddr, size, mode, nodeMask.empty() ? nullptr : nodeMask.data(), maxNode, 0) == -1)
+            {
+                vfs_errorf("mbind(%d) failed with error: %s", mode, get_last_error_as_string(errno).c_str());
+            }
+            return pAddr;
+        }
+        //------------------------------------------------------------------------------------------
+        // Gives the physical pages back right away, the range reads as zeros once committed again.
+        // MADV_FREE would only release them under memory pressure, which keeps RSS up until then.
+        static bool decommit(void *pAddr, int64_t size)
+        {
+            return madvise(pAddr, size, MADV_DONTNEED) == 0 && mprotect(pAddr, size, PROT_NONE) == 0;
+        }
+        //------------------------------------------------------------------------------------------
+        static bool deallocate(void *pAddr, int64_t size)
+        {
+            return munmap(pAddr, size) == 0;
+        }
+        //------------------------------------------------------------------------------------------
+        static int32_t numaNodeCount()
+        {
+            static const auto nodeCount = []()
+            {
+                const auto nodeMask = online_numa_nodes();
+                auto count          = int32_t(1);
+                for (auto i = 0u; i < nodeMask.size(); ++i)
+                {
+                    for (auto bit = 0; bit < bits_per_mask_word; ++bit)
+                    {
+                        if (nodeMask[i] & (1ul << bit))
+                        {
+                            count = std::max(count, int32_t(i * bits_per_mask_word + bit + 1));
+                        }
+                    }
+                }
+                return count;
+            }();
+            return nodeCount;
+        }
+        //------------------------------------------------------------------------------------------
+        static int32_t currentNumaNode()
         {
-            return munmap(pAddr, 0);
+            auto cpu    = 0u;
+            auto node   = 0u;
+            return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? int32_t(node) : 0;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto bits_per_mask_word = int32_t(sizeof(unsigned long) * 8);
+
+        //------------------------------------------------------------------------------------------
+        // Mask of the nodes listed in /sys/devices/system/node/online, as "0-1,3". Node 0 only if
+        // the kernel has no NUMA support.
+        static std::vector<unsigned long> online_numa_nodes()
+        {
+            auto nodeMask = std::vector<unsigned long>{ 1ul };
+
+            auto pFile = fopen("/sys/devices/system/node/online", "r");
+            if (pFile == nullptr)
+            {
+                return nodeMask;
+            }
+
+            nodeMask[0] = 0;
+            auto first  = 0;
+            auto last   = 0;
+            auto count  = 0;
+            while ((count = fscanf(pFile, "%d-%d", &first, &last)) >= 1)
+            {
+                if (count == 1)
+                {
+                    last = first;
+                }
+                for (auto node = first; node <= last && node >= 0; ++node)
+                {
+                    if (size_t(node / bits_per_mask_word) >= nodeMask.size())
+                    {
+                        nodeMask.resize(node / bits_per_mask_word + 1, 0);
+                    }
+                    nodeMask[node / bits_per_mask_word] |= 1ul << (node % bits_per_mask_word);
+                }
+                if (fgetc(pFile) != ',')
+                {
+                    break;
+                }
+            }
+            fclose(pFile);
+
+            if (nodeMask[0] == 0 && nodeMask.size() == 1)
+            {
+                nodeMask[0] = 1;
+            }
+            return nodeMask;
         }
     };
 
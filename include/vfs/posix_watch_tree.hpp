@@ -0,0 +1,357 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "vfs/platform.hpp"
+#include "vfs/path.hpp"
+#include "vfs/directory.hpp"
+#include "vfs/recursive_watcher_interface.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // inotify bookkeeping of a recursively watched directory, without any thread: the owner waits
+    // for nativeHandle() to be readable, calls readEvents() and hands the batch over with
+    // takeEvents() once deadline() is reached.
+    class posix_watch_tree
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using clock = std::chrono::steady_clock;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        posix_watch_tree(const path &dir, clock::duration coalescingWindow, bool folders, bool files)
+            : dir_(dir)
+            , coalescingWindow_(coalescingWindow)
+            , folders_(folders)
+            , files_(files)
+            , inotifyFd_(-1)
+            , eventBuffer_(event_buffer_size)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        ~posix_watch_tree()
+        {
+            if (inotifyFd_ != -1)
+            {
+                close(inotifyFd_);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        posix_watch_tree(const posix_watch_tree &)              = delete;
+        posix_watch_tree& operator =(const posix_watch_tree &)  = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool open()
+        {
+            inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotifyFd_ == -1)
+            {
+                vfs_errorf("inotify_init1() failed with error: %s", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+
+            return addWatches(dir_, false);
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t nativeHandle() const
+        {
+            return inotifyFd_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        const path& directory() const
+        {
+            return dir_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // When the pending events have to be delivered, clock::time_point::max() if there are none.
+        clock::time_point deadline() const
+        {
+            return pendingEvents_.empty() ? clock::time_point::max() : firstEventTime_ + coalescingWindow_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Reads everything available without blocking.
+        bool readEvents()
+        {
+            while (true)
+            {
+                const auto sizeReadInBytes = read(inotifyFd_, eventBuffer_.data(), eventBuffer_.size());
+                if (sizeReadInBytes == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno == EAGAIN)
+                    {
+                        return true;
+                    }
+
+                    vfs_errorf("read() of inotify file descriptor failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return false;
+                }
+
+                for (auto offset = ssize_t(0); offset < sizeReadInBytes;)
+                {
+                    const auto pEvent = reinterpret_cast<const struct inotify_event *>(eventBuffer_.data() + offset);
+                    handleEvent(*pEvent);
+                    offset += sizeof(struct inotify_event) + pEvent->len;
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Appends the coalesced pending events to events.
+        void takeEvents(std::vector<watch_event> &events)
+        {
+            for (auto &event : pendingEvents_)
+            {
+                if (event.kind == watch_event_kind::moved && event.entryPath.str().empty())
+                {
+                    // The other half never came, it was moved out of the tree.
+                    if (event.type == entry_type::directory)
+                    {
+                        removeWatches(event.previousPath);
+                    }
+                    event = watch_event{ watch_event_kind::deleted, event.type, std::move(event.previousPath), path{}, 0 };
+                }
+
+                const auto isReported = (event.kind == watch_event_kind::overflow) || (event.type == entry_type::directory ? folders_ : files_);
+                if (isReported)
+                {
+                    events.emplace_back(std::move(event));
+                }
+            }
+
+            pendingEvents_.clear();
+            lastEventIndices_.clear();
+            pendingMoves_.clear();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto watch_mask        = uint32_t(IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK);
+        static constexpr auto event_buffer_size = size_t(64 * 1024);
+
+        //------------------------------------------------------------------------------------------
+        void handleEvent(const struct inotify_event &event)
+        {
+            if (event.mask & IN_Q_OVERFLOW)
+            {
+                push(watch_event{ watch_event_kind::overflow, entry_type::directory, dir_, path{}, 0 });
+                return;
+            }
+
+            if (event.mask & IN_IGNORED)
+            {
+                // The directory was deleted, or its watch removed.
+                watches_.erase(event.wd);
+                return;
+            }
+
+            const auto it = watches_.find(event.wd);
+            if (it == watches_.end() || event.len == 0)
+            {
+                // Events about a watched directory itself are reported by its parent.
+                return;
+            }
+
+            const auto type = (event.mask & IN_ISDIR) ? entry_type::directory : entry_type::file;
+            auto entryPath  = path::combine(it->second, path(event.name));
+
+            if (event.mask & IN_CREATE)
+            {
+                onCreated(std::move(entryPath), type);
+            }
+            else if (event.mask & IN_DELETE)
+            {
+                push(watch_event{ watch_event_kind::deleted, type, std::move(entryPath), path{}, 0 });
+            }
+            else if (event.mask & IN_MODIFY)
+            {
+                const auto lastEvent = lastEventIndices_.find(entryPath.str());
+                const auto isAlreadyReported = lastEvent != lastEventIndices_.end() &&
+                    (pendingEvents_[lastEvent->second].kind == watch_event_kind::created || pendingEvents_[lastEvent->second].kind == watch_event_kind::modified);
+                if (!isAlreadyReported)
+                {
+                    push(watch_event{ watch_event_kind::modified, type, std::move(entryPath), path{}, 0 });
+                }
+            }
+            else if (event.mask & IN_MOVED_FROM)
+            {
+                // Completed by the IN_MOVED_TO with the same cookie, if it's still inside the tree.
+                pendingMoves_[event.cookie] = pendingEvents_.size();
+                push(watch_event{ watch_event_kind::moved, type, path{}, std::move(entryPath), event.cookie });
+            }
+            else if (event.mask & IN_MOVED_TO)
+            {
+                const auto move = pendingMoves_.find(event.cookie);
+                if (move == pendingMoves_.end())
+                {
+                    // Moved in from outside of the tree.
+                    onCreated(std::move(entryPath), type);
+                    return;
+                }
+
+                auto &movedEvent = pendingEvents_[move->second];
+                pendingMoves_.erase(move);
+
+                if (type == entry_type::directory)
+                {
+                    renameWatches(movedEvent.previousPath, entryPath);
+                }
+                lastEventIndices_[entryPath.str()] = uint32_t(&movedEvent - pendingEvents_.data());
+                movedEvent.entryPath = std::move(entryPath);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void push(watch_event &&event)
+        {
+            if (pendingEvents_.empty())
+            {
+                firstEventTime_ = clock::now();
+            }
+
+            if (!event.entryPath.str().empty())
+            {
+                lastEventIndices_[event.entryPath.str()] = uint32_t(pendingEvents_.size());
+            }
+            pendingEvents_.emplace_back(std::move(event));
+        }
+
+        //------------------------------------------------------------------------------------------
+        void pushCreated(path &&entryPath, entry_type type)
+        {
+            // A new directory can be reported both by its parent watch and by the scan in addWatches().
+            const auto lastEvent = lastEventIndices_.find(entryPath.str());
+            if (lastEvent == lastEventIndices_.end() || pendingEvents_[lastEvent->second].kind != watch_event_kind::created)
+            {
+                push(watch_event{ watch_event_kind::created, type, std::move(entryPath), path{}, 0 });
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void onCreated(path &&entryPath, entry_type type)
+        {
+            pushCreated(path(entryPath), type);
+
+            if (type == entry_type::directory)
+            {
+                // Its content may have been created before the watch was added.
+                addWatches(entryPath, true);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool addWatch(const path &dirPath)
+        {
+            const auto watchDescriptor = inotify_add_watch(inotifyFd_, dirPath.c_str(), watch_mask);
+            if (watchDescriptor == -1)
+            {
+                // Directories can disappear while they are being scanned.
+                if (errno != ENOENT && errno != ENOTDIR)
+                {
+                    vfs_errorf("inotify_add_watch(%s) failed with error: %s", dirPath.c_str(), get_last_error_as_string(errno).c_str());
+                }
+                return false;
+            }
+
+            watches_[watchDescriptor] = dirPath;
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Watches dirPath and everything below it, reporting the content as created if needed.
+        bool addWatches(const path &dirPath, bool reportContent)
+        {
+            if (!addWatch(dirPath))
+            {
+                return false;
+            }
+
+            directory::parallel_scan(dirPath, [](const directory_entry &) { return true; }, [&](const directory_entry &entry, path &entryPath)
+            {
+                if (entry.type == entry_type::directory)
+                {
+                    addWatch(entryPath);
+                }
+                if (reportContent)
+                {
+                    pushCreated(std::move(entryPath), (entry.type == entry_type::directory) ? entry_type::directory : entry_type::file);
+                }
+            }, scan_options{ .threadCount = 1 });
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static bool is_inside(const path &dirPath, const path &p)
+        {
+            const auto &dirStr  = dirPath.str();
+            const auto &str     = p.str();
+            return str.size() >= dirStr.size() && str.compare(0, dirStr.size(), dirStr) == 0 &&
+                   (str.size() == dirStr.size() || str[dirStr.size()] == path::separator()[0]);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void renameWatches(const path &oldPath, const path &newPath)
+        {
+            for (auto &[watchDescriptor, dirPath] : watches_)
+            {
+                if (is_inside(oldPath, dirPath))
+                {
+                    dirPath = path(newPath.str() + dirPath.str().substr(oldPath.str().size()));
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void removeWatches(const path &dirPath)
+        {
+            for (auto it = watches_.begin(); it != watches_.end();)
+            {
+                if (is_inside(dirPath, it->second))
+                {
+                    inotify_rm_watch(inotifyFd_, it->first);
+                    it = watches_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        path                                        dir_;
+        clock::duration                             coalescingWindow_;
+        bool                                        folders_;
+        bool                                        files_;
+        int32_t                                     inotifyFd_;
+        std::vector<uint8_t>                        eventBuffer_;
+        // Watch descriptor to the path of the watched directory.
+        std::unordered_map<int32_t, path>           watches_;
+        std::vector<watch_event>                    pendingEvents_;
+        clock::time_point                           firstEventTime_;
+        // Path to the index of its last pending event, used to merge repeated events.
+        std::unordered_map<path::string_type, uint32_t> lastEventIndices_;
+        // Cookie to the index of the IN_MOVED_FROM half of a move.
+        std::unordered_map<uint32_t, size_t>        pendingMoves_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
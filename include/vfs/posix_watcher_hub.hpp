@@ -0,0 +1,505 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "vfs/platform.hpp"
+#include "vfs/path.hpp"
+#include "vfs/posix_watch_tree.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using watcher_hub_impl = class posix_watcher_hub;
+
+
+    //----------------------------------------------------------------------------------------------
+    // One epoll loop for everything: a single inotify instance holds the watch of every plain watch
+    // (instances are limited to 128 per user by default, watches are not), each recursive watch adds
+    // the inotify instance of its tree, and an eventfd interrupts the wait to stop, wake up or take
+    // new watches and timeouts into account.
+    class posix_watcher_hub
+    {
+        //------------------------------------------------------------------------------------------
+        using callback_t        = std::function<void(const path&)>;
+        using batch_callback_t  = std::function<void(const std::vector<watch_event>&)>;
+        using task_t            = std::function<void()>;
+        using executor_t        = std::function<void(task_t&&)>;
+        using watch_id          = uint64_t;
+        using clock             = posix_watch_tree::clock;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        explicit posix_watcher_hub(const executor_t &executor)
+            : running_(false)
+            , executor_(executor)
+            , epollFd_(epoll_create1(EPOLL_CLOEXEC))
+            , inotifyFd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+            , eventFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+            , nextWatchId_(first_watch_id)
+        {
+            if (epollFd_ == -1 || inotifyFd_ == -1 || eventFd_ == -1)
+            {
+                vfs_errorf("Could not create the descriptors of the watcher hub, error: %s", get_last_error_as_string(errno).c_str());
+                return;
+            }
+
+            addToEpoll(eventFd_, event_fd_tag);
+            addToEpoll(inotifyFd_, inotify_fd_tag);
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~posix_watcher_hub()
+        {
+            for (const auto fd : { epollFd_, inotifyFd_, eventFd_ })
+            {
+                if (fd != -1)
+                {
+                    close(fd);
+                }
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        posix_watcher_hub(const posix_watcher_hub &)                = delete;
+        posix_watcher_hub& operator =(const posix_watcher_hub &)    = delete;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool start()
+        {
+            if (epollFd_ == -1 || inotifyFd_ == -1 || eventFd_ == -1)
+            {
+                return false;
+            }
+
+            running_ = true;
+            thread_ = std::thread([this]
+            {
+                run();
+            });
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool stop()
+        {
+            running_ = false;
+            signal();
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wait()
+        {
+            if (thread_.joinable())
+            {
+                thread_.join();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        watch_id addWatch(const path &dir, bool folders, bool files, const callback_t &callback, std::chrono::milliseconds waitTimeout)
+        {
+            if (callback == nullptr)
+            {
+                vfs_errorf("NULL callback specified to watcher %s", dir.c_str());
+                return invalid_watch_id;
+            }
+
+            // Every plain watch uses the same mask, so several watches of the same directory can share
+            // its watch descriptor. Added under the lock, removing the last other watch of the
+            // directory meanwhile would remove the descriptor this one gets.
+            const auto lock             = std::lock_guard<std::mutex>(mutex_);
+            const auto watchDescriptor  = inotify_add_watch(inotifyFd_, dir.c_str(), watch_mask);
+            if (watchDescriptor == -1)
+            {
+                vfs_errorf("inotify_add_watch(%s) failed with error: %s", dir.c_str(), get_last_error_as_string(errno).c_str());
+                return invalid_watch_id;
+            }
+
+            const auto id = nextWatchId_++;
+            watches_.emplace(id, watch{ dir, folders, files, callback, waitTimeout, clock::now() + waitTimeout, watchDescriptor });
+            watchDescriptors_[watchDescriptor].push_back(id);
+
+            // Like vfs::watcher, report what is already there.
+            wakeUps_.push_back(id);
+            signal();
+            return id;
+        }
+
+        //------------------------------------------------------------------------------------------
+        watch_id addRecursiveWatch(const path &dir, bool folders, bool files, const batch_callback_t &callback, std::chrono::milliseconds coalescingWindow)
+        {
+            if (callback == nullptr)
+            {
+                vfs_errorf("NULL callback specified to watcher %s", dir.c_str());
+                return invalid_watch_id;
+            }
+
+            auto spTree = std::make_unique<posix_watch_tree>(dir, coalescingWindow, folders, files);
+            if (!spTree->open())
+            {
+                return invalid_watch_id;
+            }
+
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+            const auto id   = nextWatchId_++;
+            if (!addToEpoll(spTree->nativeHandle(), id))
+            {
+                return invalid_watch_id;
+            }
+            recursiveWatches_.emplace(id, recursive_watch{ callback, std::move(spTree) });
+            return id;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool removeWatch(watch_id id)
+        {
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+
+            if (const auto it = watches_.find(id); it != watches_.end())
+            {
+                // The descriptor is gone already if the directory was deleted.
+                if (const auto descriptor = watchDescriptors_.find(it->second.watchDescriptor); descriptor != watchDescriptors_.end())
+                {
+                    auto &ids = descriptor->second;
+                    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+                    if (ids.empty())
+                    {
+                        inotify_rm_watch(inotifyFd_, descriptor->first);
+                        watchDescriptors_.erase(descriptor);
+                    }
+                }
+                watches_.erase(it);
+                return true;
+            }
+
+            if (const auto it = recursiveWatches_.find(id); it != recursiveWatches_.end())
+            {
+                epoll_ctl(epollFd_, EPOLL_CTL_DEL, it->second.spTree->nativeHandle(), nullptr);
+                recursiveWatches_.erase(it);
+                return true;
+            }
+
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wakeUp(watch_id id)
+        {
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+            wakeUps_.push_back(id);
+            signal();
+        }
+
+        //------------------------------------------------------------------------------------------
+        size_t watchCount() const
+        {
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+            return watches_.size() + recursiveWatches_.size();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto invalid_watch_id  = watch_id(0);
+        // Tags of the descriptors owned by the hub in the epoll data, watch ids start after them.
+        static constexpr auto event_fd_tag      = watch_id(1);
+        static constexpr auto inotify_fd_tag    = watch_id(2);
+        static constexpr auto first_watch_id    = watch_id(3);
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto watch_mask        = uint32_t(IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_ONLYDIR);
+        static constexpr auto max_epoll_events  = 64;
+
+        //------------------------------------------------------------------------------------------
+        struct watch
+        {
+            path                        dir;
+            bool                        folders;
+            bool                        files;
+            callback_t                  callback;
+            std::chrono::milliseconds   waitTimeout;
+            clock::time_point           nextTimeout;
+            int32_t                     watchDescriptor;
+        };
+
+        //------------------------------------------------------------------------------------------
+        struct recursive_watch
+        {
+            batch_callback_t                    callback;
+            std::unique_ptr<posix_watch_tree>   spTree;
+        };
+
+    private:
+        //------------------------------------------------------------------------------------------
+        bool addToEpoll(int32_t fd, watch_id tag)
+        {
+            auto event      = epoll_event{};
+            event.events    = EPOLLIN;
+            event.data.u64  = tag;
+            if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) == -1)
+            {
+                vfs_errorf("epoll_ctl(EPOLL_CTL_ADD) failed with error: %s", get_last_error_as_string(errno).c_str());
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void signal()
+        {
+            const auto one = uint64_t(1);
+            if (eventFd_ != -1 && write(eventFd_, &one, sizeof(one)) == -1)
+            {
+                vfs_errorf("Could not signal the event to wake up the watcher hub");
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void dispatch(task_t &&task)
+        {
+            if (executor_)
+            {
+                executor_(std::move(task));
+            }
+            else
+            {
+                task();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void run()
+        {
+            auto tasks  = std::vector<task_t>{};
+            auto events = std::array<epoll_event, max_epoll_events>{};
+
+            while (running_)
+            {
+                const auto eventCount = epoll_wait(epollFd_, events.data(), int32_t(events.size()), timeoutInMs());
+                if (eventCount == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    vfs_errorf("epoll_wait() failed with error: %s", get_last_error_as_string(errno).c_str());
+                    return;
+                }
+
+                {
+                    const auto lock = std::lock_guard<std::mutex>(mutex_);
+
+                    for (auto i = 0; i < eventCount; ++i)
+                    {
+                        const auto tag = events[i].data.u64;
+                        if (tag == event_fd_tag)
+                        {
+                            auto count = uint64_t(0);
+                            [[maybe_unused]] const auto bytesRead = read(eventFd_, &count, sizeof(count));
+                        }
+                        else if (tag == inotify_fd_tag)
+                        {
+                            readEvents();
+                        }
+                        else if (const auto it = recursiveWatches_.find(tag); it != recursiveWatches_.end())
+                        {
+                            it->second.spTree->readEvents();
+                        }
+                    }
+
+                    collectDueTasks(tasks);
+                }
+
+                if (!running_)
+                {
+                    break;
+                }
+
+                // Outside of the lock so that callbacks can add and remove watches.
+                for (auto &task : tasks)
+                {
+                    dispatch(std::move(task));
+                }
+                tasks.clear();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t timeoutInMs() const
+        {
+            const auto lock = std::lock_guard<std::mutex>(mutex_);
+
+            auto deadline = clock::time_point::max();
+            for (const auto &[id, w] : watches_)
+            {
+                if (w.waitTimeout.count() > 0)
+                {
+                    deadline = std::min(deadline, w.nextTimeout);
+                }
+            }
+            for (const auto &[id, w] : recursiveWatches_)
+            {
+                deadline = std::min(deadline, w.spTree->deadline());
+            }
+
+            if (deadline == clock::time_point::max())
+            {
+                return -1;
+            }
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock::now()).count();
+            return int32_t(std::max<decltype(remaining)>(remaining, 0));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Reads the events of the plain watches, a watch gets at most one call per read.
+        void readEvents()
+        {
+            auto changedWatches = std::vector<watch_id>{};
+
+            while (true)
+            {
+                const auto sizeReadInBytes = read(inotifyFd_, eventBuffer_.data(), eventBuffer_.size());
+                if (sizeReadInBytes == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno != EAGAIN)
+                    {
+                        vfs_errorf("read() of inotify file descriptor failed with error: %s", get_last_error_as_string(errno).c_str());
+                    }
+                    break;
+                }
+
+                for (auto offset = ssize_t(0); offset < sizeReadInBytes;)
+                {
+                    const auto pEvent = reinterpret_cast<const struct inotify_event *>(eventBuffer_.data() + offset);
+                    offset += sizeof(struct inotify_event) + pEvent->len;
+
+                    const auto it = watchDescriptors_.find(pEvent->wd);
+                    if (it == watchDescriptors_.end())
+                    {
+                        continue;
+                    }
+
+                    if (pEvent->mask & IN_IGNORED)
+                    {
+                        // The watched directory was deleted, its watches keep waiting for their timeouts.
+                        for (const auto id : it->second)
+                        {
+                            watches_.at(id).watchDescriptor = -1;
+                        }
+                        watchDescriptors_.erase(it);
+                        continue;
+                    }
+
+                    for (const auto id : it->second)
+                    {
+                        const auto &w = watches_.at(id);
+                        const auto isReported = (pEvent->mask & IN_ISDIR) ? w.folders : (w.files && pEvent->len != 0);
+                        if (isReported)
+                        {
+                            changedWatches.push_back(id);
+                        }
+                    }
+                }
+            }
+
+            std::sort(changedWatches.begin(), changedWatches.end());
+            changedWatches.erase(std::unique(changedWatches.begin(), changedWatches.end()), changedWatches.end());
+            wakeUps_.insert(wakeUps_.end(), changedWatches.begin(), changedWatches.end());
+        }
+
+        //------------------------------------------------------------------------------------------
+        void collectDueTasks(std::vector<task_t> &tasks)
+        {
+            const auto now = clock::now();
+
+            for (auto &[id, w] : watches_)
+            {
+                if (w.waitTimeout.count() > 0 && now >= w.nextTimeout)
+                {
+                    wakeUps_.push_back(id);
+                }
+            }
+
+            std::sort(wakeUps_.begin(), wakeUps_.end());
+            wakeUps_.erase(std::unique(wakeUps_.begin(), wakeUps_.end()), wakeUps_.end());
+
+            for (const auto id : wakeUps_)
+            {
+                if (auto it = watches_.find(id); it != watches_.end())
+                {
+                    it->second.nextTimeout = now + it->second.waitTimeout;
+                    tasks.emplace_back([callback = it->second.callback, dir = it->second.dir]
+                    {
+                        callback(dir);
+                    });
+                }
+                else if (auto it = recursiveWatches_.find(id); it != recursiveWatches_.end())
+                {
+                    pushEvents(it->second, tasks);
+                }
+            }
+            wakeUps_.clear();
+
+            for (auto &[id, w] : recursiveWatches_)
+            {
+                if (now >= w.spTree->deadline())
+                {
+                    pushEvents(w, tasks);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void pushEvents(recursive_watch &w, std::vector<task_t> &tasks)
+        {
+            auto events = std::vector<watch_event>{};
+            w.spTree->takeEvents(events);
+            if (!events.empty())
+            {
+                tasks.emplace_back([callback = w.callback, events = std::move(events)]
+                {
+                    callback(events);
+                });
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        std::atomic<bool>                                       running_;
+        executor_t                                              executor_;
+        int32_t                                                 epollFd_;
+        int32_t                                                 inotifyFd_;
+        int32_t                                                 eventFd_;
+        std::thread                                             thread_;
+        mutable std::mutex                                      mutex_;
+        watch_id                                                nextWatchId_;
+        std::unordered_map<watch_id, watch>                     watches_;
+        std::unordered_map<watch_id, recursive_watch>           recursiveWatches_;
+        // Watch descriptor to the plain watches of that directory.
+        std::unordered_map<int32_t, std::vector<watch_id>>      watchDescriptors_;
+        // Watches to call on the next iteration.
+        std::vector<watch_id>                                   wakeUps_;
+        alignas(struct inotify_event) std::array<uint8_t, 64 * 1024> eventBuffer_;
+    };
+
+} /*vfs*/
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "vfs/platform.hpp"
+
+// Reactor interface
+#include "vfs/task.hpp"
+#include "vfs/reactor_interface.hpp"
+// Platform specific implementations
+#if VFS_PLATFORM_POSIX
+#   include "vfs/posix_reactor.hpp"
+#else
+#	error No reactor implementation defined for the current platform
+#endif
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    using reactor = reactor_interface<reactor_impl>;
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "vfs/path.hpp"
+#include "vfs/task.hpp"
+#include "vfs/file.hpp"
+#include "vfs/pipe.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Runs thousands of I/O coroutines on the thread calling run(): pipe reads, writes and accepts
+    // wait for the socket to be ready, file reads and writes are batched to the kernel, watched
+    // directories deliver their events as they come. Everything but spawn() and stop() must be
+    // called from the thread running the reactor, each thread runs its own reactor.
+    //
+    //     reactor.spawn([&]() -> task<> { auto size = co_await reactor.read(*spPipe, buffer, 4); ... }());
+    //     reactor.run();
+    template<typename _Impl>
+    class reactor_interface
+        : _Impl
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using base_type = _Impl;
+        using self_type = reactor_interface<_Impl>;
+
+        //------------------------------------------------------------------------------------------
+        using native_handle = typename base_type::native_handle;
+        using event_watch   = typename base_type::event_watch;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        reactor_interface() = default;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return base_type::isValid();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Runs the spawned tasks until they are all done or stop() is called. Returns false on error.
+        // An exception escaping a spawned task ends that task and is rethrown here, the other tasks
+        // stay suspended and the next run() resumes them. Only the first one is kept when several
+        // tasks throw before run() gets to rethrow.
+        bool run()
+        {
+            return base_type::run();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Makes run() return, from any thread. Suspended tasks are resumed by the next run().
+        void stop()
+        {
+            base_type::stop();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Starts a task nothing awaits on the reactor thread, from any thread. Tasks still
+        // suspended when the reactor is destroyed are destroyed with it, once the file requests
+        // they are waiting for are done.
+        void spawn(task<void> &&work)
+        {
+            base_type::spawn(std::move(work));
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Resumes the awaiting coroutine once the handle can be read (written) without blocking.
+        // The result is false if the handle cannot be waited for or was forgotten.
+        auto readable(native_handle handle)
+        {
+            return base_type::ready(handle, false);
+        }
+
+        //------------------------------------------------------------------------------------------
+        auto writable(native_handle handle)
+        {
+            return base_type::ready(handle, true);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Must be called before closing a handle coroutines may be waiting for: they are resumed
+        // with false, pipe reads and writes return what they transferred so far. Once closed, a
+        // handle is never reported ready again and its waiters would keep run() from returning.
+        void forget(native_handle handle)
+        {
+            base_type::forget(handle);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Reads sizeInBytes bytes from a connected pipe. Returns less if the other end closed the
+        // pipe, or on error.
+        task<int64_t> read(pipe_stream &pipe, uint8_t *dst, int64_t sizeInBytes)
+        {
+            // Bytes message reads took ahead of time come first.
+            auto totalBytesRead = int64_t(0);
+            if (pipe.bufferedBytesToRead() > 0)
+            {
+                totalBytesRead = pipe.read(dst, std::min(pipe.bufferedBytesToRead(), sizeInBytes));
+            }
+            co_return totalBytesRead + co_await base_type::receive(pipe.nativeHandle(), dst + totalBytesRead, sizeInBytes - totalBytesRead);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Writes sizeInBytes bytes to a connected pipe. Returns less on error.
+        task<int64_t> write(pipe_stream &pipe, const uint8_t *src, int64_t sizeInBytes)
+        {
+            return base_type::send(pipe.nativeHandle(), src, sizeInBytes);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Waits for a client to connect to a pipe created with create_named_pipe().
+        task<bool> accept(pipe_stream &server)
+        {
+            co_return co_await readable(server.listeningHandle()) && server.waitForConnection();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Reads up to sizeInBytes bytes at offset of a file, the file position is left untouched.
+        // Returns the number of bytes read or -1 on error.
+        auto readAt(file_stream &file, int64_t offset, uint8_t *dst, int64_t sizeInBytes)
+        {
+            return base_type::transferAt(file.nativeHandle(), false, offset, dst, sizeInBytes);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns the number of bytes written or -1 on error.
+        auto writeAt(file_stream &file, int64_t offset, const uint8_t *src, int64_t sizeInBytes)
+        {
+            return base_type::transferAt(file.nativeHandle(), true, offset, const_cast<uint8_t*>(src), sizeInBytes);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Watches a directory tree for nextEvents(), nullptr on error.
+        std::unique_ptr<event_watch> watch(const path &dir, bool folders = true, bool files = true)
+        {
+            return base_type::watch(dir, folders, files);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Waits for the next changes in the watched tree, empty on error.
+        task<std::vector<watch_event>> nextEvents(event_watch &watch)
+        {
+            return base_type::nextEvents(watch);
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <functional>
+
+#include "vfs/path.hpp"
+#include "vfs/file_flags.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    enum class watch_event_kind : uint8_t
+    {
+        created,
+        deleted,
+        modified,
+        moved,
+        // The system dropped events, the watched tree has to be scanned again.
+        overflow
+    };
+
+    //----------------------------------------------------------------------------------------------
+    struct watch_event
+    {
+        watch_event_kind    kind;
+        entry_type          type;
+        path                entryPath;
+        // Source of a move, empty for other kinds.
+        path                previousPath;
+        // Identifies both halves of a move, 0 for other kinds.
+        uint32_t            cookie;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // Watches a directory and all its subdirectories, new subdirectories are watched as soon as they
+    // appear. Events are gathered for coalescingWindow after the first one and delivered as one batch
+    // in which repeated modifications are merged and both halves of a move are paired.
+    template<typename _Impl>
+    class recursive_watcher_interface
+        : _Impl
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using callback_t = std::function<void(const std::vector<watch_event>&)>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        using base_type = _Impl;
+        using self_type = recursive_watcher_interface<_Impl>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        template<typename R, typename P>
+        recursive_watcher_interface(const path &dir, std::chrono::duration<R,P> coalescingWindow, const callback_t &callback)
+            : base_type(dir, coalescingWindow, callback)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        recursive_watcher_interface(const path &dir, const callback_t &callback)
+            : base_type(dir, std::chrono::milliseconds(0), callback)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        ~recursive_watcher_interface()
+        {
+            stopWatching();
+            wait();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool startWatching(bool folders, bool files)
+        {
+            return base_type::startWatching(folders, files);
+        }
+        //------------------------------------------------------------------------------------------
+        bool stopWatching()
+        {
+            return base_type::stopWatching();
+        }
+        //------------------------------------------------------------------------------------------
+        // Delivers the pending events without waiting for the end of the coalescing window.
+        void wakeUp()
+        {
+            return base_type::wakeUp();
+        }
+        //------------------------------------------------------------------------------------------
+        void wait()
+        {
+            return base_type::wait();
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
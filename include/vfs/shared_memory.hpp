@@ -14,17 +14,29 @@ namespace vfs {
     //----------------------------------------------------------------------------------------------
 
     //----------------------------------------------------------------------------------------------
-    inline auto create_shared_memory(const path &name, int64_t size)
+    inline auto create_shared_memory(const path &name, int64_t size, mapping_flags mappingFlags = mapping_flags::none)
     {
-        return shared_memory_sptr(new shared_memory_stream(name, size, false));
+        return shared_memory_sptr(new shared_memory_stream(name, size, false, mappingFlags));
     }
     //----------------------------------------------------------------------------------------------
 
     //----------------------------------------------------------------------------------------------
-    inline auto open_shared_memory(const path &name, int64_t viewSize = 0)
+    // Memory created with mapping_flags::huge_pages must be opened with it too.
+    inline auto open_shared_memory(const path &name, int64_t viewSize = 0, mapping_flags mappingFlags = mapping_flags::none)
     {
-        return shared_memory_sptr(new shared_memory_stream(name, viewSize, true));
+        return shared_memory_sptr(new shared_memory_stream(name, viewSize, true, mappingFlags));
     }
     //----------------------------------------------------------------------------------------------
 
+#if VFS_PLATFORM_POSIX
+    //----------------------------------------------------------------------------------------------
+    // Shared memory without a name, nothing else can open it. Another process maps it once its
+    // handle is sent with pipe_interface::writeHandle(), see open_view_from_handle().
+    inline auto create_anonymous_shared_memory(int64_t size, mapping_flags mappingFlags = mapping_flags::none)
+    {
+        return shared_memory_sptr(new shared_memory_stream(size, mappingFlags));
+    }
+    //----------------------------------------------------------------------------------------------
+#endif
+
 } /*vfs*/
@@ -0,0 +1,563 @@
+#pragma once
+
+#include <bit>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+
+#include "vfs/platform.hpp"
+#include "vfs/shared_memory.hpp"
+#include "vfs/posix_futex.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Beginning of the shared memory of a ring. The positions only ever grow, each one and the futex
+    // word signaling it live on the cache line of the side writing them, so producers and consumers
+    // don't invalidate each other's lines on every operation.
+    struct shm_ring_header
+    {
+        //------------------------------------------------------------------------------------------
+        static constexpr auto cache_line_size   = size_t(64);
+        // "vfs_ring", only written once the ring is fully initialized.
+        static constexpr auto magic_value       = uint64_t(0x676e69725f736676);
+
+        //------------------------------------------------------------------------------------------
+        std::atomic<uint64_t>                           magic;
+        uint64_t                                        capacity;
+        // 0 for a ring of variable length records.
+        uint64_t                                        elementSize;
+
+        // Written by producers.
+        alignas(cache_line_size) std::atomic<uint64_t>  tail;
+        std::atomic<uint32_t>                           dataSignal;
+
+        // Written by consumers.
+        alignas(cache_line_size) std::atomic<uint64_t>  head;
+        std::atomic<uint32_t>                           spaceSignal;
+
+        // Only written by sleepers, so the fast path can skip the futex wake up system call.
+        alignas(cache_line_size) std::atomic<uint32_t>  dataWaiters;
+        std::atomic<uint32_t>                           spaceWaiters;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Positions shared between processes must be lock free");
+
+
+    //----------------------------------------------------------------------------------------------
+    // Maps the header and the slots of a ring in shared memory, and implements the waiting shared by
+    // both kinds of rings.
+    class shm_ring_base
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using clock = std::chrono::steady_clock;
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        // Busy checks before going to sleep, a waiting peer usually answers within that time.
+        static constexpr auto spin_count    = 256;
+        static constexpr auto data_offset   = int64_t((sizeof(shm_ring_header) + shm_ring_header::cache_line_size - 1) & ~(shm_ring_header::cache_line_size - 1));
+
+        //------------------------------------------------------------------------------------------
+        shm_ring_base(const path &name, uint64_t capacity, uint64_t slotSize, uint64_t elementSize, bool openExisting)
+            : pHeader_(nullptr)
+            , pData_(nullptr)
+            , mask_(0)
+        {
+            if (openExisting)
+            {
+                spMemory_ = open_shared_memory(name);
+                if (!spMemory_->isValid() || spMemory_->totalSize() < data_offset)
+                {
+                    return;
+                }
+
+                auto pHeader = spMemory_->cursor<shm_ring_header>();
+                if (pHeader->magic.load(std::memory_order_acquire) != shm_ring_header::magic_value)
+                {
+                    vfs_errorf("Shared memory %s is not an initialized ring", name.c_str());
+                    return;
+                }
+                if (pHeader->elementSize != elementSize || spMemory_->totalSize() < data_offset + int64_t(pHeader->capacity * slotSize))
+                {
+                    vfs_errorf("Shared memory %s does not hold a ring of elements of %lu bytes", name.c_str(), elementSize);
+                    return;
+                }
+
+                capacity = pHeader->capacity;
+            }
+            else
+            {
+                if (capacity == 0)
+                {
+                    vfs_errorf("Cannot create the empty ring %s", name.c_str());
+                    return;
+                }
+
+                capacity    = std::bit_ceil(capacity);
+                spMemory_   = create_shared_memory(name, data_offset + int64_t(capacity * slotSize));
+                if (!spMemory_->isValid())
+                {
+                    return;
+                }
+
+                // The memory is zero filled, the magic is stored by publish() once the slots are ready.
+                auto pHeader            = spMemory_->cursor<shm_ring_header>();
+                pHeader->capacity       = capacity;
+                pHeader->elementSize    = elementSize;
+            }
+
+            pHeader_    = spMemory_->cursor<shm_ring_header>();
+            pData_      = spMemory_->cursor() + data_offset;
+            mask_       = capacity - 1;
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return pHeader_ != nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        uint64_t capacity() const
+        {
+            return mask_ + 1;
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        void publish()
+        {
+            pHeader_->magic.store(shm_ring_header::magic_value, std::memory_order_release);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called after making data or space available. The read-modify-write orders the position
+        // update before the waiter count is read, pairing with the increment in waitUntil().
+        static void notify(std::atomic<uint32_t> &signal, std::atomic<uint32_t> &waiters, int32_t count)
+        {
+            signal.fetch_add(1, std::memory_order_seq_cst);
+            if (waiters.load(std::memory_order_seq_cst) > 0)
+            {
+                posix_futex_wake(signal, count);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Retries tryOperation until it succeeds or the deadline is reached, sleeping on signal in between.
+        template<typename F>
+        static bool waitUntil(std::atomic<uint32_t> &signal, std::atomic<uint32_t> &waiters, clock::time_point deadline, F &&tryOperation)
+        {
+            for (auto i = 0; i < spin_count; ++i)
+            {
+                if (tryOperation())
+                {
+                    return true;
+                }
+            }
+
+            while (true)
+            {
+                waiters.fetch_add(1, std::memory_order_seq_cst);
+                const auto expected = signal.load(std::memory_order_seq_cst);
+                if (tryOperation())
+                {
+                    waiters.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+
+                auto timeout = std::chrono::nanoseconds(-1);
+                if (deadline != clock::time_point::max())
+                {
+                    timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - clock::now());
+                    if (timeout.count() <= 0)
+                    {
+                        waiters.fetch_sub(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                }
+
+                posix_futex_wait(signal, expected, timeout);
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename R, typename P>
+        static clock::time_point deadline_after(std::chrono::duration<R, P> timeout)
+        {
+            return clock::now() + std::chrono::duration_cast<clock::duration>(timeout);
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        shared_memory_sptr  spMemory_;
+        shm_ring_header     *pHeader_;
+        uint8_t             *pData_;
+        uint64_t            mask_;
+    };
+
+
+    //----------------------------------------------------------------------------------------------
+    // Single producer, single consumer ring of variable length records. Every record is prefixed by
+    // its size and padded to 8 bytes; a record that doesn't fit before the end of the buffer is
+    // preceded by a wrap marker and written at the beginning. Records are limited to half of the
+    // capacity, so one always fits once the ring is empty.
+    class shm_byte_ring
+        : public shm_ring_base
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        shm_byte_ring(const path &name, uint64_t capacityInBytes, bool openExisting)
+            : shm_ring_base(name, std::max(capacityInBytes, uint64_t(min_capacity)), 1, 0, openExisting)
+        {
+            if (isValid() && !openExisting)
+            {
+                publish();
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        int64_t maxRecordSize() const
+        {
+            return int64_t(capacity() / 2) - record_header_size;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns false if the ring doesn't have room for the record at the moment.
+        bool tryWrite(const uint8_t *src, int64_t sizeInBytes)
+        {
+            if (!checkRecordSize(sizeInBytes))
+            {
+                return false;
+            }
+            return tryWriteRecord(src, sizeInBytes);
+        }
+        //------------------------------------------------------------------------------------------
+        bool write(const uint8_t *src, int64_t sizeInBytes)
+        {
+            return writeUntil(src, sizeInBytes, clock::time_point::max());
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename R, typename P>
+        bool write(const uint8_t *src, int64_t sizeInBytes, std::chrono::duration<R, P> timeout)
+        {
+            return writeUntil(src, sizeInBytes, deadline_after(timeout));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Calls visitor(const uint8_t *pRecord, int64_t sizeInBytes) with the oldest record, still in
+        // the ring, and releases it afterwards. Returns false if the ring is empty.
+        template<typename F>
+        bool tryConsume(F &&visitor)
+        {
+            const auto head = pHeader_->head.load(std::memory_order_relaxed);
+            if (head == pHeader_->tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            auto position   = head;
+            auto sizeInBytes = recordSizeAt(position);
+            if (sizeInBytes == wrap_marker)
+            {
+                // A record always follows the marker, it was published at the same time.
+                position    += capacity() - (position & mask_);
+                sizeInBytes = recordSizeAt(position);
+            }
+
+            visitor(static_cast<const uint8_t*>(pData_ + (position & mask_) + record_header_size), int64_t(sizeInBytes));
+
+            pHeader_->head.store(position + record_size(sizeInBytes), std::memory_order_release);
+            notify(pHeader_->spaceSignal, pHeader_->spaceWaiters, 1);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool tryRead(std::vector<uint8_t> &record)
+        {
+            return tryConsume([&record](const uint8_t *pRecord, int64_t sizeInBytes)
+            {
+                record.assign(pRecord, pRecord + sizeInBytes);
+            });
+        }
+        //------------------------------------------------------------------------------------------
+        bool read(std::vector<uint8_t> &record)
+        {
+            return readUntil(record, clock::time_point::max());
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename R, typename P>
+        bool read(std::vector<uint8_t> &record, std::chrono::duration<R, P> timeout)
+        {
+            return readUntil(record, deadline_after(timeout));
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto min_capacity          = uint64_t(64);
+        static constexpr auto record_header_size    = int64_t(sizeof(uint32_t));
+        static constexpr auto record_alignment      = uint64_t(8);
+        static constexpr auto wrap_marker           = uint32_t(0xffffffff);
+
+        //------------------------------------------------------------------------------------------
+        static uint64_t record_size(uint64_t sizeInBytes)
+        {
+            return (record_header_size + sizeInBytes + record_alignment - 1) & ~(record_alignment - 1);
+        }
+
+        //------------------------------------------------------------------------------------------
+        uint32_t recordSizeAt(uint64_t position) const
+        {
+            auto sizeInBytes = uint32_t(0);
+            memcpy(&sizeInBytes, pData_ + (position & mask_), sizeof(sizeInBytes));
+            return sizeInBytes;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool checkRecordSize(int64_t sizeInBytes) const
+        {
+            if (sizeInBytes < 0 || sizeInBytes > maxRecordSize())
+            {
+                vfs_errorf("A record of %ld bytes cannot be written to a ring of %lu bytes", sizeInBytes, capacity());
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool tryWriteRecord(const uint8_t *src, int64_t sizeInBytes)
+        {
+            const auto tail         = pHeader_->tail.load(std::memory_order_relaxed);
+            const auto head         = pHeader_->head.load(std::memory_order_acquire);
+            const auto recordSize   = record_size(sizeInBytes);
+            const auto offset       = tail & mask_;
+            const auto padding      = (offset + recordSize > capacity()) ? capacity() - offset : 0;
+
+            if (tail + padding + recordSize - head > capacity())
+            {
+                return false;
+            }
+
+            if (padding > 0)
+            {
+                memcpy(pData_ + offset, &wrap_marker, sizeof(wrap_marker));
+            }
+
+            const auto size32   = uint32_t(sizeInBytes);
+            auto pRecord        = pData_ + ((tail + padding) & mask_);
+            memcpy(pRecord, &size32, sizeof(size32));
+            memcpy(pRecord + record_header_size, src, sizeInBytes);
+
+            pHeader_->tail.store(tail + padding + recordSize, std::memory_order_release);
+            notify(pHeader_->dataSignal, pHeader_->dataWaiters, 1);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool writeUntil(const uint8_t *src, int64_t sizeInBytes, clock::time_point deadline)
+        {
+            if (!checkRecordSize(sizeInBytes))
+            {
+                return false;
+            }
+
+            return waitUntil(pHeader_->spaceSignal, pHeader_->spaceWaiters, deadline, [&]
+            {
+                return tryWriteRecord(src, sizeInBytes);
+            });
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool readUntil(std::vector<uint8_t> &record, clock::time_point deadline)
+        {
+            return waitUntil(pHeader_->dataSignal, pHeader_->dataWaiters, deadline, [&]
+            {
+                return tryRead(record);
+            });
+        }
+    };
+
+
+    //----------------------------------------------------------------------------------------------
+    // Bounded multiple producers, multiple consumers ring of trivially copyable elements. Every slot
+    // carries a sequence number telling whether it's ready to be written or read for a given lap, so
+    // producers and consumers only contend on their own position.
+    template<typename T>
+    class shm_ring
+        : public shm_ring_base
+    {
+        //------------------------------------------------------------------------------------------
+        static_assert(std::is_trivially_copyable_v<T>, "Elements are copied to memory shared between processes");
+
+        //------------------------------------------------------------------------------------------
+        struct slot
+        {
+            std::atomic<uint64_t>   sequence;
+            T                       value;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        shm_ring(const path &name, uint64_t capacity, bool openExisting)
+            : shm_ring_base(name, capacity, sizeof(slot), sizeof(T), openExisting)
+        {
+            if (isValid() && !openExisting)
+            {
+                for (auto i = uint64_t(0); i < this->capacity(); ++i)
+                {
+                    slots()[i].sequence.store(i, std::memory_order_relaxed);
+                }
+                publish();
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Returns false if the ring is full.
+        bool tryPush(const T &value)
+        {
+            auto position = pHeader_->tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto &s         = slots()[position & mask_];
+                const auto lap  = int64_t(s.sequence.load(std::memory_order_acquire) - position);
+                if (lap == 0)
+                {
+                    if (pHeader_->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        s.value = value;
+                        s.sequence.store(position + 1, std::memory_order_release);
+                        notify(pHeader_->dataSignal, pHeader_->dataWaiters, 1);
+                        return true;
+                    }
+                }
+                else if (lap < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = pHeader_->tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        void push(const T &value)
+        {
+            waitUntil(pHeader_->spaceSignal, pHeader_->spaceWaiters, clock::time_point::max(), [&]
+            {
+                return tryPush(value);
+            });
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename R, typename P>
+        bool push(const T &value, std::chrono::duration<R, P> timeout)
+        {
+            return waitUntil(pHeader_->spaceSignal, pHeader_->spaceWaiters, deadline_after(timeout), [&]
+            {
+                return tryPush(value);
+            });
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns false if the ring is empty.
+        bool tryPop(T &value)
+        {
+            auto position = pHeader_->head.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto &s         = slots()[position & mask_];
+                const auto lap  = int64_t(s.sequence.load(std::memory_order_acquire) - (position + 1));
+                if (lap == 0)
+                {
+                    if (pHeader_->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        value = s.value;
+                        s.sequence.store(position + capacity(), std::memory_order_release);
+                        notify(pHeader_->spaceSignal, pHeader_->spaceWaiters, 1);
+                        return true;
+                    }
+                }
+                else if (lap < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = pHeader_->head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        void pop(T &value)
+        {
+            waitUntil(pHeader_->dataSignal, pHeader_->dataWaiters, clock::time_point::max(), [&]
+            {
+                return tryPop(value);
+            });
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename R, typename P>
+        bool pop(T &value, std::chrono::duration<R, P> timeout)
+        {
+            return waitUntil(pHeader_->dataSignal, pHeader_->dataWaiters, deadline_after(timeout), [&]
+            {
+                return tryPop(value);
+            });
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        slot* slots() const
+        {
+            return reinterpret_cast<slot*>(pData_);
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    using shm_byte_ring_sptr = std::shared_ptr<shm_byte_ring>;
+    template<typename T>
+    using shm_ring_sptr      = std::shared_ptr<shm_ring<T>>;
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    // The capacity is rounded up to a power of two.
+    inline auto create_shm_byte_ring(const path &name, uint64_t capacityInBytes)
+    {
+        return shm_byte_ring_sptr(new shm_byte_ring(name, capacityInBytes, false));
+    }
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    inline auto open_shm_byte_ring(const path &name)
+    {
+        return shm_byte_ring_sptr(new shm_byte_ring(name, 0, true));
+    }
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    // The capacity is rounded up to a power of two.
+    template<typename T>
+    inline auto create_shm_ring(const path &name, uint64_t capacity)
+    {
+        return shm_ring_sptr<T>(new shm_ring<T>(name, capacity, false));
+    }
+    //----------------------------------------------------------------------------------------------
+
+    //----------------------------------------------------------------------------------------------
+    template<typename T>
+    inline auto open_shm_ring(const path &name)
+    {
+        return shm_ring_sptr<T>(new shm_ring<T>(name, 0, true));
+    }
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
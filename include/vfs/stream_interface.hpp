@@ -5,6 +5,8 @@
 #include <cstdint>
 #include <string_view>
 
+#include "vfs/file_flags.hpp"
+
 
 namespace vfs {
 
@@ -154,6 +156,56 @@ namespace vfs {
             write(toWrite);
             return (*this);
         }
+
+        // Positional single value, the stream cursor is left untouched
+        template<typename T>
+        uint64_t readAt(uint64_t offset, T &toRead)
+        {
+            const uint64_t sizeInBytes = sizeof(T);
+            return _StreamImpl::readAt(offset, (uint8_t*)&toRead, sizeInBytes);
+        }
+
+        template<typename T>
+        uint64_t writeAt(uint64_t offset, const T &toWrite)
+        {
+            const uint64_t sizeInBytes = sizeof(T);
+            return _StreamImpl::writeAt(offset, (const uint8_t*)&toWrite, sizeInBytes);
+        }
+
+        // Positional specialization for vector
+        template<typename T>
+        uint64_t readAt(uint64_t offset, std::vector<T> &toRead)
+        {
+            return readAt(offset, toRead.data(), toRead.size() * sizeof(T));
+        }
+
+        template<typename T>
+        uint64_t writeAt(uint64_t offset, const std::vector<T> &toWrite)
+        {
+            return writeAt(offset, toWrite.data(), toWrite.size() * sizeof(T));
+        }
+
+        // Positional raw byte array
+        uint64_t readAt(uint64_t offset, void *pToRead, uint64_t sizeInBytes)
+        {
+            return _StreamImpl::readAt(offset, (uint8_t*)pToRead, sizeInBytes);
+        }
+
+        uint64_t writeAt(uint64_t offset, const void *pToWrite, uint64_t sizeInBytes)
+        {
+            return _StreamImpl::writeAt(offset, (const uint8_t*)pToWrite, sizeInBytes);
+        }
+
+        // Positional scatter/gather
+        uint64_t readvAt(uint64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            return _StreamImpl::readvAt(offset, buffers, bufferCount);
+        }
+
+        uint64_t writevAt(uint64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            return _StreamImpl::writevAt(offset, buffers, bufferCount);
+        }
     };
 
 } /*vfs*/
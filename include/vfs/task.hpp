@@ -0,0 +1,212 @@
+#pragma once
+
+#include <utility>
+#include <optional>
+#include <exception>
+#include <coroutine>
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Coroutine returning a T. It only starts when awaited and resumes the awaiting coroutine once
+    // done, so chains of tasks run without any allocation besides their frames and without going
+    // through a scheduler. See reactor_interface::spawn() to start one that nothing awaits.
+    template<typename T = void>
+    class task
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        class promise_base
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            //--------------------------------------------------------------------------------------
+            // Hands the thread straight to the awaiting coroutine instead of returning to the caller
+            // of resume(), deep chains do not grow the stack.
+            struct final_awaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                template<typename _Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<_Promise> handle) noexcept
+                {
+                    const auto continuation = handle.promise().continuation_;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept
+                {}
+            };
+
+            //--------------------------------------------------------------------------------------
+            final_awaiter final_suspend() noexcept
+            {
+                return {};
+            }
+
+            //--------------------------------------------------------------------------------------
+            void unhandled_exception()
+            {
+                exception_ = std::current_exception();
+            }
+
+        protected:
+            //--------------------------------------------------------------------------------------
+            void rethrowIfFailed()
+            {
+                if (exception_)
+                {
+                    std::rethrow_exception(exception_);
+                }
+            }
+
+        private:
+            //--------------------------------------------------------------------------------------
+            friend class task;
+
+            //--------------------------------------------------------------------------------------
+            std::coroutine_handle<>     continuation_;
+            std::exception_ptr          exception_;
+        };
+
+        //------------------------------------------------------------------------------------------
+        class promise_type
+            : public promise_base
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            task get_return_object()
+            {
+                return task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            //--------------------------------------------------------------------------------------
+            template<typename _Value>
+            void return_value(_Value &&value)
+            {
+                value_.emplace(std::forward<_Value>(value));
+            }
+
+            //--------------------------------------------------------------------------------------
+            T result()
+            {
+                promise_base::rethrowIfFailed();
+                return std::move(*value_);
+            }
+
+        private:
+            //--------------------------------------------------------------------------------------
+            std::optional<T>    value_;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        using handle_type = std::coroutine_handle<promise_type>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        task(task &&other) noexcept
+            : handle_(std::exchange(other.handle_, nullptr))
+        {}
+
+        //------------------------------------------------------------------------------------------
+        task& operator =(task &&other) noexcept
+        {
+            std::swap(handle_, other.handle_);
+            return *this;
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~task()
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        task(const task &)              = delete;
+        task& operator =(const task &)  = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isDone() const
+        {
+            return !handle_ || handle_.done();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Starts the task, the awaiting coroutine is resumed with its result once it is done.
+        auto operator co_await() noexcept
+        {
+            struct awaiter
+            {
+                handle_type handle;
+
+                bool await_ready() noexcept
+                {
+                    return !handle || handle.done();
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation_ = awaiting;
+                    return handle;
+                }
+
+                T await_resume()
+                {
+                    return handle.promise().result();
+                }
+            };
+            return awaiter{ handle_ };
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        explicit task(handle_type handle)
+            : handle_(handle)
+        {}
+
+    private:
+        //------------------------------------------------------------------------------------------
+        handle_type handle_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    template<>
+    class task<void>::promise_type
+        : public task<void>::promise_base
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        task get_return_object()
+        {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        //------------------------------------------------------------------------------------------
+        void return_void()
+        {}
+
+        //------------------------------------------------------------------------------------------
+        void result()
+        {
+            promise_base::rethrowIfFailed();
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
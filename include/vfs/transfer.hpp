@@ -0,0 +1,123 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include "vfs/platform.hpp"
+#include "vfs/file.hpp"
+#include "vfs/pipe.hpp"
+#if VFS_PLATFORM_POSIX
+#   include "vfs/posix_transfer.hpp"
+#endif
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Size of the buffer each thread reuses for the transfers the kernel cannot do.
+    inline constexpr auto transfer_buffer_size = int64_t(256 * 1024);
+
+    //----------------------------------------------------------------------------------------------
+    inline uint8_t* transfer_buffer()
+    {
+        thread_local auto buffer = std::vector<uint8_t>(size_t(transfer_buffer_size));
+        return buffer.data();
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Streams read and written at the current position of their handle with nothing buffered in
+    // user space, except for what pipe message reads took in advance.
+    template<typename _Stream>
+    inline constexpr auto is_spliceable_stream_v = std::is_same_v<_Stream, file_stream> || std::is_same_v<_Stream, pipe_stream>;
+
+    //----------------------------------------------------------------------------------------------
+    // Streams transfer() can copy from (to) through a buffer.
+    template<typename _Stream, typename = void>
+    struct is_readable_stream : std::false_type {};
+
+    template<typename _Stream>
+    struct is_readable_stream<_Stream, std::void_t<decltype(std::declval<_Stream&>().read(std::declval<uint8_t*>(), int64_t(0)))>> : std::true_type {};
+
+    template<typename _Stream>
+    inline constexpr auto is_readable_stream_v = is_readable_stream<_Stream>::value;
+
+    //----------------------------------------------------------------------------------------------
+    template<typename _Stream, typename = void>
+    struct is_writable_stream : std::false_type {};
+
+    template<typename _Stream>
+    struct is_writable_stream<_Stream, std::void_t<decltype(std::declval<_Stream&>().write(std::declval<const uint8_t*>(), int64_t(0)))>> : std::true_type {};
+
+    template<typename _Stream>
+    inline constexpr auto is_writable_stream_v = is_writable_stream<_Stream>::value;
+
+    //----------------------------------------------------------------------------------------------
+    // Copies through the read() and write() of the streams.
+    template<typename _Src, typename _Dst>
+    int64_t buffered_transfer(_Src &src, _Dst &dst, int64_t sizeInBytes)
+    {
+        static_assert(is_readable_stream_v<_Src> && is_writable_stream_v<_Dst>, "Transfers go from a readable stream to a writable one");
+        const auto pBuffer = transfer_buffer();
+
+        auto totalBytesMoved = int64_t(0);
+        while (totalBytesMoved < sizeInBytes)
+        {
+            const auto bytesRead = int64_t(src.read(pBuffer, std::min(sizeInBytes - totalBytesMoved, transfer_buffer_size)));
+            if (bytesRead <= 0)
+            {
+                break;
+            }
+
+            const auto bytesWritten = int64_t(dst.write(pBuffer, bytesRead));
+            totalBytesMoved += std::max(bytesWritten, int64_t(0));
+            if (bytesWritten < bytesRead)
+            {
+                break;
+            }
+        }
+        return totalBytesMoved;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Moves sizeInBytes bytes from the current position of src to dst, e.g. a log file to a pipe.
+    // Between files and pipes on posix the data never leaves the kernel (splice()), other streams
+    // are copied through a buffer. Returns the number of bytes moved, less than sizeInBytes at the
+    // end of src or on error. Shared pointers to streams go to the overload below.
+    template<typename _Src, typename _Dst>
+        requires is_readable_stream_v<_Src> && is_writable_stream_v<_Dst>
+    int64_t transfer(_Src &src, _Dst &dst, int64_t sizeInBytes)
+    {
+        auto totalBytesMoved = int64_t(0);
+#if VFS_PLATFORM_POSIX
+        if constexpr (is_spliceable_stream_v<_Src> && is_spliceable_stream_v<_Dst>)
+        {
+            if constexpr (std::is_same_v<_Src, pipe_stream>)
+            {
+                // The bytes message reads already took from the pipe come first.
+                totalBytesMoved = buffered_transfer(src, dst, std::min(src.bufferedBytesToRead(), sizeInBytes));
+            }
+
+            auto isSupported = true;
+            totalBytesMoved += posix_transfer::splice(src.nativeHandle(), dst.nativeHandle(), sizeInBytes - totalBytesMoved, isSupported, transfer_buffer(), transfer_buffer_size);
+            if (isSupported)
+            {
+                return totalBytesMoved;
+            }
+        }
+#endif
+        return totalBytesMoved + buffered_transfer(src, dst, sizeInBytes - totalBytesMoved);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    template<typename _Src, typename _Dst>
+    int64_t transfer(const std::shared_ptr<_Src> &spSrc, const std::shared_ptr<_Dst> &spDst, int64_t sizeInBytes)
+    {
+        return transfer(*spSrc, *spDst, sizeInBytes);
+    }
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
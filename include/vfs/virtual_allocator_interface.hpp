@@ -1,8 +1,29 @@
 #pragma once
 
+#include <cstdint>
+
 
 namespace vfs {
 
+    //----------------------------------------------------------------------------------------------
+    enum class numa_policy
+    {
+        // Pages go to the node of the thread touching them first.
+        local,
+        // Pages are spread over all the nodes, page by page.
+        interleave,
+        // Pages go to the given node only.
+        bind,
+    };
+
+    //----------------------------------------------------------------------------------------------
+    struct numa_placement
+    {
+        numa_policy policy  = numa_policy::local;
+        // Only used by numa_policy::bind.
+        int32_t     node    = 0;
+    };
+
     //----------------------------------------------------------------------------------------------
     template<typename _Impl>
     struct virtual_allocator_interface
@@ -28,9 +49,39 @@ namespace vfs {
         }
 
         //------------------------------------------------------------------------------------------
-        static bool deallocate(void *pAddr)
+        // Same as commit() and places the pages on the NUMA nodes as requested. The placement is a
+        // hint: the pages are committed even if it cannot be applied.
+        static void* commit(void *pAddr, int64_t size, numa_placement placement)
+        {
+            return _Impl::commit(pAddr, size, placement);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Releases the physical memory behind committed pages but keeps the address range reserved.
+        static bool decommit(void *pAddr, int64_t size)
+        {
+            return _Impl::decommit(pAddr, size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Size is the one given to reserve().
+        static bool deallocate(void *pAddr, int64_t size)
+        {
+            return _Impl::deallocate(pAddr, size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Nodes are numbered in [0, numaNodeCount()), 1 on machines without NUMA.
+        static int32_t numaNodeCount()
+        {
+            return _Impl::numaNodeCount();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Node of the processor the calling thread currently runs on.
+        static int32_t currentNumaNode()
         {
-            return _Impl::deallocate(pAddr);
+            return _Impl::currentNumaNode();
         }
     };
     
@@ -1,8 +1,13 @@
 #pragma once
 
-#include <set>
-#include <mutex>
+#include <bit>
 #include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 
 #include "vfs/logging.hpp"
 #include "vfs/virtual_allocator.hpp"
@@ -33,28 +38,47 @@ namespace vfs {
         static constexpr auto invalid_index         = UINT32_MAX;
         static constexpr auto control_bits_per_page = page_size * 8;
         static constexpr auto max_page_count        = compute_max_page_count(float(_MaxElementCount) / float(elements_per_page));
+        // Reserved address ranges, whole pages for the elements as elements_per_page is rounded down.
+        static constexpr auto array_reserved_size               = int64_t(max_page_count) * page_size;
+        static constexpr auto control_register_reserved_size    = int64_t((_MaxElementCount / sizeof(uint64_t)) + 1) * sizeof(uint64_t);
+        static constexpr auto generations_reserved_size         = int64_t(max_page_count) * elements_per_page * sizeof(uint32_t);
 
     public:
         //------------------------------------------------------------------------------------------
+        // An index along with the generation of its slot, which changes each time the element in it
+        // is removed. A handle kept after its element was removed is detected as stale instead of
+        // silently referring to whatever element reused the slot.
+        struct handle
+        {
+            uint32_t index      = invalid_index;
+            uint32_t generation = 0;
+
+            bool operator ==(const handle &rhs) const = default;
+        };
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Both iterators find the next element with the control register, skipping 64 empty slots
+        // at a time, so sparse arrays are cheap to walk.
         struct iterator
         {
-            iterator(virtual_array<T, _MaxElementCount> &arr, uint32_t index)
+            iterator(virtual_array<T, _MaxElementCount> &arr, uint32_t index, uint32_t lastIndex)
                 : arr_(arr)
-                , currentIndex_(index)
-            {
-                goToNextValidIndex();
-            }
+                , currentIndex_(arr.findNextValidIndex(index, lastIndex))
+                , lastIndex_(lastIndex)
+            {}
 
             iterator& operator ++()
             {
-                ++currentIndex_;
-                goToNextValidIndex();
+                currentIndex_ = arr_.findNextValidIndex(currentIndex_ + 1, lastIndex_);
                 return (*this);
             }
 
+            // Iterators past the last index they were created with are all at the end, begin() and
+            // end() may be taken before and after the array grows.
             bool operator ==(const iterator &rhs) const
             {
-                return &arr_ == &(rhs.arr_) && currentIndex_ == rhs.currentIndex_;
+                return &arr_ == &(rhs.arr_) && (currentIndex_ == rhs.currentIndex_ || (isEnd() && rhs.isEnd()));
             }
 
             bool operator !=(const iterator &rhs) const
@@ -67,40 +91,42 @@ namespace vfs {
                 return arr_[currentIndex_];
             }
 
+            uint32_t index() const
+            {
+                return currentIndex_;
+            }
+
         private:
-            void goToNextValidIndex()
+            bool isEnd() const
             {
-                while ((currentIndex_ < arr_.lastValidIndex_) && !arr_.isIndexValid(currentIndex_))
-                {
-                    ++currentIndex_;
-                }
+                return currentIndex_ >= lastIndex_;
             }
 
         private:
             virtual_array<T, _MaxElementCount> &arr_;
             uint32_t                            currentIndex_;
+            uint32_t                            lastIndex_;
         };
 
         //------------------------------------------------------------------------------------------
         struct const_iterator
         {
-            const_iterator(const virtual_array<T, _MaxElementCount> &arr, uint32_t index)
+            const_iterator(const virtual_array<T, _MaxElementCount> &arr, uint32_t index, uint32_t lastIndex)
                 : arr_(arr)
-                , currentIndex_(index)
-            {
-                goToNextValidIndex();
-            }
+                , currentIndex_(arr.findNextValidIndex(index, lastIndex))
+                , lastIndex_(lastIndex)
+            {}
 
             const_iterator& operator ++()
             {
-                ++currentIndex_;
-                goToNextValidIndex();
+                currentIndex_ = arr_.findNextValidIndex(currentIndex_ + 1, lastIndex_);
                 return (*this);
             }
 
+            // Same as iterator, at the end once past the last index it was created with.
             bool operator ==(const const_iterator &rhs) const
             {
-                return &arr_ == &(rhs.arr_) && currentIndex_ == rhs.currentIndex_;
+                return &arr_ == &(rhs.arr_) && (currentIndex_ == rhs.currentIndex_ || (isEnd() && rhs.isEnd()));
             }
 
             bool operator !=(const const_iterator &rhs) const
@@ -113,43 +139,157 @@ namespace vfs {
                 return arr_[currentIndex_];
             }
 
+            uint32_t index() const
+            {
+                return currentIndex_;
+            }
+
         private:
-            void goToNextValidIndex()
+            bool isEnd() const
             {
-                while ((currentIndex_ < arr_.lastValidIndex_) && !arr_.isIndexValid(currentIndex_))
-                {
-                    ++currentIndex_;
-                }
+                return currentIndex_ >= lastIndex_;
             }
 
         private:
             const virtual_array<T, _MaxElementCount> &arr_;
             uint32_t                            currentIndex_;
+            uint32_t                            lastIndex_;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // The elements with an index in [firstIndex, lastIndex), usable in a range based for loop.
+        template<typename _Iterator>
+        struct index_range
+        {
+            _Iterator begin() const
+            {
+                return first_;
+            }
+
+            _Iterator end() const
+            {
+                return last_;
+            }
+
+            _Iterator first_;
+            _Iterator last_;
         };
 
     public:
         //------------------------------------------------------------------------------------------
         iterator begin()
         {
-            return iterator(*this, 0);
+            return iterator(*this, 0, lastValidIndex_);
         }
 
         //------------------------------------------------------------------------------------------
         iterator end()
         {
-            return iterator(*this, lastValidIndex_);
+            return iterator(*this, lastValidIndex_, lastValidIndex_);
         }
 
         //------------------------------------------------------------------------------------------
         const_iterator begin() const
         {
-            return const_iterator(*this, 0);
+            return const_iterator(*this, 0, lastValidIndex_);
         }
 
         //------------------------------------------------------------------------------------------
         const_iterator end() const
         {
-            return const_iterator(*this, lastValidIndex_);
+            return const_iterator(*this, lastValidIndex_, lastValidIndex_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        auto range(uint32_t firstIndex, uint32_t lastIndex)
+        {
+            lastIndex = std::min(lastIndex, lastValidIndex_.load(std::memory_order_acquire));
+            firstIndex = std::min(firstIndex, lastIndex);
+            return index_range<iterator>{ iterator(*this, firstIndex, lastIndex), iterator(*this, lastIndex, lastIndex) };
+        }
+
+        //------------------------------------------------------------------------------------------
+        auto range(uint32_t firstIndex, uint32_t lastIndex) const
+        {
+            lastIndex = std::min(lastIndex, lastValidIndex_.load(std::memory_order_acquire));
+            firstIndex = std::min(firstIndex, lastIndex);
+            return index_range<const_iterator>{ const_iterator(*this, firstIndex, lastIndex), const_iterator(*this, lastIndex, lastIndex) };
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Calls visitor(element, index), or visitor(element), for each element with an index in
+        // [firstIndex, lastIndex). The control register is read one word per 64 slots, cheaper than
+        // iterators on dense arrays as well.
+        template<typename _Visitor>
+        void for_each(_Visitor &&visitor, uint32_t firstIndex = 0, uint32_t lastIndex = invalid_index)
+        {
+            lastIndex = std::min(lastIndex, lastValidIndex_.load(std::memory_order_acquire));
+            for (auto wordIndex = firstIndex / 64; uint64_t(wordIndex) * 64 < lastIndex; ++wordIndex)
+            {
+                auto word = pControlRegister_[wordIndex].load(std::memory_order_acquire);
+                if (wordIndex == firstIndex / 64)
+                {
+                    word &= ~0ull << (firstIndex % 64);
+                }
+                if (lastIndex - wordIndex * 64 < 64)
+                {
+                    word &= (1ull << (lastIndex % 64)) - 1;
+                }
+
+                while (word != 0)
+                {
+                    const auto index = wordIndex * 64 + uint32_t(std::countr_zero(word));
+                    word &= word - 1;
+
+                    if constexpr (std::is_invocable_v<_Visitor, T&, uint32_t>)
+                    {
+                        visitor(pArray_[index], index);
+                    }
+                    else
+                    {
+                        visitor(pArray_[index]);
+                    }
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Same as for_each() over the whole array, split in chunks of whole control register words
+        // visited by threadCount threads. 0 uses one thread per hardware thread, the calling thread
+        // is one of them. The visitor is called concurrently and must not add or remove elements.
+        template<typename _Visitor>
+        void parallel_for_each(_Visitor &&visitor, int32_t threadCount = 0)
+        {
+            if (threadCount <= 0)
+            {
+                threadCount = std::max(int32_t(std::thread::hardware_concurrency()), int32_t(1));
+            }
+
+            const auto lastIndex    = lastValidIndex_.load(std::memory_order_acquire);
+            const auto wordCount    = (uint64_t(lastIndex) + 63) / 64;
+            const auto chunkCount   = uint32_t(std::min(uint64_t(threadCount), std::max(wordCount, uint64_t(1))));
+            const auto chunkIndex   = [lastIndex, wordCount, chunkCount](uint32_t chunk)
+            {
+                return uint32_t(std::min(wordCount * chunk / chunkCount * 64, uint64_t(lastIndex)));
+            };
+
+            auto threads = std::vector<std::thread>{};
+            threads.reserve(chunkCount - 1);
+            for (auto chunk = 1u; chunk < chunkCount; ++chunk)
+            {
+                threads.emplace_back([this, &visitor, first = chunkIndex(chunk), last = chunkIndex(chunk + 1)]
+                {
+                    for_each(visitor, first, last);
+                });
+            }
+
+            for_each(visitor, chunkIndex(0), chunkIndex(1));
+
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
         }
 
     public:
@@ -160,6 +300,15 @@ namespace vfs {
             init();
         }
 
+        //------------------------------------------------------------------------------------------
+        // All the pages of the array are committed with the given NUMA placement.
+        explicit virtual_array(numa_placement placement)
+        {
+            reset();
+            placement_ = placement;
+            init();
+        }
+
         //------------------------------------------------------------------------------------------
         ~virtual_array()
         {
@@ -174,8 +323,12 @@ namespace vfs {
                 }
             }
             
-            virtual_allocator::deallocate(pArray_);
-            virtual_allocator::deallocate(pControlRegister_);
+            if (pArray_ != nullptr)
+            {
+                virtual_allocator::deallocate(pArray_, array_reserved_size);
+                virtual_allocator::deallocate(pControlRegister_, control_register_reserved_size);
+                virtual_allocator::deallocate(pGenerations_, generations_reserved_size);
+            }
 
             reset();
         }
@@ -187,8 +340,8 @@ namespace vfs {
         //------------------------------------------------------------------------------------------
         virtual_array(virtual_array &&other)
         {
+            reset();
             swap(std::move(other));
-            other.reset();
         }
 
         //------------------------------------------------------------------------------------------
@@ -197,7 +350,6 @@ namespace vfs {
             if (this != &other)
             {
                 swap(std::move(other));
-                other.reset();
             }
             return (*this);
         }
@@ -207,18 +359,81 @@ namespace vfs {
         template<typename... _Args>
         uint32_t emplace(_Args &&...args)
         {
-            auto freeIndex = grabNextFreeIndex();
+            auto &shard     = pShards_[current_shard()];
+            auto freeIndex  = grabNextFreeIndex(shard);
             new(pArray_ + freeIndex) T(std::forward<_Args>(args)...);
 
             // Mark as used here after actually constructing the element so iteration remains correct.
             pControlRegister_[freeIndex / 64].fetch_or(1ull << (freeIndex % 64), std::memory_order_acq_rel);
 
-            ++size_;
+            shard.size.fetch_add(1, std::memory_order_relaxed);
             return freeIndex;
         }
 
+        //------------------------------------------------------------------------------------------
+        template<typename... _Args>
+        handle emplaceHandle(_Args &&...args)
+        {
+            return makeHandle(emplace(std::forward<_Args>(args)...));
+        }
+
         //------------------------------------------------------------------------------------------
         void remove(uint32_t index)
+        {
+            pGenerations_[index].fetch_add(1, std::memory_order_acq_rel);
+            release(index);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns false if the handle is stale, only one of many threads removing the same handle
+        // actually removes the element.
+        bool remove(handle h)
+        {
+            if (!isHandleValid(h))
+            {
+                return false;
+            }
+
+            auto generation = h.generation;
+            if (!pGenerations_[h.index].compare_exchange_strong(generation, generation + 1, std::memory_order_acq_rel))
+            {
+                return false;
+            }
+
+            release(h.index);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The index must hold an element.
+        handle makeHandle(uint32_t index) const
+        {
+            return handle{ index, pGenerations_[index].load(std::memory_order_acquire) };
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isHandleValid(handle h) const
+        {
+            return isIndexValid(h.index) && pGenerations_[h.index].load(std::memory_order_acquire) == h.generation;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // nullptr if the handle is stale. Removing the element from another thread while the
+        // pointer is in use is still up to the caller to prevent.
+        T* get(handle h)
+        {
+            return isHandleValid(h) ? pArray_ + h.index : nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        const T* get(handle h) const
+        {
+            return isHandleValid(h) ? pArray_ + h.index : nullptr;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void release(uint32_t index)
         {
             ///TODO@h: keep an eye on this.
             // Mark as unused here before actually deleting the element so iteration remains correct.
@@ -230,11 +445,14 @@ namespace vfs {
             {
                 pArray_[index].~T();
             }
-            pushFreeList(index);
 
-            --size_;
+            // The slot goes to the free list of the calling thread, emplace() on the same thread reuses it first.
+            auto &shard = pShards_[current_shard()];
+            pushFreeList(shard.freeListHead, index, index);
+            shard.size.fetch_sub(1, std::memory_order_relaxed);
         }
 
+    public:
         //------------------------------------------------------------------------------------------
         bool isIndexValid(uint32_t index) const
         {
@@ -249,9 +467,115 @@ namespace vfs {
         }
 
         //------------------------------------------------------------------------------------------
+        uint32_t getCommittedPageCount() const
+        {
+            return pageCount_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Gives back the pages past the last element and returns how many were released. Elements
+        // are not moved, so a single element at the end of the array keeps everything before it.
+        // Must not run while other threads add or remove elements.
+        uint32_t shrinkToFit()
+        {
+            // One past the last element.
+            auto usedEnd = lastValidIndex_.load(std::memory_order_acquire);
+            while (usedEnd > 0)
+            {
+                const auto word = pControlRegister_[(usedEnd - 1) / 64].load(std::memory_order_acquire);
+                const auto mask = (usedEnd % 64 == 0) ? ~0ull : (1ull << (usedEnd % 64)) - 1;
+                if ((word & mask) != 0)
+                {
+                    usedEnd = ((usedEnd - 1) & ~63u) + 64 - uint32_t(std::countl_zero(word & mask));
+                    break;
+                }
+                usedEnd = (usedEnd - 1) & ~63u;
+            }
+
+            const auto pageCount    = pageCount_.load(std::memory_order_acquire);
+            const auto newPageCount = std::max(uint32_t((usedEnd + elements_per_page - 1) / elements_per_page), 1u);
+            if (newPageCount >= pageCount)
+            {
+                return 0;
+            }
+
+            // Rebuild the free lists without the slots going away, lowest indices first.
+            for (auto i = 0u; i < shard_count; ++i)
+            {
+                takeFreeList(pShards_[i].freeListHead);
+            }
+            lastValidIndex_.store(usedEnd, std::memory_order_release);
+
+            auto firstFreeIndex = invalid_index;
+            auto lastFreeIndex  = invalid_index;
+            for (auto index = 0u; index < usedEnd; ++index)
+            {
+                if (!isIndexValid(index))
+                {
+                    if (lastFreeIndex == invalid_index)
+                    {
+                        firstFreeIndex = index;
+                    }
+                    else
+                    {
+                        setNextFreeIndex(lastFreeIndex, index);
+                    }
+                    lastFreeIndex = index;
+                }
+            }
+            if (firstFreeIndex != invalid_index)
+            {
+                pushFreeList(pShards_[current_shard()].freeListHead, firstFreeIndex, lastFreeIndex);
+            }
+
+            const auto pArrayOffset         = reinterpret_cast<uint8_t*>(pArray_) + int64_t(newPageCount) * page_size;
+            [[maybe_unused]] const auto ok  = virtual_allocator::decommit(pArrayOffset, int64_t(pageCount - newPageCount) * page_size);
+            vfs_check(ok);
+            pageCount_.store(newPageCount, std::memory_order_release);
+
+            // The words past the last element are all zeros, as fresh pages are.
+            const auto controlRegisterPageCount     = controlRegisterPageCount_.load(std::memory_order_acquire);
+            const auto newControlRegisterPageCount  = uint32_t(elements_per_page * newPageCount / control_bits_per_page) + 1;
+            if (newControlRegisterPageCount < controlRegisterPageCount)
+            {
+                const auto pRegisterOffset          = reinterpret_cast<uint8_t*>(pControlRegister_) + int64_t(newControlRegisterPageCount) * page_size;
+                [[maybe_unused]] const auto okReg   = virtual_allocator::decommit(pRegisterOffset, int64_t(controlRegisterPageCount - newControlRegisterPageCount) * page_size);
+                vfs_check(okReg);
+                controlRegisterPageCount_.store(newControlRegisterPageCount, std::memory_order_release);
+            }
+
+            // The generations stay committed, resetting them would make old handles valid again.
+            return pageCount - newPageCount;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // First index in [index, lastIndex) holding an element, lastIndex if there is none.
+        uint32_t findNextValidIndex(uint32_t index, uint32_t lastIndex) const
+        {
+            auto current = uint64_t(index);
+            while (current < lastIndex)
+            {
+                const auto word = pControlRegister_[current / 64].load(std::memory_order_acquire) & (~0ull << (current % 64));
+                if (word != 0)
+                {
+                    current = (current & ~uint64_t(63)) + std::countr_zero(word);
+                    break;
+                }
+                current = (current & ~uint64_t(63)) + 64;
+            }
+            return uint32_t(std::min(current, uint64_t(lastIndex)));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Sums the counts of all shards, it's only exact when no thread is adding or removing elements.
         uint32_t size() const
         {
-            return size_.load(std::memory_order_acquire);
+            auto size = int64_t(0);
+            for (auto i = 0u; i < shard_count; ++i)
+            {
+                size += pShards_[i].size.load(std::memory_order_acquire);
+            }
+            return uint32_t(size);
         }
 
         //------------------------------------------------------------------------------------------
@@ -266,154 +590,344 @@ namespace vfs {
             return pArray_[i];
         }
 
+    private:
+        //------------------------------------------------------------------------------------------
+        // Free slots are chained through their own memory. Each shard has its own free list, threads
+        // are spread over the shards so they don't all contend on a single head. The head packs the
+        // first index with a tag bumped on every change, so a pop that read a stale next index
+        // (the ABA problem) fails instead of corrupting the list.
+        struct alignas(64) shard
+        {
+            std::atomic<uint64_t>   freeListHead;
+            // Can go negative when elements are removed from another thread than the one which added them.
+            std::atomic<int64_t>    size;
+        };
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto shard_count       = 32u;
+        // Fresh indices are handed to a shard 64 at a time, a whole word of the control register.
+        static constexpr auto refill_batch_size = 64u;
+
+        //------------------------------------------------------------------------------------------
+        static constexpr uint64_t make_head(uint32_t index, uint32_t tag)
+        {
+            return (uint64_t(tag) << 32) | index;
+        }
+        //------------------------------------------------------------------------------------------
+        static constexpr uint32_t head_index(uint64_t head)
+        {
+            return uint32_t(head);
+        }
+        //------------------------------------------------------------------------------------------
+        static constexpr uint32_t head_tag(uint64_t head)
+        {
+            return uint32_t(head >> 32);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Threads are assigned to shards in turn the first time they touch a virtual_array of this type.
+        static uint32_t current_shard()
+        {
+            static auto nextShard           = std::atomic<uint32_t>(0);
+            thread_local const auto shard   = nextShard.fetch_add(1, std::memory_order_relaxed) % shard_count;
+            return shard;
+        }
+
     private:    
         //------------------------------------------------------------------------------------------
         void init()
         {
-            pArray_ = virtual_allocator::template reserve<T>(_MaxElementCount);
+            pArray_ = reinterpret_cast<T*>(virtual_allocator::reserve(array_reserved_size));
             vfs_check(pArray_ != nullptr);
 
-            pControlRegister_ = virtual_allocator::reserve<std::atomic<uint64_t>>((_MaxElementCount / sizeof(uint64_t)) + 1);
+            pControlRegister_ = reinterpret_cast<std::atomic<uint64_t>*>(virtual_allocator::reserve(control_register_reserved_size));
             vfs_check(pControlRegister_ != nullptr);
 
-            grow(1);
+            pGenerations_ = reinterpret_cast<std::atomic<uint32_t>*>(virtual_allocator::reserve(generations_reserved_size));
+            vfs_check(pGenerations_ != nullptr);
+
+            pShards_ = std::make_unique<shard[]>(shard_count);
+            for (auto i = 0u; i < shard_count; ++i)
+            {
+                pShards_[i].freeListHead.store(make_head(invalid_index, 0), std::memory_order_relaxed);
+                pShards_[i].size.store(0, std::memory_order_relaxed);
+            }
+
+            ensureCommitted(0);
         }
 
         //------------------------------------------------------------------------------------------
         void reset()
         {
-            size_                       = 0;
             pArray_                     = nullptr;
             pageCount_                  = 0;
-            nextFreeIndex_              = invalid_index;
             lastValidIndex_             = 0;
             pControlRegister_           = nullptr;
             controlRegisterPageCount_   = 0;
+            pGenerations_               = nullptr;
+            placement_.reset();
+            pShards_.reset();
         }
 
         //------------------------------------------------------------------------------------------
         void swap(virtual_array &&other)
         {
             std::swap(pArray_                   , other.pArray_                     );
-            std::swap(pageCount_                , other.pageCount_                  );
             std::swap(pControlRegister_         , other.pControlRegister_           );
-            std::swap(controlRegisterPageCount_ , other.controlRegisterPageCount_   );
+            std::swap(pGenerations_             , other.pGenerations_               );
+            std::swap(pShards_                  , other.pShards_                    );
+            std::swap(placement_                , other.placement_                  );
 
-            auto other_size = other.size_.exchange(size_.load());
-            size_.store(other_size);
+            auto other_pageCount = other.pageCount_.exchange(pageCount_.load());
+            pageCount_.store(other_pageCount);
 
-            auto other_nextFreeIndex = other.nextFreeIndex_.exchange(nextFreeIndex_.load());
-            nextFreeIndex_.store(other_nextFreeIndex);
+            auto other_controlRegisterPageCount = other.controlRegisterPageCount_.exchange(controlRegisterPageCount_.load());
+            controlRegisterPageCount_.store(other_controlRegisterPageCount);
 
             auto other_lastValidIndex = other.lastValidIndex_.exchange(lastValidIndex_.load());
             lastValidIndex_.store(other_lastValidIndex);
         }
 
         //------------------------------------------------------------------------------------------
-        void grow(uint32_t pageCount)
+        // Commits the pages up to the one holding index, at least doubling the committed size.
+        // Committing is idempotent so racing threads may commit overlapping ranges without a lock,
+        // the page count is only published once the pages are usable.
+        void ensureCommitted(uint32_t index)
         {
-            const auto pArrayOffset             = reinterpret_cast<uint8_t*>(pArray_) + pageCount_ * page_size;
-            [[maybe_unused]] const auto pData   = virtual_allocator::commit(pArrayOffset, pageCount * page_size);
-            vfs_check(pData != nullptr);
-            pageCount_ += pageCount;
+            const auto neededPageCount  = uint32_t(index / elements_per_page) + 1;
+            auto pageCount              = pageCount_.load(std::memory_order_acquire);
 
-            const auto neededControlRegisterPageCount = uint32_t(elements_per_page * pageCount_ / control_bits_per_page) + 1 - controlRegisterPageCount_;
-            if (neededControlRegisterPageCount > 0)
+            while (pageCount < neededPageCount)
             {
-                const auto pRegisterOffset      = reinterpret_cast<uint8_t*>(pControlRegister_) + controlRegisterPageCount_ * page_size;
-                [[maybe_unused]] const auto p   = virtual_allocator::commit(pRegisterOffset, neededControlRegisterPageCount * page_size);
-                vfs_check(p != nullptr);
-                controlRegisterPageCount_ += neededControlRegisterPageCount;
+                const auto newPageCount = std::min(std::max(pageCount * 2, neededPageCount), uint32_t(max_page_count));
+                if (newPageCount < neededPageCount)
+                {
+                    // Cannot grow anymore, abort is harsh but will do for now
+                    vfs_critical("Cannot grow virtual array");
+                    abort();
+                }
+
+                const auto pArrayOffset             = reinterpret_cast<uint8_t*>(pArray_) + int64_t(pageCount) * page_size;
+                [[maybe_unused]] const auto pData   = commitPages(pArrayOffset, int64_t(newPageCount - pageCount) * page_size);
+                vfs_check(pData != nullptr);
+
+                const auto neededControlRegisterPageCount   = uint32_t(elements_per_page * newPageCount / control_bits_per_page) + 1;
+                auto controlRegisterPageCount               = controlRegisterPageCount_.load(std::memory_order_acquire);
+                if (controlRegisterPageCount < neededControlRegisterPageCount)
+                {
+                    const auto pRegisterOffset      = reinterpret_cast<uint8_t*>(pControlRegister_) + int64_t(controlRegisterPageCount) * page_size;
+                    [[maybe_unused]] const auto p   = commitPages(pRegisterOffset, int64_t(neededControlRegisterPageCount - controlRegisterPageCount) * page_size);
+                    vfs_check(p != nullptr);
+                    publish_max(controlRegisterPageCount_, neededControlRegisterPageCount);
+                }
+
+                // The generations of the new elements, from the page holding the first one.
+                const auto generationsBegin         = (int64_t(pageCount) * elements_per_page * sizeof(uint32_t)) & ~int64_t(page_size - 1);
+                const auto generationsEnd           = int64_t(newPageCount) * elements_per_page * sizeof(uint32_t);
+                [[maybe_unused]] const auto pGen    = commitPages(reinterpret_cast<uint8_t*>(pGenerations_) + generationsBegin, generationsEnd - generationsBegin);
+                vfs_check(pGen != nullptr);
+
+                publish_max(pageCount_, newPageCount);
+                pageCount = pageCount_.load(std::memory_order_acquire);
             }
         }
 
         //------------------------------------------------------------------------------------------
-        uint32_t grabNextFreeIndex()
+        void* commitPages(void *pAddr, int64_t size)
+        {
+            return placement_ ? virtual_allocator::commit(pAddr, size, *placement_) : virtual_allocator::commit(pAddr, size);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void publish_max(std::atomic<uint32_t> &value, uint32_t newValue)
         {
-            while (!isFreeListEmpty())
+            auto current = value.load(std::memory_order_acquire);
+            while (current < newValue && !value.compare_exchange_weak(current, newValue, std::memory_order_acq_rel))
             {
-                const auto freeIndex = tryPopFreeList();
-                if (freeIndex != invalid_index)
-                {
-                    return freeIndex;
-                }
             }
+        }
 
-            const auto freeIndex = lastValidIndex_++;
+        //------------------------------------------------------------------------------------------
+        uint32_t grabNextFreeIndex(shard &ownShard)
+        {
+            const auto freeIndex = tryPopFreeList(ownShard.freeListHead);
+            if (freeIndex != invalid_index)
+            {
+                return freeIndex;
+            }
 
-            const auto pageOfFreeIndex = (freeIndex / elements_per_page) + 1;
-            if (pageOfFreeIndex > pageCount_)
+            // Reuse the slots freed on other shards before growing, taking their whole list at once.
+            const auto ownShardIndex = uint32_t(&ownShard - pShards_.get());
+            for (auto i = 1u; i < shard_count; ++i)
             {
-                std::lock_guard<std::mutex> _(mutex_);
-                if (pageOfFreeIndex > pageCount_)
+                const auto stolenIndex = takeFreeList(pShards_[(ownShardIndex + i) % shard_count].freeListHead);
+                if (stolenIndex != invalid_index)
                 {
-                    const auto pageCount = std::min(pageCount_, uint32_t(max_page_count) - pageCount_);
-                    if (pageCount == 0)
+                    const auto firstRemainingIndex = nextFreeIndex(stolenIndex);
+                    if (firstRemainingIndex != invalid_index)
                     {
-                        // Cannot grow anymore, abort is harsh but will do for now
-                        vfs_critical("Cannot grow virtual array");
-                        abort();
+                        auto lastRemainingIndex = firstRemainingIndex;
+                        while (nextFreeIndex(lastRemainingIndex) != invalid_index)
+                        {
+                            lastRemainingIndex = nextFreeIndex(lastRemainingIndex);
+                        }
+                        pushFreeList(ownShard.freeListHead, firstRemainingIndex, lastRemainingIndex);
                     }
-                    grow(pageCount);
+                    return stolenIndex;
                 }
             }
 
-            return freeIndex;
+            // Take a batch of never used indices, a single atomic operation for the next refill_batch_size emplace().
+            auto firstIndex = lastValidIndex_.load(std::memory_order_acquire);
+            auto endIndex   = uint32_t(0);
+            do
+            {
+                if (firstIndex >= _MaxElementCount)
+                {
+                    // Cannot grow anymore, abort is harsh but will do for now
+                    vfs_critical("Cannot grow virtual array");
+                    abort();
+                }
+                endIndex = std::min(firstIndex + refill_batch_size, _MaxElementCount);
+            } while (!lastValidIndex_.compare_exchange_weak(firstIndex, endIndex, std::memory_order_acq_rel));
+
+            ensureCommitted(endIndex - 1);
+
+            if (endIndex - firstIndex > 1)
+            {
+                for (auto index = firstIndex + 1; index < endIndex - 1; ++index)
+                {
+                    setNextFreeIndex(index, index + 1);
+                }
+                pushFreeList(ownShard.freeListHead, firstIndex + 1, endIndex - 1);
+            }
+
+            return firstIndex;
         }
 
         //------------------------------------------------------------------------------------------
-        bool isFreeListEmpty() const
+        uint32_t nextFreeIndex(uint32_t freeIndex) const
         {
-            return nextFreeIndex_ == invalid_index;
+            return *reinterpret_cast<const uint32_t*>(&pArray_[freeIndex]);
         }
 
         //------------------------------------------------------------------------------------------
-        void pushFreeList(uint32_t freeIndex)
+        void setNextFreeIndex(uint32_t freeIndex, uint32_t nextIndex)
         {
-            auto expectedNextFreeIndex = nextFreeIndex_.load(std::memory_order_acquire);
-            vfs_check(expectedNextFreeIndex < lastValidIndex_ || expectedNextFreeIndex == invalid_index);
-            do 
-            {
-                *reinterpret_cast<uint32_t*>(&pArray_[freeIndex]) = expectedNextFreeIndex;
-            } while (!nextFreeIndex_.compare_exchange_strong(expectedNextFreeIndex, freeIndex, std::memory_order_acq_rel));
-
-            [[maybe_unused]] const auto i = nextFreeIndex_.load();
-            vfs_check(i < lastValidIndex_ || i == invalid_index);
+            *reinterpret_cast<uint32_t*>(&pArray_[freeIndex]) = nextIndex;
         }
 
         //------------------------------------------------------------------------------------------
-        uint32_t tryPopFreeList()
+        // Pushes the chain of free slots going from firstIndex to lastIndex.
+        void pushFreeList(std::atomic<uint64_t> &head, uint32_t firstIndex, uint32_t lastIndex)
         {
-            auto freeIndex = invalid_index;
-
-            auto expectedNextFreeIndex = nextFreeIndex_.load(std::memory_order_acquire);
+            auto expectedHead = head.load(std::memory_order_acquire);
+            do
+            {
+                vfs_check(head_index(expectedHead) < lastValidIndex_ || head_index(expectedHead) == invalid_index);
+                setNextFreeIndex(lastIndex, head_index(expectedHead));
+            } while (!head.compare_exchange_weak(expectedHead, make_head(firstIndex, head_tag(expectedHead) + 1), std::memory_order_acq_rel));
+        }
 
-            if (expectedNextFreeIndex != invalid_index)
+        //------------------------------------------------------------------------------------------
+        uint32_t tryPopFreeList(std::atomic<uint64_t> &head)
+        {
+            auto expectedHead = head.load(std::memory_order_acquire);
+            while (head_index(expectedHead) != invalid_index)
             {
-                vfs_check(expectedNextFreeIndex < lastValidIndex_);
-                const auto nextNextFreeIndex = *reinterpret_cast<uint32_t*>(&pArray_[expectedNextFreeIndex]);
+                vfs_check(head_index(expectedHead) < lastValidIndex_);
 
-                if (nextFreeIndex_.compare_exchange_strong(expectedNextFreeIndex, nextNextFreeIndex, std::memory_order_acq_rel))
+                // The slot may be popped and reused concurrently, making this read stale; the tag
+                // makes the exchange below fail in that case.
+                const auto nextIndex = nextFreeIndex(head_index(expectedHead));
+                if (head.compare_exchange_weak(expectedHead, make_head(nextIndex, head_tag(expectedHead) + 1), std::memory_order_acq_rel))
                 {
-                    freeIndex = expectedNextFreeIndex;
+                    return head_index(expectedHead);
                 }
+            }
+            return invalid_index;
+        }
 
-                [[maybe_unused]] const auto i = nextFreeIndex_.load();
-                vfs_check(i < lastValidIndex_ || i == invalid_index);
+        //------------------------------------------------------------------------------------------
+        // Detaches the whole list, its slots then belong to the caller only.
+        uint32_t takeFreeList(std::atomic<uint64_t> &head)
+        {
+            auto expectedHead = head.load(std::memory_order_acquire);
+            while (head_index(expectedHead) != invalid_index)
+            {
+                if (head.compare_exchange_weak(expectedHead, make_head(invalid_index, head_tag(expectedHead) + 1), std::memory_order_acq_rel))
+                {
+                    return head_index(expectedHead);
+                }
             }
-            return freeIndex;
+            return invalid_index;
         }
 
     private:
         //------------------------------------------------------------------------------------------
-        std::atomic<uint32_t>   lastValidIndex_;
-        T                       *pArray_;
-        std::atomic<uint64_t>   *pControlRegister_;
-        std::mutex              mutex_;
-        std::atomic<uint32_t>   size_;
-        uint32_t                pageCount_;
-        uint32_t                controlRegisterPageCount_;
-        std::atomic<uint32_t>   nextFreeIndex_;
+        std::atomic<uint32_t>           lastValidIndex_;
+        T                               *pArray_;
+        std::atomic<uint64_t>           *pControlRegister_;
+        std::atomic<uint32_t>           *pGenerations_;
+        std::unique_ptr<shard[]>        pShards_;
+        std::optional<numa_placement>   placement_;
+        std::atomic<uint32_t>           pageCount_;
+        std::atomic<uint32_t>           controlRegisterPageCount_;
     };
     
+    //----------------------------------------------------------------------------------------------
+    // One virtual_array per NUMA node, each with its pages bound to its node. Threads working on
+    // the elements of local() don't cross the interconnect.
+    template<typename T, uint32_t _MaxElementCount>
+    class numa_virtual_array
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using array_type = virtual_array<T, _MaxElementCount>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        numa_virtual_array()
+        {
+            const auto nodeCount = virtual_allocator::numaNodeCount();
+            arrays_.reserve(nodeCount);
+            for (auto node = 0; node < nodeCount; ++node)
+            {
+                arrays_.emplace_back(numa_placement{ numa_policy::bind, node });
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        int32_t nodeCount() const
+        {
+            return int32_t(arrays_.size());
+        }
+
+        //------------------------------------------------------------------------------------------
+        array_type& node(int32_t node)
+        {
+            return arrays_[node];
+        }
+
+        //------------------------------------------------------------------------------------------
+        const array_type& node(int32_t node) const
+        {
+            return arrays_[node];
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The array of the node the calling thread runs on, threads should be pinned to a node for
+        // this to stay true.
+        array_type& local()
+        {
+            return arrays_[std::min(virtual_allocator::currentNumaNode(), nodeCount() - 1)];
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        std::vector<array_type> arrays_;
+    };
+    //----------------------------------------------------------------------------------------------
+
 } /*vfs*/
@@ -4,11 +4,15 @@
 
 // File interface
 #include "vfs/watcher_interface.hpp"
+#include "vfs/recursive_watcher_interface.hpp"
+#include "vfs/watcher_hub_interface.hpp"
 // Platform specific implementations
 #if VFS_PLATFORM_WIN
 #	include "vfs/win_watcher.hpp"
 #elif VFS_PLATFORM_POSIX
 #   include "vfs/posix_watcher.hpp"
+#   include "vfs/posix_recursive_watcher.hpp"
+#   include "vfs/posix_watcher_hub.hpp"
 #else
 #	error No watcher implementation defined for the current platform
 #endif
@@ -18,5 +22,10 @@ namespace vfs {
 
     //----------------------------------------------------------------------------------------------
     using watcher = watcher_interface<watcher_impl>;
+    //----------------------------------------------------------------------------------------------
+#if VFS_PLATFORM_POSIX
+    using recursive_watcher = recursive_watcher_interface<recursive_watcher_impl>;
+    using watcher_hub       = watcher_hub_interface<watcher_hub_impl>;
+#endif
 
 } /*vfs*/
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <functional>
+
+#include "vfs/path.hpp"
+#include "vfs/recursive_watcher_interface.hpp"
+
+
+namespace vfs {
+
+    //----------------------------------------------------------------------------------------------
+    // Serves many watches from a single thread instead of one watcher object (and its threads)
+    // per directory. Callbacks are handed to the executor, which runs them on the hub thread by
+    // default; give it a thread pool when callbacks are slow.
+    template<typename _Impl>
+    class watcher_hub_interface
+        : _Impl
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using callback_t        = std::function<void(const path&)>;
+        using batch_callback_t  = std::function<void(const std::vector<watch_event>&)>;
+        using task_t            = std::function<void()>;
+        using executor_t        = std::function<void(task_t&&)>;
+        using watch_id          = uint64_t;
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto invalid_watch_id = watch_id(0);
+
+    public:
+        //------------------------------------------------------------------------------------------
+        using base_type = _Impl;
+        using self_type = watcher_hub_interface<_Impl>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        explicit watcher_hub_interface(const executor_t &executor = nullptr)
+            : base_type(executor)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        ~watcher_hub_interface()
+        {
+            stop();
+            wait();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool start()
+        {
+            return base_type::start();
+        }
+        //------------------------------------------------------------------------------------------
+        bool stop()
+        {
+            return base_type::stop();
+        }
+        //------------------------------------------------------------------------------------------
+        void wait()
+        {
+            return base_type::wait();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Same behavior as vfs::watcher: callback(dir) when files or folders are created or deleted
+        // in dir, and every waitTimeout if not 0.
+        template<typename R = int64_t, typename P = std::milli>
+        watch_id addWatch(const path &dir, bool folders, bool files, const callback_t &callback, std::chrono::duration<R, P> waitTimeout = std::chrono::milliseconds(0))
+        {
+            return base_type::addWatch(dir, folders, files, callback, std::chrono::duration_cast<std::chrono::milliseconds>(waitTimeout));
+        }
+        //------------------------------------------------------------------------------------------
+        // Same behavior as vfs::recursive_watcher.
+        template<typename R, typename P>
+        watch_id addRecursiveWatch(const path &dir, bool folders, bool files, const batch_callback_t &callback, std::chrono::duration<R, P> coalescingWindow)
+        {
+            return base_type::addRecursiveWatch(dir, folders, files, callback, std::chrono::duration_cast<std::chrono::milliseconds>(coalescingWindow));
+        }
+        //------------------------------------------------------------------------------------------
+        bool removeWatch(watch_id id)
+        {
+            return base_type::removeWatch(id);
+        }
+        //------------------------------------------------------------------------------------------
+        // Calls the callback of a watch right away, or delivers the pending events of a recursive one.
+        void wakeUp(watch_id id)
+        {
+            return base_type::wakeUp(id);
+        }
+        //------------------------------------------------------------------------------------------
+        size_t watchCount() const
+        {
+            return base_type::watchCount();
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*vfs*/
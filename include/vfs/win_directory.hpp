@@ -2,6 +2,7 @@
 
 #include "vfs/platform.hpp"
 #include "vfs/path.hpp"
+#include "vfs/file_flags.hpp"
 
 
 namespace vfs {
@@ -88,6 +89,83 @@ namespace vfs {
             
             FindClose(hFile);
         }
+
+        //------------------------------------------------------------------------------------------
+        // Calls callback(name, type) for every entry of the directory except . and ..
+        // No path is built, names are only valid during the call.
+        template<typename _Callback>
+        static bool read_entries(const path &dirPath, _Callback &&callback)
+        {
+            return find_entries(dirPath, [&](const WIN32_FIND_DATA &findData)
+            {
+                callback(path::string_view_type(findData.cFileName), to_entry_type(findData.dwFileAttributes));
+            });
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Same as read_entries() with callback(name, type, sizeInBytes, lastWriteTime), the last write
+        // time has the same unit as get_last_write_time(). Comes for free with the find data.
+        template<typename _Callback>
+        static bool read_entries_with_stats(const path &dirPath, _Callback &&callback)
+        {
+            return find_entries(dirPath, [&](const WIN32_FIND_DATA &findData)
+            {
+                const auto sizeInBytes      = int64_t((uint64_t(findData.nFileSizeHigh) << 32ull) | findData.nFileSizeLow);
+                const auto lastWriteTime    = (uint64_t(findData.ftLastWriteTime.dwHighDateTime) << 32ull) | findData.ftLastWriteTime.dwLowDateTime;
+                callback(path::string_view_type(findData.cFileName), to_entry_type(findData.dwFileAttributes), sizeInBytes, lastWriteTime);
+            });
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Calls callback(findData) for every entry except . and ..
+        template<typename _Callback>
+        static bool find_entries(const path &dirPath, _Callback &&callback)
+        {
+            auto findData = WIN32_FIND_DATA{};
+            // Skipping the short names and fetching larger batches makes enumeration noticeably faster.
+            auto hFile = FindFirstFileEx(path::combine(dirPath, path("*")).c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+
+            if (hFile == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            do
+            {
+                const auto name = path::string_view_type(findData.cFileName);
+                if (name == path(".").str() || name == path("..").str())
+                {
+                    continue;
+                }
+
+                callback(findData);
+            } while (FindNextFile(hFile, &findData) != 0);
+
+            const auto errorCode = GetLastError();
+            FindClose(hFile);
+
+            if (errorCode != ERROR_NO_MORE_FILES)
+            {
+                vfs_errorf("FindNextFile(%s) returned error: %s", dirPath.c_str(), get_last_error_as_string(errorCode).c_str());
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static entry_type to_entry_type(DWORD attributes)
+        {
+            if (attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+            {
+                return entry_type::symlink;
+            }
+            if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                return entry_type::directory;
+            }
+            return entry_type::file;
+        }
     };
     //----------------------------------------------------------------------------------------------
 
@@ -161,6 +161,27 @@ namespace vfs {
             return true;
         }
 
+        // Access patterns are chosen when the file is opened (FILE_FLAG_SEQUENTIAL_SCAN), there is nothing to do afterwards.
+        bool advise(access_hint hint, int64_t offset, int64_t sizeInBytes)
+        {
+            vfs_check(isValid());
+            return true;
+        }
+
+        // The cache manager writes back on its own, only synchronous flushes have something to do.
+        bool flush(int64_t offset, int64_t sizeInBytes, flush_mode mode)
+        {
+            vfs_check(isValid());
+
+            if (mode == flush_mode::sync && !FlushFileBuffers(fileHandle_))
+            {
+                const auto errorCode = GetLastError();
+                vfs_errorf("FlushFileBuffers(%s) failed with error: %s", fileName_.c_str(), get_last_error_as_string(errorCode).c_str());
+                return false;
+            }
+            return true;
+        }
+
         bool skip(int64_t offset)
         {
             vfs_check(isValid());
@@ -202,6 +223,76 @@ namespace vfs {
             return numberOfBytesWritten;
         }
 
+        // Positional operations use an OVERLAPPED structure to specify the offset.
+        // Note that on a synchronous handle they still update the file pointer.
+        int64_t readAt(int64_t offset, uint8_t *dst, int64_t sizeInBytes)
+        {
+            vfs_check(isValid());
+
+            auto overlapped         = OVERLAPPED{};
+            overlapped.Offset       = DWORD(offset);
+            overlapped.OffsetHigh   = DWORD(offset >> 32);
+
+            auto numberOfBytesRead = DWORD{ 0 };
+            if (!ReadFile(fileHandle_, (LPVOID)dst, DWORD(sizeInBytes), &numberOfBytesRead, &overlapped))
+            {
+                const auto errorCode = GetLastError();
+                if (errorCode != ERROR_HANDLE_EOF)
+                {
+                    vfs_errorf("ReadFile(%s, %lld, %lu) failed with error: %s", fileName_.c_str(), offset, DWORD(sizeInBytes), get_last_error_as_string(errorCode).c_str());
+                }
+            }
+            return numberOfBytesRead;
+        }
+
+        int64_t writeAt(int64_t offset, const uint8_t *src, int64_t sizeInBytes)
+        {
+            vfs_check(isValid());
+
+            auto overlapped         = OVERLAPPED{};
+            overlapped.Offset       = DWORD(offset);
+            overlapped.OffsetHigh   = DWORD(offset >> 32);
+
+            auto numberOfBytesWritten = DWORD{ 0 };
+            if (!WriteFile(fileHandle_, (LPCVOID)src, DWORD(sizeInBytes), &numberOfBytesWritten, &overlapped))
+            {
+                const auto errorCode = GetLastError();
+                vfs_errorf("WriteFile(%s, %lld, %lu) failed with error: %s", fileName_.c_str(), offset, DWORD(sizeInBytes), get_last_error_as_string(errorCode).c_str());
+            }
+            return numberOfBytesWritten;
+        }
+
+        // There is no vectored equivalent for regular buffered handles, issue one call per buffer.
+        int64_t readvAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            auto totalBytesRead = int64_t(0);
+            for (auto i = 0; i < bufferCount; ++i)
+            {
+                const auto bytesRead = readAt(offset + totalBytesRead, (uint8_t*)buffers[i].data, int64_t(buffers[i].size));
+                totalBytesRead += bytesRead;
+                if (bytesRead < int64_t(buffers[i].size))
+                {
+                    break;
+                }
+            }
+            return totalBytesRead;
+        }
+
+        int64_t writevAt(int64_t offset, const io_vector *buffers, int32_t bufferCount)
+        {
+            auto totalBytesWritten = int64_t(0);
+            for (auto i = 0; i < bufferCount; ++i)
+            {
+                const auto bytesWritten = writeAt(offset + totalBytesWritten, (const uint8_t*)buffers[i].data, int64_t(buffers[i].size));
+                totalBytesWritten += bytesWritten;
+                if (bytesWritten < int64_t(buffers[i].size))
+                {
+                    break;
+                }
+            }
+            return totalBytesWritten;
+        }
+
     private:
         path        fileName_;
         HANDLE      fileHandle_;
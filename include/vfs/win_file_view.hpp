@@ -13,27 +13,51 @@ namespace vfs {
     //----------------------------------------------------------------------------------------------
     class win_file_view
     {
+    protected:
+        //------------------------------------------------------------------------------------------
+        using native_handle = HANDLE;
+
 	protected:
 		//------------------------------------------------------------------------------------------
-        win_file_view(file_sptr spFile, int64_t viewSize)
+        win_file_view(file_sptr spFile, int64_t viewSize, mapping_flags mappingFlags)
+            : win_file_view(std::move(spFile), viewSize, 0, false, mappingFlags)
+        {}
+
+		//------------------------------------------------------------------------------------------
+        // A non zero windowSize only maps a window of that size at a time, the window slides along with the cursor.
+        // Windows has no way to prefetch a range of a file that is not mapped yet, prefetchNextWindow is ignored.
+        // Views cannot grow in place either, mapping_flags::growable is ignored.
+        win_file_view(file_sptr spFile, int64_t viewSize, int64_t windowSize, bool prefetchNextWindow, mapping_flags mappingFlags = mapping_flags::none)
             : spFile_(std::move(spFile))
             , name_(spFile_->fileName())
             , fileMappingHandle_(nullptr)
             , pData_(nullptr)
             , pCursor_(nullptr)
             , mappedTotalSize_(viewSize)
+            , windowSize_(round_up_to_granularity(windowSize))
+            , windowOffset_(0)
+            , viewTotalSize_(0)
+            , fileMapAccess_(0)
+            , mappingFlags_(mappingFlags)
         {
 			vfs_check(spFile_->isValid());
             map(viewSize, false);
         }
 
         //------------------------------------------------------------------------------------------
-        win_file_view(const path &name, int64_t size, bool openExisting)
+        // Large pages need the lock pages in memory privilege, mapping_flags::huge_pages and
+        // mapping_flags::transparent_huge_pages are ignored.
+        win_file_view(const path &name, int64_t size, bool openExisting, mapping_flags mappingFlags)
             : name_(name)
             , fileMappingHandle_(nullptr)
             , pData_(nullptr)
             , pCursor_(nullptr)
             , mappedTotalSize_(size)
+            , windowSize_(0)
+            , windowOffset_(0)
+            , viewTotalSize_(0)
+            , fileMapAccess_(0)
+            , mappingFlags_(mappingFlags)
         {
             map(size, openExisting);
         }
@@ -41,7 +65,7 @@ namespace vfs {
 		//------------------------------------------------------------------------------------------
         ~win_file_view()
         {
-            flush();
+            flush(0, 0, flush_mode::async);
             unmap();
             CloseHandle(fileMappingHandle_);
         }
@@ -94,6 +118,13 @@ namespace vfs {
                 )
             );
 
+            if (isWindowed())
+            {
+                fileMapAccess_  = fileMapAccess;
+                viewTotalSize_  = (viewSize == 0) ? fileTotalSize_ : viewSize;
+                return mapWindow(0);
+            }
+
             // map only allocated size, and allow extension on shared memory
             pData_ = reinterpret_cast<uint8_t*>(MapViewOfFile(fileMappingHandle_, fileMapAccess, 0, 0, viewSize));
             pCursor_ = pData_;
@@ -112,9 +143,109 @@ namespace vfs {
                 mappedTotalSize_ = memInfo.RegionSize;
             }
 
+            viewTotalSize_ = mappedTotalSize_;
+            applyMappingFlags();
+            return true;
+        }
+
+		//------------------------------------------------------------------------------------------
+        // Replaces the current window by the one containing the given offset of the view.
+        bool mapWindow(int64_t offset)
+        {
+            vfs_check(offset >= 0 && offset <= viewTotalSize_);
+
+            // View offsets must be aligned on the allocation granularity. Map the window containing the last byte when asked for the end of the view.
+            const auto windowOffset = std::max(std::min(offset, viewTotalSize_ - 1), int64_t(0)) & ~(allocation_granularity() - 1);
+            const auto windowLength = std::min(windowSize_, viewTotalSize_ - windowOffset);
+
+            unmap();
+            pData_ = pCursor_ = nullptr;
+            mappedTotalSize_ = 0;
+
+            if (windowLength <= 0)
+            {
+                vfs_errorf("Cannot map an empty window of %s", name_.c_str());
+                return false;
+            }
+
+            pData_ = reinterpret_cast<uint8_t*>(MapViewOfFile(fileMappingHandle_, fileMapAccess_, DWORD(windowOffset >> 32), DWORD(windowOffset), SIZE_T(windowLength)));
+            if (pData_ == nullptr)
+            {
+                const auto errorCode = GetLastError();
+                vfs_errorf("MapViewOfFile(%s, %lld, %lld) failed with error: %s", name_.c_str(), windowLength, windowOffset, get_last_error_as_string(errorCode).c_str());
+                return false;
+            }
+
+            pCursor_            = pData_ + (offset - windowOffset);
+            windowOffset_       = windowOffset;
+            mappedTotalSize_    = windowLength;
+            applyMappingFlags();
             return true;
         }
 
+		//------------------------------------------------------------------------------------------
+        // Failures leave a valid but slower mapping.
+        void applyMappingFlags()
+        {
+            if (uint32_t(mappingFlags_) & uint32_t(mapping_flags::populate))
+            {
+                auto range = WIN32_MEMORY_RANGE_ENTRY{ pData_, SIZE_T(mappedTotalSize_) };
+                if (!PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0))
+                {
+                    const auto errorCode = GetLastError();
+                    vfs_errorf("PrefetchVirtualMemory(%s) failed with error: %s", name_.c_str(), get_last_error_as_string(errorCode).c_str());
+                }
+            }
+
+            if ((uint32_t(mappingFlags_) & uint32_t(mapping_flags::lock)) && !VirtualLock(pData_, SIZE_T(mappedTotalSize_)))
+            {
+                const auto errorCode = GetLastError();
+                vfs_errorf("VirtualLock(%s) failed with error: %s", name_.c_str(), get_last_error_as_string(errorCode).c_str());
+            }
+        }
+
+		//------------------------------------------------------------------------------------------
+        // Makes sure the next sizeInBytes bytes after the cursor are mapped (as long as they fit in a window).
+        void ensureMapped(int64_t sizeInBytes)
+        {
+            const auto cursorOffset = pCursor_ - pData_;
+            if (isWindowed() && isValid() && cursorOffset + sizeInBytes > mappedTotalSize_ && position() < viewTotalSize_)
+            {
+                mapWindow(position());
+            }
+        }
+
+		//------------------------------------------------------------------------------------------
+        bool isWindowed() const
+        {
+            return windowSize_ > 0;
+        }
+
+		//------------------------------------------------------------------------------------------
+        // Offset of the cursor from the beginning of the view.
+        int64_t position() const
+        {
+            return windowOffset_ + (pCursor_ - pData_);
+        }
+
+		//------------------------------------------------------------------------------------------
+        static int64_t allocation_granularity()
+        {
+            static const auto granularity = []
+            {
+                auto systemInfo = SYSTEM_INFO{};
+                GetSystemInfo(&systemInfo);
+                return int64_t(systemInfo.dwAllocationGranularity);
+            }();
+            return granularity;
+        }
+
+		//------------------------------------------------------------------------------------------
+        static int64_t round_up_to_granularity(int64_t size)
+        {
+            return (size <= 0) ? 0 : (size + allocation_granularity() - 1) & ~(allocation_granularity() - 1);
+        }
+
 		//------------------------------------------------------------------------------------------
         bool unmap()
         {
@@ -126,10 +257,65 @@ namespace vfs {
         }
 
 		//------------------------------------------------------------------------------------------
-        bool flush()
+        // Offsets are relative to the beginning of the view, only the mapped part of the range is flushed.
+        // FlushViewOfFile() does not wait for the data to reach the disk, FlushFileBuffers() does.
+        bool flush(int64_t offset, int64_t sizeInBytes, flush_mode mode)
+        {
+            if (!isValid())
+            {
+                return false;
+            }
+
+            const auto begin    = std::max(offset - windowOffset_, int64_t(0));
+            const auto end      = std::min(offset - windowOffset_ + ((sizeInBytes == 0) ? viewTotalSize_ - offset : sizeInBytes), mappedTotalSize_);
+            if (begin >= end)
+            {
+                return true;
+            }
+
+            if (!FlushViewOfFile(pData_ + begin, SIZE_T(end - begin)))
+            {
+                const auto errorCode = GetLastError();
+                vfs_errorf("FlushViewOfFile(%s) failed with error: %s", name_.c_str(), get_last_error_as_string(errorCode).c_str());
+                return false;
+            }
+
+            if (mode == flush_mode::sync && spFile_ && !FlushFileBuffers(spFile_->nativeHandle()))
+            {
+                const auto errorCode = GetLastError();
+                vfs_errorf("FlushFileBuffers(%s) failed with error: %s", name_.c_str(), get_last_error_as_string(errorCode).c_str());
+                return false;
+            }
+            return true;
+        }
+
+		//------------------------------------------------------------------------------------------
+        // Offsets are relative to the beginning of the view, a size of 0 means up to the end of the view.
+        // Only access_hint::will_need has an equivalent (PrefetchVirtualMemory), other hints are ignored.
+        bool advise(access_hint hint, int64_t offset, int64_t sizeInBytes)
         {
-            if (!FlushViewOfFile(pData_, 0))
+            if (!isValid())
+            {
+                return false;
+            }
+
+            if (hint != access_hint::will_need)
+            {
+                return true;
+            }
+
+            const auto begin    = std::max(offset - windowOffset_, int64_t(0));
+            const auto end      = std::min(offset - windowOffset_ + ((sizeInBytes == 0) ? viewTotalSize_ - offset : sizeInBytes), mappedTotalSize_);
+            if (begin >= end)
+            {
+                return true;
+            }
+
+            auto range = WIN32_MEMORY_RANGE_ENTRY{ pData_ + begin, SIZE_T(end - begin) };
+            if (!PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0))
             {
+                const auto errorCode = GetLastError();
+                vfs_errorf("PrefetchVirtualMemory(%s) failed with error: %s", name_.c_str(), get_last_error_as_string(errorCode).c_str());
                 return false;
             }
             return true;
@@ -138,6 +324,14 @@ namespace vfs {
 		//------------------------------------------------------------------------------------------
         int64_t read(uint8_t *dst, int64_t sizeInBytes)
         {
+            if (isWindowed())
+            {
+                return transferWindowed(sizeInBytes, [dst](uint8_t *pCursor, int64_t offset, int64_t size)
+                {
+                    memcpy(dst + offset, pCursor, size);
+                });
+            }
+
             if (canMoveCursor(sizeInBytes))
             {
                 memcpy(dst, pCursor_, sizeInBytes);
@@ -150,6 +344,14 @@ namespace vfs {
 		//------------------------------------------------------------------------------------------
         int64_t write(const uint8_t *src, int64_t sizeInBytes)
         {
+            if (isWindowed())
+            {
+                return transferWindowed(sizeInBytes, [src](uint8_t *pCursor, int64_t offset, int64_t size)
+                {
+                    memcpy(pCursor, src + offset, size);
+                });
+            }
+
             if (canMoveCursor(sizeInBytes))
             {
                 memcpy(pCursor_, src, sizeInBytes);
@@ -159,6 +361,33 @@ namespace vfs {
             return 0;
         }
 
+		//------------------------------------------------------------------------------------------
+        // Copies across as many windows as needed.
+        template<typename _Copy>
+        int64_t transferWindowed(int64_t sizeInBytes, _Copy &&copy)
+        {
+            if (!canMoveCursor(sizeInBytes))
+            {
+                return 0;
+            }
+
+            auto totalBytes = int64_t(0);
+            while (totalBytes < sizeInBytes)
+            {
+                ensureMapped(1);
+                if (!isValid())
+                {
+                    break;
+                }
+
+                const auto size = std::min(sizeInBytes - totalBytes, mappedTotalSize_ - (pCursor_ - pData_));
+                copy(pCursor_, totalBytes, size);
+                pCursor_    += size;
+                totalBytes  += size;
+            }
+            return totalBytes;
+        }
+
 		//------------------------------------------------------------------------------------------
         bool isValid() const
         {
@@ -174,6 +403,10 @@ namespace vfs {
 		//------------------------------------------------------------------------------------------
         bool canMoveCursor(int64_t offsetInBytes) const
         {
+            if (isWindowed())
+            {
+                return isValid() && position() + offsetInBytes >= 0 && position() + offsetInBytes <= viewTotalSize_;
+            }
             return isValid() && (pCursor_ - pData_ + offsetInBytes) <= mappedTotalSize_;
         }
 
@@ -194,6 +427,8 @@ namespace vfs {
         template<typename T = uint8_t>
         T* cursor()
         {
+            // A window always holds the cursor and the bytes after it.
+            ensureMapped(sizeof(T));
             return reinterpret_cast<T*>(pCursor_);
         }
 
@@ -202,6 +437,12 @@ namespace vfs {
         {
             if (canMoveCursor(offsetInBytes))
             {
+                const auto cursorOffset = pCursor_ - pData_ + offsetInBytes;
+                if (isWindowed() && (cursorOffset < 0 || cursorOffset > mappedTotalSize_))
+                {
+                    return mapWindow(position() + offsetInBytes);
+                }
+
                 pCursor_ += offsetInBytes;
                 return true;
             }
@@ -216,13 +457,18 @@ namespace vfs {
 
 	private:
 		//------------------------------------------------------------------------------------------
-        file_sptr   spFile_;
-        path        name_;
-        HANDLE      fileMappingHandle_;
-        uint8_t     *pData_;
-        uint8_t     *pCursor_;
-        int64_t     fileTotalSize_;
-        int64_t     mappedTotalSize_;
+        file_sptr       spFile_;
+        path            name_;
+        HANDLE          fileMappingHandle_;
+        uint8_t         *pData_;
+        uint8_t         *pCursor_;
+        int64_t         fileTotalSize_;
+        int64_t         mappedTotalSize_;
+        int64_t         windowSize_;
+        int64_t         windowOffset_;
+        int64_t         viewTotalSize_;
+        DWORD           fileMapAccess_;
+        mapping_flags   mappingFlags_;
     };
     //----------------------------------------------------------------------------------------------
 
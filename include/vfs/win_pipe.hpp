@@ -1,6 +1,8 @@
 #pragma once
 
 #include <chrono>
+#include <vector>
+#include <optional>
 
 #include "vfs/platform.hpp"
 #include "vfs/win_file_flags.hpp"
@@ -51,6 +53,7 @@ namespace vfs {
             : pipeName_(name)
             , pipeHandle_(INVALID_HANDLE_VALUE)
             , fileAccess_(access)
+            , maxMessageSize_(default_max_message_size)
         {
             if (!waitForPipe(NMPWAIT_WAIT_FOREVER))
             {
@@ -90,6 +93,7 @@ namespace vfs {
         )
             : pipeName_(name)
             , fileAccess_(file_access::read_only)
+            , maxMessageSize_(default_max_message_size)
         {
             pipeHandle_ = CreateNamedPipe
             (
@@ -214,11 +218,148 @@ namespace vfs {
             return numberOfBytesWritten;
         }
 
+    protected:
+        //------------------------------------------------------------------------------------------
+        bool writeMessage(const uint8_t *src, int64_t sizeInBytes)
+        {
+            const auto message = io_vector{ const_cast<uint8_t*>(src), size_t(sizeInBytes) };
+            return writeMessages(&message, 1) == 1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // There is no gather write on pipes, the messages are packed in a buffer written at once.
+        int64_t writeMessages(const io_vector *messages, int64_t messageCount)
+        {
+            auto buffer = std::vector<uint8_t>{};
+            for (auto i = int64_t(0); i < messageCount; ++i)
+            {
+                if (messages[i].size > UINT32_MAX)
+                {
+                    vfs_errorf("Cannot send a message of %zu bytes, the maximum is %u", messages[i].size, UINT32_MAX);
+                    messageCount = i;
+                    break;
+                }
+
+                const auto header = uint32_t(messages[i].size);
+                buffer.insert(buffer.end(), reinterpret_cast<const uint8_t*>(&header), reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+                buffer.insert(buffer.end(), static_cast<const uint8_t*>(messages[i].data), static_cast<const uint8_t*>(messages[i].data) + messages[i].size);
+            }
+
+            auto totalBytesWritten = int64_t(0);
+            while (totalBytesWritten < int64_t(buffer.size()))
+            {
+                const auto bytesWritten = write(buffer.data() + totalBytesWritten, int64_t(buffer.size()) - totalBytesWritten);
+                if (bytesWritten == 0)
+                {
+                    return 0;
+                }
+                totalBytesWritten += bytesWritten;
+            }
+            return messageCount;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setMaxMessageSize(int64_t maxMessageSize)
+        {
+            maxMessageSize_ = maxMessageSize;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t readMessage(uint8_t *dst, int64_t capacity)
+        {
+            auto header = uint32_t(0);
+            if (!readHeader(header))
+            {
+                return -1;
+            }
+            if (int64_t(header) > capacity)
+            {
+                // Like on posix the message stays in the pipe, the next read gets it.
+                vfs_errorf("Message of %u bytes does not fit in %lld bytes", header, capacity);
+                pendingHeader_ = header;
+                return -1;
+            }
+            return readAll(dst, header) ? int64_t(header) : -1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Visitor>
+        int64_t readMessages(_Visitor &&visitor, int64_t maxMessageCount)
+        {
+            auto messageCount   = int64_t(0);
+            auto message        = std::vector<uint8_t>{};
+            // Blocks for the first message only.
+            while (messageCount < maxMessageCount && (messageCount == 0 || availableBytesToRead() >= int64_t(sizeof(uint32_t))))
+            {
+                auto header = uint32_t(0);
+                if (!readHeader(header))
+                {
+                    break;
+                }
+                message.resize(header);
+                if (!readAll(message.data(), header))
+                {
+                    break;
+                }
+                ++messageCount;
+                visitor(static_cast<const uint8_t*>(message.data()), int64_t(header));
+            }
+            return messageCount;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // A named pipe cannot be peeked while waiting, the header of a message too large for the
+        // last readMessage() is kept instead.
+        bool readHeader(uint32_t &header)
+        {
+            if (pendingHeader_)
+            {
+                header = *pendingHeader_;
+                pendingHeader_.reset();
+                return true;
+            }
+            if (!readAll(reinterpret_cast<uint8_t*>(&header), sizeof(header)))
+            {
+                return false;
+            }
+            if (int64_t(header) > maxMessageSize_)
+            {
+                vfs_errorf("Message of %u bytes is larger than the maximum of %lld bytes, closing %s", header, maxMessageSize_, pipeName_.c_str());
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool readAll(uint8_t *dst, int64_t sizeInBytes)
+        {
+            auto totalBytesRead = int64_t(0);
+            while (totalBytesRead < sizeInBytes)
+            {
+                const auto bytesRead = read(dst + totalBytesRead, sizeInBytes - totalBytesRead);
+                if (bytesRead == 0)
+                {
+                    return false;
+                }
+                totalBytesRead += bytesRead;
+            }
+            return true;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Same default as the posix pipes, a message header cannot make a read allocate more.
+        static constexpr auto default_max_message_size = int64_t(64 * 1024 * 1024);
+
     private:
         //------------------------------------------------------------------------------------------
-        path        pipeName_;
-        HANDLE      pipeHandle_;
-        file_access fileAccess_;
+        path                    pipeName_;
+        HANDLE                  pipeHandle_;
+        file_access             fileAccess_;
+        std::optional<uint32_t> pendingHeader_;
+        int64_t                 maxMessageSize_;
     };
 
 } /*vfs*/
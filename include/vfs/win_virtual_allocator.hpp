@@ -20,10 +20,40 @@ namespace vfs {
             return VirtualAlloc(pAddr, size, MEM_COMMIT, PAGE_READWRITE);
         }
         //------------------------------------------------------------------------------------------
-        static bool deallocate(void *pAddr)
+        // Only binding is supported, the other policies fall back to the default placement.
+        static void* commit(void *pAddr, int64_t size, numa_placement placement)
+        {
+            if (placement.policy == numa_policy::bind)
+            {
+                return VirtualAllocExNuma(GetCurrentProcess(), pAddr, size, MEM_COMMIT, PAGE_READWRITE, DWORD(placement.node));
+            }
+            return commit(pAddr, size);
+        }
+        //------------------------------------------------------------------------------------------
+        static bool decommit(void *pAddr, int64_t size)
+        {
+            return VirtualFree(pAddr, size, MEM_DECOMMIT) == TRUE;
+        }
+        //------------------------------------------------------------------------------------------
+        // The whole reservation is always released, size is only needed in posix.
+        static bool deallocate(void *pAddr, int64_t)
         {
             return VirtualFree(pAddr, 0, MEM_RELEASE) == TRUE;
         }
+        //------------------------------------------------------------------------------------------
+        static int32_t numaNodeCount()
+        {
+            auto highestNode = ULONG(0);
+            return GetNumaHighestNodeNumber(&highestNode) ? int32_t(highestNode) + 1 : 1;
+        }
+        //------------------------------------------------------------------------------------------
+        static int32_t currentNumaNode()
+        {
+            auto processor  = PROCESSOR_NUMBER{};
+            auto node       = USHORT(0);
+            GetCurrentProcessorNumberEx(&processor);
+            return GetNumaProcessorNodeEx(&processor, &node) ? int32_t(node) : 0;
+        }
     };
     
 } /*vfs*/
@@ -29,3 +29,166 @@ TEST_CASE("Directory.", "[directory]")
         REQUIRE(vfs::directory::exists(path));
     }
 }
+
+TEST_CASE("Parallel directory scan.", "[directory]")
+{
+    // 3 levels of 4 subdirectories, each directory holds 5 files.
+    constexpr auto subDirectoryCount    = 4;
+    constexpr auto fileCount            = 5;
+    const auto root                     = vfs::path(test_directory + "\\test\\scan");
+
+    auto directories = std::vector<vfs::path>{ root };
+    for (auto first = size_t(0), level = size_t(0); level < 3; ++level)
+    {
+        const auto last = directories.size();
+        for (auto d = first; d < last; ++d)
+        {
+            for (auto i = 0; i < subDirectoryCount; ++i)
+            {
+                directories.emplace_back(vfs::path::combine(directories[d], "dir" + std::to_string(i)));
+            }
+        }
+        first = last;
+    }
+    for (const auto &dir : directories)
+    {
+        vfs::create_path(dir);
+        for (auto i = 0; i < fileCount; ++i)
+        {
+            std::ofstream(vfs::path::combine(dir, "file" + std::to_string(i) + ".txt").str());
+        }
+    }
+
+    const auto acceptAll = [](const vfs::directory_entry &) { return true; };
+
+    SECTION("we find every file of the tree")
+    {
+        const auto files = vfs::find_files(root, acceptAll, vfs::scan_options{ .threadCount = 4 });
+        REQUIRE(files.size() == directories.size() * fileCount);
+
+        auto uniqueFiles = std::unordered_set<std::string>{};
+        for (const auto &f : files)
+        {
+            REQUIRE(vfs::file::exists(f));
+            uniqueFiles.insert(f.str());
+        }
+        REQUIRE(uniqueFiles.size() == files.size());
+    }
+
+    SECTION("we can limit the depth")
+    {
+        REQUIRE(vfs::find_files(root, acceptAll, vfs::scan_options{ .recurseToDepth = 0 }).size() == fileCount);
+        REQUIRE(vfs::find_files(root, acceptAll, vfs::scan_options{ .recurseToDepth = 1, .threadCount = 3 }).size() == (1 + 4) * fileCount);
+    }
+
+    SECTION("the filter prunes subtrees and files")
+    {
+        const auto files = vfs::find_files(root, [](const vfs::directory_entry &entry)
+        {
+            if (entry.type == vfs::entry_type::directory)
+            {
+                return entry.name != "dir0";
+            }
+            return entry.name == "file0.txt";
+        }, vfs::scan_options{ .threadCount = 2 });
+        // root + 3 + 9 + 27 directories.
+        REQUIRE(files.size() == 1 + 3 + 9 + 27);
+    }
+
+    SECTION("entries are visited once with their depth")
+    {
+        auto directoryCount = std::atomic<int32_t>(0);
+        auto maxDepth       = std::atomic<int32_t>(0);
+        vfs::directory::parallel_scan(root, acceptAll, [&](const vfs::directory_entry &entry, vfs::path &)
+        {
+            if (entry.type == vfs::entry_type::directory)
+            {
+                ++directoryCount;
+                auto depth = maxDepth.load();
+                while (entry.depth > depth && !maxDepth.compare_exchange_weak(depth, entry.depth));
+            }
+        });
+        REQUIRE(directoryCount == int32_t(directories.size()) - 1);
+        REQUIRE(maxDepth == 2);
+    }
+
+    SECTION("an exception thrown by a callback stops the scan and reaches the caller")
+    {
+        const auto throwing = [](const vfs::directory_entry &entry, vfs::path &)
+        {
+            if (entry.depth == 2 && entry.name == "file0.txt")
+            {
+                throw std::runtime_error("visitor failed");
+            }
+        };
+        REQUIRE_THROWS_AS(vfs::directory::parallel_scan(root, acceptAll, throwing, vfs::scan_options{ .threadCount = 4 }), std::runtime_error);
+        // Whichever worker throws, the calling thread included.
+        REQUIRE_THROWS_AS(vfs::directory::parallel_scan(root, [](const vfs::directory_entry &) -> bool { throw std::runtime_error("filter failed"); }, throwing, vfs::scan_options{ .threadCount = 4 }), std::runtime_error);
+    }
+}
+
+TEST_CASE("Directory snapshot.", "[directory]")
+{
+    const auto root = vfs::path(test_directory + "\\test\\snapshot");
+    vfs::create_path(vfs::path::combine(root, "a\\aa"));
+    vfs::create_path(vfs::path::combine(root, "b"));
+    {
+        auto spFile = vfs::open_write_only(vfs::path::combine(root, "a\\aa\\text.txt"), vfs::file_creation_options::create_or_overwrite);
+        spFile->write(text);
+    }
+    std::ofstream(vfs::path::combine(root, "b\\empty.txt").str());
+    std::ofstream(vfs::path::combine(root, "root.txt").str());
+
+    SECTION("the whole tree is captured")
+    {
+        const auto snapshot = vfs::directory::snapshot(root);
+        REQUIRE(snapshot.size() == 1 + 3 + 1 + 1 + 1);
+        REQUIRE(snapshot[0].type == vfs::entry_type::directory);
+        REQUIRE(snapshot[0].childCount == 3);
+        REQUIRE(snapshot.fullPath(0).str() == root.str());
+
+        auto textIndex = vfs::directory_snapshot::invalid_index;
+        auto previousDepth = 0;
+        snapshot.visit_breadth_first([&](uint32_t index, const vfs::directory_snapshot::entry &entry)
+        {
+            REQUIRE(entry.depth >= previousDepth);
+            previousDepth = entry.depth;
+            if (snapshot.name(index) == "text.txt")
+            {
+                textIndex = index;
+            }
+        });
+
+        REQUIRE(textIndex != vfs::directory_snapshot::invalid_index);
+        REQUIRE(snapshot[textIndex].depth == 3);
+        REQUIRE(snapshot[textIndex].sizeInBytes == int64_t(text.size()));
+        REQUIRE(snapshot.fullPath(textIndex).str() == vfs::path::combine(root, "a\\aa\\text.txt").str());
+        REQUIRE(snapshot.name(snapshot[snapshot[textIndex].parentIndex].parentIndex) == "a");
+    }
+
+    SECTION("depth first visits parents right before their subtree")
+    {
+        const auto snapshot = vfs::directory::snapshot(root);
+
+        auto order = std::vector<std::string>{};
+        snapshot.visit_depth_first([&](uint32_t index, const vfs::directory_snapshot::entry &)
+        {
+            order.emplace_back(snapshot.fullPath(index).str());
+        });
+        REQUIRE(order.size() == snapshot.size());
+
+        const auto aIndex   = std::find(order.begin(), order.end(), vfs::path::combine(root, "a").str()) - order.begin();
+        REQUIRE(order[aIndex + 1] == vfs::path::combine(root, "a\\aa").str());
+        REQUIRE(order[aIndex + 2] == vfs::path::combine(root, "a\\aa\\text.txt").str());
+    }
+
+    SECTION("we can limit the depth")
+    {
+        const auto snapshot = vfs::directory::snapshot(root, 0);
+        REQUIRE(snapshot.size() == 1 + 3);
+        for (const auto &child : snapshot.children(0))
+        {
+            REQUIRE(child.childCount == 0);
+        }
+    }
+}
@@ -462,3 +462,462 @@ TEST_CASE("File.", "[file]")
         }
     }
 }
+
+TEST_CASE("Positional file access.", "[file]")
+{
+    vfs::create_path(test_directory + "\\test\\positional");
+
+    constexpr auto threadCount      = 4;
+    constexpr auto recordsPerThread = 64;
+
+    auto spFile = vfs::open_read_write(vfs::path(test_directory + "\\test\\positional\\test0.txt"), vfs::file_creation_options::create_or_overwrite);
+    REQUIRE(spFile->isValid());
+
+    SECTION("many threads can read and write through the same descriptor")
+    {
+        auto threads = std::vector<std::thread>{};
+        for (auto t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&spFile, t]
+            {
+                for (auto i = t; i < threadCount * recordsPerThread; i += threadCount)
+                {
+                    spFile->writeAt(i * sizeof(uint64_t), uint64_t(i));
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(spFile->size() == threadCount * recordsPerThread * sizeof(uint64_t));
+
+        auto isValid = std::atomic<bool>(true);
+        threads.clear();
+        for (auto t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&spFile, &isValid, t]
+            {
+                for (auto i = threadCount * recordsPerThread - 1 - t; i >= 0; i -= threadCount)
+                {
+                    auto value = uint64_t(0);
+                    if (spFile->readAt(i * sizeof(uint64_t), value) != sizeof(uint64_t) || value != uint64_t(i))
+                    {
+                        isValid = false;
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(isValid);
+
+        // The cursor was never moved.
+        auto value = uint64_t(42);
+        REQUIRE(spFile->read(value) == sizeof(uint64_t));
+        REQUIRE(value == 0);
+    }
+
+    SECTION("we can gather writes and scatter reads")
+    {
+        auto header = uint32_t(text.size());
+        auto buffers = std::vector<vfs::io_vector>
+        {
+            { &header,                  sizeof(header) },
+            { (void*)text.data(),       text.size() },
+            { (void*)text2.data(),      text2.size() },
+        };
+        REQUIRE(spFile->writevAt(16, buffers.data(), int32_t(buffers.size())) == sizeof(header) + text.size() + text2.size());
+
+        auto headerRead = uint32_t(0);
+        auto textRead   = std::string(text.size(), '\0');
+        auto text2Read  = std::string(text2.size(), '\0');
+        buffers =
+        {
+            { &headerRead,              sizeof(headerRead) },
+            { textRead.data(),          textRead.size() },
+            { text2Read.data(),         text2Read.size() },
+        };
+        REQUIRE(spFile->readvAt(16, buffers.data(), int32_t(buffers.size())) == sizeof(header) + text.size() + text2.size());
+        REQUIRE(headerRead == header);
+        REQUIRE(textRead == text);
+        REQUIRE(text2Read == text2);
+    }
+}
+
+TEST_CASE("Buffered file.", "[file]")
+{
+    vfs::create_path(test_directory + "\\test\\buffered");
+
+    const auto fileName = vfs::path(test_directory + "\\test\\buffered\\test0.txt");
+    constexpr auto valueCount = 10000;
+
+    SECTION("small writes are coalesced")
+    {
+        {
+            auto spFile = vfs::open_buffered(fileName, vfs::file_access::read_write, vfs::file_creation_options::create_or_overwrite, 4096);
+            REQUIRE(spFile->isValid());
+
+            for (auto i = 0; i < valueCount; ++i)
+            {
+                REQUIRE(spFile->write(int32_t(i)) == sizeof(int32_t));
+            }
+
+            // Only full buffers reached the file so far.
+            REQUIRE(spFile->size() == (valueCount * sizeof(int32_t) / 4096) * 4096);
+            REQUIRE(spFile->flush());
+            REQUIRE(spFile->size() == valueCount * sizeof(int32_t));
+        }
+
+        auto spFile = vfs::open_buffered(fileName, vfs::file_access::read_only, vfs::file_creation_options::open_if_existing, 4096);
+        REQUIRE(spFile->isValid());
+
+        auto isValid = true;
+        for (auto i = 0; i < valueCount; ++i)
+        {
+            auto value = int32_t(-1);
+            isValid &= spFile->read(value) == sizeof(int32_t) && value == i;
+        }
+        REQUIRE(isValid);
+
+        auto value = int32_t(-1);
+        REQUIRE(spFile->read(value) == 0);
+    }
+
+    SECTION("reads and writes can be interleaved")
+    {
+        auto spFile = vfs::open_buffered(fileName, vfs::file_access::read_write, vfs::file_creation_options::create_or_overwrite, 1024);
+        REQUIRE(spFile->isValid());
+
+        REQUIRE(spFile->write(text) == text.size());
+
+        auto spReader = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing);
+        auto v = std::vector<uint8_t>(text.size());
+        REQUIRE(spReader->read(v) == 0);
+
+        // Reading flushes pending writes, the cursor is now at the end of the file.
+        auto c = char(0);
+        REQUIRE(spFile->read(c) == 0);
+        REQUIRE(spFile->size() == int64_t(text.size()));
+
+        // Rewind, read a few bytes (which reads ahead a whole buffer) then overwrite the next ones.
+        spFile->skip(-int64_t(text.size()));
+        auto header = std::string(5, '\0');
+        REQUIRE(spFile->read(header) == 5);
+        REQUIRE(header == text.substr(0, 5));
+        REQUIRE(spFile->write("-----", true) == 5);
+        REQUIRE(spFile->flush());
+
+        auto content = std::string(text.size(), '\0');
+        REQUIRE(spFile->readAt(0, content.data(), content.size()) == text.size());
+        REQUIRE(content == text.substr(0, 5) + "-----" + text.substr(10));
+    }
+
+    SECTION("positional reads and writes see the buffers")
+    {
+        auto spFile = vfs::open_buffered(fileName, vfs::file_access::read_write, vfs::file_creation_options::create_or_overwrite, 1024);
+        REQUIRE(spFile->isValid());
+
+        // Still in the write buffer.
+        REQUIRE(spFile->write(text) == text.size());
+        auto content = std::string(text.size(), '\0');
+        REQUIRE(spFile->readAt(0, content.data(), content.size()) == text.size());
+        REQUIRE(content == text);
+
+        // Read a few bytes ahead of a positional write over the next ones.
+        spFile->skip(-int64_t(text.size()));
+        auto header = std::string(5, '\0');
+        REQUIRE(spFile->read(header) == 5);
+        REQUIRE(spFile->writeAt(5, "-----", 5) == 5);
+        auto next = std::string(5, '\0');
+        REQUIRE(spFile->read(next) == 5);
+        REQUIRE(next == "-----");
+    }
+}
+
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Async file.", "[asyncfile]")
+{
+    vfs::create_path(test_directory + "\\test\\async");
+
+    constexpr auto blockCount = 32;
+    const auto fileName = vfs::path(test_directory + "\\test\\async\\test0.txt");
+
+    SECTION("we can keep many reads and writes in flight")
+    {
+        auto spFile = vfs::open_async(fileName, vfs::file_access::read_write, vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(spFile->isValid());
+
+        for (auto i = 0; i < blockCount; ++i)
+        {
+            REQUIRE(spFile->writeAsync(i * text.size(), (const uint8_t*)text.data(), text.size(), i));
+        }
+        REQUIRE(spFile->submit() == blockCount);
+
+        auto completions = std::vector<vfs::io_completion>(blockCount);
+        auto reaped = 0;
+        while (reaped < blockCount)
+        {
+            const auto count = spFile->complete(completions.data() + reaped, blockCount - reaped, 1);
+            REQUIRE(count > 0);
+            reaped += count;
+        }
+
+        for (const auto &completion : completions)
+        {
+            REQUIRE(completion.result == int64_t(text.size()));
+        }
+        REQUIRE(spFile->size() == int64_t(blockCount * text.size()));
+        REQUIRE(spFile->inFlightCount() == 0);
+
+        auto buffer = std::vector<char>(blockCount * text.size());
+        for (auto i = 0; i < blockCount; ++i)
+        {
+            REQUIRE(spFile->readAsync(i * text.size(), (uint8_t*)buffer.data() + i * text.size(), text.size(), i));
+        }
+        REQUIRE(spFile->submit() == blockCount);
+        REQUIRE(spFile->complete(completions.data(), blockCount, blockCount) == blockCount);
+
+        auto seenBlocks = std::unordered_set<uint64_t>{};
+        for (const auto &completion : completions)
+        {
+            REQUIRE(completion.result == int64_t(text.size()));
+            seenBlocks.insert(completion.userData);
+        }
+        REQUIRE(seenBlocks.size() == blockCount);
+
+        for (auto i = 0; i < blockCount; ++i)
+        {
+            REQUIRE(memcmp(buffer.data() + i * text.size(), text.data(), text.size()) == 0);
+        }
+    }
+
+    SECTION("the thread pool emulation behaves like io_uring")
+    {
+        auto spFile = vfs::open_read_write(fileName, vfs::file_creation_options::open_or_create);
+        REQUIRE(spFile->isValid());
+
+        auto ring = vfs::posix_io_ring(8, true);
+        REQUIRE(!ring.isUsingIoUring());
+
+        // More requests than the queue depth.
+        for (auto i = 0; i < blockCount; ++i)
+        {
+            REQUIRE(ring.prepareWrite(spFile->nativeHandle(), i * text2.size(), (const uint8_t*)text2.data(), text2.size(), i));
+        }
+        REQUIRE(ring.submit() == blockCount);
+
+        auto completions = std::vector<vfs::io_completion>(blockCount);
+        REQUIRE(ring.complete(completions.data(), blockCount, blockCount) == blockCount);
+        for (const auto &completion : completions)
+        {
+            REQUIRE(completion.result == int64_t(text2.size()));
+        }
+
+        auto buffer = std::vector<char>(text2.size());
+        REQUIRE(ring.prepareRead(-1, 0, (uint8_t*)buffer.data(), buffer.size(), 0));
+        REQUIRE(ring.prepareRead(spFile->nativeHandle(), (blockCount - 1) * text2.size(), (uint8_t*)buffer.data(), buffer.size(), 1));
+        REQUIRE(ring.submit() == 2);
+        REQUIRE(ring.complete(completions.data(), 2, 2) == 2);
+        for (auto i = 0; i < 2; ++i)
+        {
+            REQUIRE(completions[i].result == (completions[i].userData == 0 ? -EBADF : int64_t(text2.size())));
+        }
+        REQUIRE(memcmp(buffer.data(), text2.data(), text2.size()) == 0);
+    }
+}
+#endif
+
+TEST_CASE("File access hints.", "[file]")
+{
+    vfs::create_path(test_directory + "\\test\\hints");
+
+    const auto fileName = vfs::path(test_directory + "\\test\\hints\\test0.txt");
+
+    {
+        auto spFile = vfs::open_write_only(fileName, vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(spFile->write(text) == text.size());
+    }
+
+    SECTION("we can hint the access pattern of a file")
+    {
+        auto spFile = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing, vfs::file_flags::sequential_scan);
+        REQUIRE(spFile->isValid());
+        REQUIRE(spFile->advise(vfs::access_hint::random));
+        REQUIRE(spFile->advise(vfs::access_hint::will_need, 0, 64));
+        REQUIRE(spFile->advise(vfs::access_hint::dont_need));
+        REQUIRE(spFile->advise(vfs::access_hint::huge_page));
+        REQUIRE(spFile->advise(vfs::access_hint::normal));
+
+        auto textRead = std::string(text.size(), '\0');
+        REQUIRE(spFile->read(textRead) == text.size());
+        REQUIRE(textRead == text);
+    }
+
+    SECTION("we can hint the access pattern of a file view")
+    {
+        auto spFileView = vfs::open_read_only_view(fileName, vfs::file_creation_options::open_if_existing);
+        REQUIRE(spFileView->isValid());
+        REQUIRE(spFileView->advise(vfs::access_hint::sequential));
+        REQUIRE(spFileView->advise(vfs::access_hint::will_need, 100, 100));
+        REQUIRE(spFileView->advise(vfs::access_hint::random));
+
+        auto textRead = std::string(text.size(), '\0');
+        REQUIRE(spFileView->read(textRead) == text.size());
+        REQUIRE(textRead == text);
+    }
+}
+
+TEST_CASE("File flush.", "[file]")
+{
+    vfs::create_path(test_directory + "\\test\\flush");
+
+    const auto fileName = vfs::path(test_directory + "\\test\\flush\\test0.txt");
+
+    SECTION("we can write back a range of a file, or make it durable")
+    {
+        auto spFile = vfs::open_read_write(fileName, vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(spFile->write(text) == text.size());
+        REQUIRE(spFile->flush(0, 100, vfs::flush_mode::async));
+        REQUIRE(spFile->flush(100, 0, vfs::flush_mode::async));
+        REQUIRE(spFile->flush());
+
+        auto spBufferedFile = vfs::open_buffered(fileName, vfs::file_access::read_write, vfs::file_creation_options::open_if_existing);
+        REQUIRE(spBufferedFile->write(text2) == text2.size());
+        REQUIRE(spBufferedFile->flush(0, 0, vfs::flush_mode::sync));
+        REQUIRE(spFile->size() == int64_t(text2.size()));
+    }
+
+    SECTION("we can flush a range of a file view")
+    {
+        auto spFileView = vfs::open_read_write_view(fileName, vfs::file_creation_options::create_or_overwrite, vfs::file_flags::none, vfs::file_attributes::normal, text.size());
+        REQUIRE(spFileView->write(text) == text.size());
+        REQUIRE(spFileView->flush(10, 100));
+        REQUIRE(spFileView->flush(0, 0, vfs::flush_mode::sync));
+
+        auto spFile     = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing);
+        auto textRead   = std::string(text.size(), '\0');
+        REQUIRE(spFile->read(textRead) == text.size());
+        REQUIRE(textRead == text);
+    }
+
+    SECTION("commits of many threads share synchronous flushes")
+    {
+        constexpr auto threadCount      = 4;
+        constexpr auto recordsPerThread = 32;
+
+        auto spFile         = vfs::open_read_write(fileName, vfs::file_creation_options::create_or_overwrite);
+        auto groupCommit    = vfs::group_commit<vfs::file_stream>(spFile);
+        auto failedCount    = std::atomic<int32_t>(0);
+
+        auto threads = std::vector<std::thread>{};
+        for (auto t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                for (auto i = t; i < threadCount * recordsPerThread; i += threadCount)
+                {
+                    spFile->writeAt(i * sizeof(uint64_t), uint64_t(i));
+                    if (!groupCommit.commit())
+                    {
+                        ++failedCount;
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(failedCount == 0);
+        REQUIRE(groupCommit.flushCount() > 0);
+        REQUIRE(groupCommit.flushCount() <= threadCount * recordsPerThread);
+        REQUIRE(spFile->size() == threadCount * recordsPerThread * sizeof(uint64_t));
+    }
+}
+
+TEST_CASE("Cold sequential scan.", "[.][benchmark]")
+{
+    vfs::create_path(test_directory + "\\test\\hints");
+
+    const auto fileName         = vfs::path(test_directory + "\\test\\hints\\large.bin");
+    constexpr auto fileSize     = int64_t(256 * 1024 * 1024);
+    constexpr auto chunkSize    = int64_t(64 * 1024);
+
+    auto chunk = std::vector<uint8_t>(chunkSize, 0xAB);
+    {
+        auto spFile = vfs::open_write_only(fileName, vfs::file_creation_options::create_or_overwrite);
+        for (auto i = int64_t(0); i < fileSize; i += chunkSize)
+        {
+            spFile->write(chunk);
+        }
+#if VFS_PLATFORM_POSIX
+        // Dirty pages cannot be dropped from the page cache.
+        fsync(spFile->nativeHandle());
+#endif
+    }
+
+    const auto coldScan = [&](vfs::file_flags flags, vfs::access_hint hint)
+    {
+        auto spFile = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing, flags);
+        spFile->advise(vfs::access_hint::dont_need);
+        spFile->advise(hint);
+
+        auto totalBytesRead = int64_t(0);
+        while (const auto bytesRead = spFile->read(chunk))
+        {
+            totalBytesRead += bytesRead;
+        }
+        return totalBytesRead;
+    };
+
+    BENCHMARK("file without hint")
+    {
+        return coldScan(vfs::file_flags::none, vfs::access_hint::normal);
+    };
+
+    BENCHMARK("file with sequential_scan")
+    {
+        return coldScan(vfs::file_flags::sequential_scan, vfs::access_hint::sequential);
+    };
+
+    BENCHMARK("file with random hint")
+    {
+        return coldScan(vfs::file_flags::none, vfs::access_hint::random);
+    };
+
+    const auto coldViewScan = [&](vfs::access_hint hint)
+    {
+        {
+            auto spFile = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing);
+            spFile->advise(vfs::access_hint::dont_need);
+        }
+
+        auto spFileView = vfs::open_read_only_view(fileName, vfs::file_creation_options::open_if_existing);
+        spFileView->advise(hint);
+
+        // Touch one byte per page.
+        auto checksum = uint64_t(0);
+        for (auto i = int64_t(0); i < fileSize; i += 4096)
+        {
+            checksum += *spFileView->cursor<uint8_t>();
+            spFileView->skip(4096);
+        }
+        return checksum;
+    };
+
+    BENCHMARK("file view without hint")
+    {
+        return coldViewScan(vfs::access_hint::normal);
+    };
+
+    BENCHMARK("file view with sequential hint")
+    {
+        return coldViewScan(vfs::access_hint::sequential);
+    };
+}
@@ -285,3 +285,247 @@ TEST_CASE("Fileview.", "[fileview]")
         }
     }
 }
+
+TEST_CASE("Windowed fileview.", "[fileview]")
+{
+    vfs::create_path(test_directory + "\\test\\windowview");
+
+    const auto fileName         = vfs::path(test_directory + "\\test\\windowview\\test0.txt");
+    constexpr auto valueCount   = 300000;
+    constexpr auto windowSize   = 64 * 1024;
+
+    {
+        auto spFile = vfs::open_write_only(fileName, vfs::file_creation_options::create_or_overwrite);
+        auto values = std::vector<uint32_t>(valueCount);
+        for (auto i = 0u; i < values.size(); ++i)
+        {
+            values[i] = i;
+        }
+        REQUIRE(spFile->write(values) == valueCount * sizeof(uint32_t));
+    }
+
+    SECTION("we can stream a file larger than the window")
+    {
+        auto spFileView = vfs::open_read_only_window_view(fileName, vfs::file_creation_options::open_if_existing, windowSize);
+        REQUIRE(spFileView != nullptr);
+        REQUIRE(spFileView->isValid());
+        REQUIRE(spFileView->totalSize() == valueCount * sizeof(uint32_t));
+
+        auto isValid = true;
+        for (auto i = 0u; i < valueCount; ++i)
+        {
+            auto value = uint32_t(-1);
+            isValid &= spFileView->read(value) == sizeof(uint32_t) && value == i;
+        }
+        REQUIRE(isValid);
+
+        // End of the view.
+        auto value = uint32_t(0);
+        REQUIRE(spFileView->read(value) == 0);
+        REQUIRE(!spFileView->skip(1));
+
+        // Going back to a window already released.
+        REQUIRE(spFileView->skip(-int64_t(valueCount * sizeof(uint32_t))));
+        REQUIRE(*spFileView->cursor<uint32_t>() == 0);
+
+        // Reads spanning several windows.
+        constexpr auto firstIndex = windowSize / sizeof(uint32_t) - 1;
+        REQUIRE(spFileView->skip(firstIndex * sizeof(uint32_t)));
+        auto values = std::vector<uint32_t>(2 * windowSize / sizeof(uint32_t));
+        REQUIRE(spFileView->read(values.data(), values.size()) == values.size() * sizeof(uint32_t));
+        for (auto i = 0u; i < values.size(); ++i)
+        {
+            isValid &= values[i] == firstIndex + i;
+        }
+        REQUIRE(isValid);
+    }
+
+    SECTION("access hints follow the window")
+    {
+        auto spFileView = vfs::open_read_only_window_view(fileName, vfs::file_creation_options::open_if_existing, windowSize, false);
+        REQUIRE(spFileView->advise(vfs::access_hint::sequential));
+        // Outside of the current window, nothing to do.
+        REQUIRE(spFileView->advise(vfs::access_hint::will_need, 4 * windowSize, windowSize));
+
+        auto isValid = true;
+        for (auto i = 0u; i < valueCount; ++i)
+        {
+            auto value = uint32_t(-1);
+            isValid &= spFileView->read(value) == sizeof(uint32_t) && value == i;
+        }
+        REQUIRE(isValid);
+    }
+
+    SECTION("populated and locked windows hold the content of the file")
+    {
+        const auto flags = vfs::mapping_flags::populate | vfs::mapping_flags::lock;
+        auto spFileView = vfs::open_read_only_window_view(fileName, vfs::file_creation_options::open_if_existing, windowSize, false, vfs::file_flags::none, vfs::file_attributes::normal, flags);
+        REQUIRE(spFileView != nullptr);
+        REQUIRE(spFileView->isValid());
+
+        auto isValid = true;
+        for (auto i = 0u; i < valueCount; ++i)
+        {
+            auto value = uint32_t(-1);
+            isValid &= spFileView->read(value) == sizeof(uint32_t) && value == i;
+        }
+        REQUIRE(isValid);
+
+        auto spWritableView = vfs::open_read_write_window_view(fileName, vfs::file_creation_options::open_if_existing, windowSize, false, vfs::file_flags::none, vfs::file_attributes::normal, 0, flags);
+        REQUIRE(spWritableView != nullptr);
+        REQUIRE(spWritableView->isValid());
+        REQUIRE(spWritableView->skip(2 * windowSize));
+        REQUIRE(*spWritableView->cursor<uint32_t>() == 2 * windowSize / sizeof(uint32_t));
+    }
+
+    SECTION("we can write through a sliding window")
+    {
+        auto spFileView = vfs::open_read_write_window_view(fileName, vfs::file_creation_options::open_if_existing, windowSize);
+        REQUIRE(spFileView != nullptr);
+        REQUIRE(spFileView->isValid());
+
+        for (auto i = 0u; i < valueCount; ++i)
+        {
+            *spFileView->cursor<uint32_t>() = valueCount - i;
+            spFileView->skip(sizeof(uint32_t));
+        }
+        spFileView.reset();
+
+        auto spFile = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing);
+        auto values = std::vector<uint32_t>(valueCount);
+        REQUIRE(spFile->read(values) == valueCount * sizeof(uint32_t));
+
+        auto isValid = true;
+        for (auto i = 0u; i < valueCount; ++i)
+        {
+            isValid &= values[i] == valueCount - i;
+        }
+        REQUIRE(isValid);
+    }
+}
+
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Growable fileview.", "[fileview]")
+{
+    vfs::create_path(test_directory + "\\test\\growable");
+    const auto fileName     = vfs::path(test_directory + "\\test\\growable\\log.bin");
+    constexpr auto count    = 100000u;
+
+    auto spFileView = vfs::open_growable_view(fileName, vfs::file_creation_options::create_or_overwrite);
+    REQUIRE(spFileView != nullptr);
+    REQUIRE(spFileView->isValid());
+    REQUIRE(spFileView->totalSize() == 0);
+
+    // Appending remaps the view many times, the first address stays valid.
+    const auto pFirst   = spFileView->cursor<uint32_t>();
+    auto isValid        = true;
+    for (auto i = 0u; i < count; ++i)
+    {
+        isValid &= spFileView->write(i) == sizeof(uint32_t);
+    }
+    REQUIRE(isValid);
+    REQUIRE(spFileView->totalSize() == count * sizeof(uint32_t));
+    REQUIRE(spFileView->cursor<uint32_t>() == pFirst + count);
+    for (auto i = 0u; i < count; ++i)
+    {
+        isValid &= pFirst[i] == i;
+    }
+    REQUIRE(isValid);
+
+    // Nothing can be read past what was written.
+    auto value = uint32_t(0);
+    REQUIRE(spFileView->read(value) == 0);
+
+    SECTION("the file is truncated to what was written")
+    {
+        spFileView.reset();
+        REQUIRE(std::filesystem::file_size(test_directory + "/test/growable/log.bin") == count * sizeof(uint32_t));
+
+        SECTION("and can be appended to through the cursor")
+        {
+            spFileView = vfs::open_growable_view(fileName, vfs::file_creation_options::open_if_existing);
+            REQUIRE(spFileView->totalSize() == count * sizeof(uint32_t));
+            REQUIRE(spFileView->skip(spFileView->totalSize()));
+
+            for (auto i = 0u; i < count; ++i)
+            {
+                *spFileView->cursor<uint32_t>() = count + i;
+                spFileView->skip(sizeof(uint32_t));
+            }
+            REQUIRE(spFileView->totalSize() == 2 * count * sizeof(uint32_t));
+            spFileView.reset();
+
+            auto spFile = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing);
+            auto values = std::vector<uint32_t>(2 * count);
+            REQUIRE(spFile->size() == 2 * count * sizeof(uint32_t));
+            REQUIRE(spFile->read(values) == 2 * count * sizeof(uint32_t));
+            for (auto i = 0u; i < 2 * count; ++i)
+            {
+                isValid &= values[i] == i;
+            }
+            REQUIRE(isValid);
+        }
+    }
+
+    SECTION("read only views do not grow")
+    {
+        spFileView.reset();
+        auto spReadOnlyView = vfs::open_read_only_view(fileName, vfs::file_creation_options::open_if_existing);
+        REQUIRE(spReadOnlyView->totalSize() == count * sizeof(uint32_t));
+    }
+}
+#endif
+
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Mirrored view.", "[fileview]")
+{
+    auto spView = vfs::create_mirrored_view("vfs_mirrored_view", 1);
+    REQUIRE(spView->isValid());
+
+    const auto size = spView->totalSize();
+    REQUIRE(size > int64_t(text.size()));
+
+    SECTION("both halves map the same memory")
+    {
+        *spView->data(10) = 'a';
+        REQUIRE(spView->data(10)[size] == 'a');
+
+        spView->data(size + 20)[size] = 'b';
+        REQUIRE(*spView->data(20) == 'b');
+        REQUIRE(spView->data(-1) == spView->data(size - 1));
+    }
+
+    SECTION("records crossing the end of the view stay contiguous")
+    {
+        // Place the cursor so the text crosses the end of the buffer.
+        REQUIRE(spView->skip(size - 100));
+        auto pRecord = spView->cursor();
+        REQUIRE(spView->write(reinterpret_cast<const uint8_t*>(text.data()), text.size()) == text.size());
+        REQUIRE(spView->cursor() == spView->data(text.size() - 100));
+
+        REQUIRE(memcmp(pRecord, text.data(), text.size()) == 0);
+        REQUIRE(memcmp(spView->data(0), text.data() + 100, text.size() - 100) == 0);
+
+        REQUIRE(spView->skip(-int64_t(text.size())));
+        auto textRead = std::string(text.size(), '\0');
+        REQUIRE(spView->read(reinterpret_cast<uint8_t*>(textRead.data()), textRead.size()) == textRead.size());
+        REQUIRE(textRead == text);
+    }
+
+    SECTION("transfers larger than the view fail")
+    {
+        auto buffer = std::vector<uint8_t>(size + 1);
+        REQUIRE(spView->write(buffer.data(), buffer.size()) == 0);
+        REQUIRE(spView->cursor() == spView->data(0));
+    }
+
+    SECTION("an empty view is invalid")
+    {
+        auto spEmpty = vfs::create_mirrored_view("vfs_empty_mirrored_view", 0);
+        REQUIRE_FALSE(spEmpty->isValid());
+        REQUIRE(spEmpty->nativeHandle() == -1);
+        REQUIRE(spEmpty->data(10) == nullptr);
+        REQUIRE_FALSE(spEmpty->skip(10));
+    }
+}
+#endif
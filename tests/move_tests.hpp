@@ -83,3 +83,107 @@ TEST_CASE("Move Directory.", "[movedirectory]")
         }
     }
 }
+
+TEST_CASE("Copy file.", "[movedirectory]")
+{
+    vfs::create_path(test_directory + "\\test\\copy");
+
+    const auto src = vfs::path(test_directory + "\\test\\copy\\src.txt");
+    const auto dst = vfs::path(test_directory + "\\test\\copy\\dst.txt");
+
+    {
+        auto spFile = vfs::open_write_only(src, vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(spFile->write(text) == text.size());
+    }
+    vfs::file::delete_file(dst);
+
+    SECTION("we can copy a file")
+    {
+        REQUIRE(vfs::file::copy(src, dst));
+        REQUIRE(vfs::file::exists(src));
+
+        auto spFile = vfs::open_read_only(dst, vfs::file_creation_options::open_if_existing);
+        auto textRead = std::string(text.size(), '\0');
+        REQUIRE(spFile->size() == int64_t(text.size()));
+        REQUIRE(spFile->read(textRead) == text.size());
+        REQUIRE(textRead == text);
+
+        // The destination already exists.
+        REQUIRE(!vfs::file::copy(src, dst, false));
+        REQUIRE(vfs::file::copy(src, dst, true));
+    }
+
+    SECTION("sparse files keep their holes")
+    {
+        constexpr auto holeSize = int64_t(16 * 1024 * 1024);
+        {
+            auto spFile = vfs::open_read_write(src, vfs::file_creation_options::create_or_overwrite);
+            REQUIRE(spFile->writeAt(holeSize, (const uint8_t*)text.data(), text.size()) == text.size());
+            REQUIRE(spFile->writeAt(3 * holeSize, (const uint8_t*)text2.data(), text2.size()) == text2.size());
+            REQUIRE(spFile->resize(5 * holeSize));
+        }
+
+        REQUIRE(vfs::file::copy(src, dst));
+
+        auto spFile = vfs::open_read_only(dst, vfs::file_creation_options::open_if_existing);
+        REQUIRE(spFile->size() == 5 * holeSize);
+
+        auto textRead = std::string(text.size(), '\0');
+        REQUIRE(spFile->readAt(holeSize, (uint8_t*)textRead.data(), textRead.size()) == text.size());
+        REQUIRE(textRead == text);
+        REQUIRE(spFile->readAt(3 * holeSize, (uint8_t*)textRead.data(), textRead.size()) == text2.size());
+        REQUIRE(textRead == text2);
+
+        auto zeros = std::vector<uint8_t>(4096, 0xFF);
+        REQUIRE(spFile->readAt(2 * holeSize, zeros.data(), int64_t(zeros.size())) == zeros.size());
+        REQUIRE(std::all_of(zeros.begin(), zeros.end(), [](uint8_t b) { return b == 0; }));
+
+#if VFS_PLATFORM_POSIX
+        struct stat st;
+        REQUIRE(stat(dst.c_str(), &st) == 0);
+        // Far less than the 80MB of apparent size were allocated.
+        REQUIRE(st.st_blocks * 512 < holeSize);
+#endif
+    }
+
+#if VFS_PLATFORM_POSIX
+    SECTION("a failed copy leaves no destination behind")
+    {
+        // Writes past the file size limit fail with EFBIG instead of raising SIGXFSZ.
+        const auto previousHandler = signal(SIGXFSZ, SIG_IGN);
+        struct rlimit previousLimit;
+        REQUIRE(getrlimit(RLIMIT_FSIZE, &previousLimit) == 0);
+        auto limit = previousLimit;
+        limit.rlim_cur = rlim_t(text.size() / 2);
+        REQUIRE(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+        const auto isCopied = vfs::file::copy(src, dst, false, 3);
+
+        REQUIRE(setrlimit(RLIMIT_FSIZE, &previousLimit) == 0);
+        signal(SIGXFSZ, previousHandler);
+
+        REQUIRE(!isCopied);
+        REQUIRE(!vfs::file::exists(dst));
+
+        // Nothing is left in the way of the next attempt.
+        REQUIRE(vfs::file::copy(src, dst, false));
+        auto spFile = vfs::open_read_only(dst, vfs::file_creation_options::open_if_existing);
+        REQUIRE(spFile->size() == int64_t(text.size()));
+    }
+
+    SECTION("we can move a file to another filesystem")
+    {
+        const auto shmDst = vfs::path("/dev/shm/vfs_move_test.txt");
+        vfs::file::delete_file(shmDst);
+
+        REQUIRE(vfs::file::move(src, shmDst, true));
+        REQUIRE(!vfs::file::exists(src));
+
+        auto spFile = vfs::open_read_only(shmDst, vfs::file_creation_options::open_if_existing);
+        auto textRead = std::string(text.size(), '\0');
+        REQUIRE(spFile->read(textRead) == text.size());
+        REQUIRE(textRead == text);
+        vfs::file::delete_file(shmDst);
+    }
+#endif
+}
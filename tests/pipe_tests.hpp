@@ -0,0 +1,418 @@
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Pipe messages.", "[pipe]")
+{
+    vfs::create_path(test_directory + "\\test\\pipe");
+    const auto pipeName = vfs::path(test_directory + "\\test\\pipe\\messages");
+
+    // The server listens as soon as it is created, the client waits in the backlog until accepted.
+    auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+    REQUIRE(spServer->isValid());
+    auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+    REQUIRE(spClient->isValid());
+    REQUIRE(spServer->waitForConnection());
+
+    SECTION("we can send messages of any size")
+    {
+        const auto big = std::vector<uint8_t>(200000, 0x5a);
+        REQUIRE(spClient->writeMessage(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+        REQUIRE(spClient->writeMessage(nullptr, 0));
+        // Larger than the pipe buffer, the reader must run while it's being written.
+        auto writer = std::thread([&spClient, &big]() { spClient->writeMessage(big.data(), big.size()); });
+
+        auto message = std::vector<uint8_t>(big.size());
+        REQUIRE(spServer->readMessage(message.data(), message.size()) == int64_t(text.size()));
+        REQUIRE(memcmp(message.data(), text.data(), text.size()) == 0);
+        REQUIRE(spServer->readMessage(message.data(), message.size()) == 0);
+        REQUIRE(spServer->readMessage(message.data(), message.size()) == int64_t(big.size()));
+        REQUIRE(message == big);
+        writer.join();
+    }
+
+    SECTION("a message too large for the destination stays in the pipe")
+    {
+        REQUIRE(spClient->writeMessage(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+
+        auto message = std::vector<uint8_t>(text.size());
+        REQUIRE(spServer->readMessage(message.data(), 10) == -1);
+        REQUIRE(spServer->readMessage(message.data(), message.size()) == int64_t(text.size()));
+    }
+
+    SECTION("we can send and receive messages in batches")
+    {
+        auto messages = std::vector<vfs::io_vector>{};
+        auto payloads = std::vector<std::string>{};
+        for (auto i = 0; i < 1000; ++i)
+        {
+            payloads.push_back(std::to_string(i));
+        }
+        for (auto &payload : payloads)
+        {
+            messages.push_back(vfs::io_vector{ payload.data(), payload.size() });
+        }
+        REQUIRE(spServer->writeMessages(messages.data(), messages.size()) == int64_t(messages.size()));
+
+        auto received = std::vector<std::string>{};
+        while (received.size() < payloads.size())
+        {
+            const auto count = spClient->readMessages([&received](const uint8_t *pData, int64_t size)
+            {
+                received.emplace_back(reinterpret_cast<const char*>(pData), size);
+            });
+            REQUIRE(count > 0);
+        }
+        REQUIRE(received == payloads);
+
+        // The visitor is called at most maxMessageCount times.
+        REQUIRE(spServer->writeMessages(messages.data(), 3) == 3);
+        auto visitedCount = 0;
+        REQUIRE(spClient->readMessages([&visitedCount](const uint8_t *, int64_t) { ++visitedCount; }, 2) == 2);
+        REQUIRE(visitedCount == 2);
+    }
+
+    SECTION("we know how many bytes are waiting")
+    {
+        REQUIRE(spServer->availableBytesToRead() == 0);
+        REQUIRE(spClient->writeMessage(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+        REQUIRE(spClient->writeMessage(reinterpret_cast<const uint8_t*>(text.data()), 10));
+        REQUIRE(spServer->availableBytesToRead() == int64_t(text.size() + 10 + 2 * sizeof(uint32_t)));
+
+        // Bytes received along with the first message are still counted.
+        auto message = std::vector<uint8_t>(text.size());
+        REQUIRE(spServer->readMessage(message.data(), message.size()) == int64_t(text.size()));
+        REQUIRE(spServer->availableBytesToRead() == int64_t(10 + sizeof(uint32_t)));
+    }
+
+    SECTION("a message larger than the maximum closes the pipe")
+    {
+        spServer->setMaxMessageSize(int64_t(text.size()) - 1);
+        REQUIRE(spClient->writeMessage(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+
+        auto message = std::vector<uint8_t>(text.size());
+        REQUIRE(spServer->readMessage(message.data(), message.size()) == -1);
+        REQUIRE(!spServer->isValid());
+    }
+
+    SECTION("reading a closed pipe fails")
+    {
+        spClient->close();
+        auto message = std::vector<uint8_t>(16);
+        REQUIRE(spServer->readMessage(message.data(), message.size()) == -1);
+        REQUIRE(spServer->readMessages([](const uint8_t *, int64_t) {}) == 0);
+    }
+}
+
+TEST_CASE("Pipe handles.", "[pipe]")
+{
+    vfs::create_path(test_directory + "\\test\\pipe");
+    const auto pipeName = vfs::path(test_directory + "\\test\\pipe\\handles");
+
+    auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+    REQUIRE(spServer->isValid());
+    auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+    REQUIRE(spClient->isValid());
+    REQUIRE(spServer->waitForConnection());
+
+    SECTION("both ends of the pipe map the same shared memory")
+    {
+        constexpr auto size = int64_t(4 * 1024 * 1024);
+        auto spMemory       = vfs::create_anonymous_shared_memory(size);
+        REQUIRE(spMemory->isValid());
+        REQUIRE(spMemory->totalSize() == size);
+        memcpy(spMemory->cursor(), text.data(), text.size());
+
+        const auto description = std::string("frame");
+        REQUIRE(spClient->writeHandle(spMemory->nativeHandle(), reinterpret_cast<const uint8_t*>(description.data()), description.size()));
+
+        auto handle         = vfs::pipe::native_handle(-1);
+        auto received       = std::string(16, '\0');
+        const auto length   = spServer->readHandle(handle, reinterpret_cast<uint8_t*>(received.data()), received.size());
+        REQUIRE(length == int64_t(description.size()));
+        received.resize(length);
+        REQUIRE(received == description);
+        REQUIRE(handle != -1);
+        REQUIRE(handle != spMemory->nativeHandle());
+
+        auto spView = vfs::open_view_from_handle(handle, vfs::file_access::read_write);
+        REQUIRE(spView->isValid());
+        REQUIRE(spView->totalSize() == size);
+        REQUIRE(memcmp(spView->cursor(), text.data(), text.size()) == 0);
+
+        // No copy was made, writes on one side show up on the other.
+        spView->cursor()[size - 1] = 0x5a;
+        REQUIRE(spMemory->cursor()[size - 1] == 0x5a);
+    }
+
+    SECTION("a file opened by one end can be mapped by the other")
+    {
+        auto spFile = vfs::open_read_write(vfs::path(test_directory + "\\test\\pipe\\handles.txt"), vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(spFile->isValid());
+        REQUIRE(spFile->write(reinterpret_cast<const uint8_t*>(text.data()), text.size()) == text.size());
+        REQUIRE(spServer->writeHandle(spFile->nativeHandle()));
+
+        auto handle = vfs::pipe::native_handle(-1);
+        REQUIRE(spClient->readHandle(handle) == 0);
+        auto spView = vfs::open_view_from_handle(handle, vfs::file_access::read_only);
+        REQUIRE(spView->isValid());
+        REQUIRE(spView->totalSize() == int64_t(text.size()));
+        REQUIRE(memcmp(spView->cursor(), text.data(), text.size()) == 0);
+    }
+
+    SECTION("handles stay with their messages")
+    {
+        auto spFirst    = vfs::create_anonymous_shared_memory(4096);
+        auto spSecond   = vfs::create_anonymous_shared_memory(8192);
+        const auto one  = uint8_t(1);
+        REQUIRE(spClient->writeHandle(spFirst->nativeHandle(), &one, 1));
+        REQUIRE(spClient->writeMessage(&one, 1));
+        REQUIRE(spClient->writeHandle(spSecond->nativeHandle(), &one, 1));
+        REQUIRE(spClient->writeMessage(&one, 1));
+
+        // Message reads close the handle of a message, the next handle read is the one sent with it.
+        auto byte = uint8_t(0);
+        REQUIRE(spServer->readMessage(&byte, 1) == 1);
+        auto handle = vfs::pipe::native_handle(-1);
+        REQUIRE(spServer->readHandle(handle, &byte, 1) == 1);
+        REQUIRE(handle == -1);
+        REQUIRE(spServer->readHandle(handle, &byte, 1) == 1);
+        auto spView = vfs::open_view_from_handle(handle, vfs::file_access::read_write);
+        REQUIRE(spView->totalSize() == 8192);
+        REQUIRE(spServer->readHandle(handle, &byte, 1) == 1);
+        REQUIRE(handle == -1);
+    }
+}
+
+TEST_CASE("Pipe server.", "[pipe]")
+{
+    vfs::create_path(test_directory + "\\test\\pipe");
+    const auto pipeName = vfs::path(test_directory + "\\test\\pipe\\server");
+    constexpr auto maxMessageSize = int64_t(4 * 1024 * 1024);
+
+    // Echoes every message back to its sender.
+    auto connectedCount     = std::atomic<int32_t>(0);
+    auto disconnectedCount  = std::atomic<int32_t>(0);
+    auto lastConnectedId    = std::atomic<vfs::pipe_server::connection_id>(0);
+    auto pServer            = static_cast<vfs::pipe_server*>(nullptr);
+    auto server             = vfs::pipe_server(pipeName,
+    {
+        [&connectedCount, &lastConnectedId](vfs::pipe_server::connection_id id) { ++connectedCount; lastConnectedId = id; },
+        [&pServer](vfs::pipe_server::connection_id id, const uint8_t *pData, int64_t size) { pServer->send(id, pData, size); },
+        [&disconnectedCount](vfs::pipe_server::connection_id) { ++disconnectedCount; },
+    }, maxMessageSize);
+    pServer = &server;
+    REQUIRE(server.isValid());
+    REQUIRE(server.start());
+
+    SECTION("one thread serves many clients")
+    {
+        constexpr auto clientCount = 200;
+        auto clients = std::vector<vfs::pipe_sptr>{};
+        for (auto i = 0; i < clientCount; ++i)
+        {
+            clients.push_back(vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write));
+            REQUIRE(clients.back()->isValid());
+        }
+
+        // Every client sends before any reads, replies queue up on the server side meanwhile.
+        for (auto round = 0; round < 3; ++round)
+        {
+            for (auto i = 0; i < clientCount; ++i)
+            {
+                const auto message = std::to_string(i) + ":" + std::to_string(round);
+                REQUIRE(clients[i]->writeMessage(reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+            }
+            for (auto i = 0; i < clientCount; ++i)
+            {
+                const auto expected = std::to_string(i) + ":" + std::to_string(round);
+                auto reply          = std::string(64, '\0');
+                const auto size     = clients[i]->readMessage(reinterpret_cast<uint8_t*>(reply.data()), reply.size());
+                REQUIRE(size == int64_t(expected.size()));
+                reply.resize(size);
+                REQUIRE(reply == expected);
+            }
+        }
+        REQUIRE(connectedCount == clientCount);
+        REQUIRE(server.connectionCount() == clientCount);
+
+        clients.clear();
+        for (auto i = 0; i < 1000 && disconnectedCount < clientCount; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        REQUIRE(disconnectedCount == clientCount);
+        REQUIRE(server.connectionCount() == 0);
+    }
+
+    SECTION("large messages go through in both directions")
+    {
+        auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+        const auto big = std::vector<uint8_t>(1 << 20, 0x5a);
+
+        // Larger than the socket buffers, the server queues the reply until the client reads.
+        auto writer = std::thread([&spClient, &big]() { spClient->writeMessage(big.data(), big.size()); });
+        auto reply  = std::vector<uint8_t>(big.size());
+        REQUIRE(spClient->readMessage(reply.data(), reply.size()) == int64_t(big.size()));
+        REQUIRE(reply == big);
+        writer.join();
+    }
+
+    SECTION("messages sent with a handle reach the server without it")
+    {
+        auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+        auto spMemory = vfs::create_anonymous_shared_memory(4096);
+        const auto message = std::string("with a handle");
+        REQUIRE(spClient->writeHandle(spMemory->nativeHandle(), reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+
+        auto reply = std::string(64, '\0');
+        REQUIRE(spClient->readMessage(reinterpret_cast<uint8_t*>(reply.data()), reply.size()) == int64_t(message.size()));
+        reply.resize(message.size());
+        REQUIRE(reply == message);
+    }
+
+    SECTION("clients announcing a message larger than the maximum are disconnected")
+    {
+        auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+        // Only the header is sent, the server must not wait for (or make room for) the rest.
+        const auto header = uint32_t(maxMessageSize + 1);
+        REQUIRE(spClient->write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == int64_t(sizeof(header)));
+
+        auto reply = std::string(16, '\0');
+        REQUIRE(spClient->readMessage(reinterpret_cast<uint8_t*>(reply.data()), reply.size()) == -1);
+        for (auto i = 0; i < 1000 && disconnectedCount < 1; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        REQUIRE(disconnectedCount == 1);
+    }
+
+    SECTION("the server can disconnect a client")
+    {
+        auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+        const auto message = std::string("ping");
+        REQUIRE(spClient->writeMessage(reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+        auto reply = std::string(16, '\0');
+        REQUIRE(spClient->readMessage(reinterpret_cast<uint8_t*>(reply.data()), reply.size()) == 4);
+
+        REQUIRE_FALSE(server.disconnect(lastConnectedId + 1));
+        REQUIRE_FALSE(server.send(lastConnectedId + 1, nullptr, 0));
+        REQUIRE(server.disconnect(lastConnectedId));
+        REQUIRE(spClient->readMessage(reinterpret_cast<uint8_t*>(reply.data()), reply.size()) == -1);
+        for (auto i = 0; i < 1000 && disconnectedCount < 1; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        REQUIRE(disconnectedCount == 1);
+    }
+}
+
+TEST_CASE("Pipe message rate.", "[.][benchmark]")
+{
+    vfs::create_path(test_directory + "\\test\\pipe");
+    const auto pipeName = vfs::path(test_directory + "\\test\\pipe\\rate");
+
+    auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+    auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+    spServer->waitForConnection();
+
+    // 64 byte messages, the reader drains them with readMessages() in every case.
+    constexpr auto messageCount = 100000;
+    constexpr auto batchSize    = 64;
+    const auto payload          = std::vector<uint8_t>(64, 0x5a);
+
+    const auto measure = [&](Catch::Benchmark::Chronometer &meter, const auto &send)
+    {
+        meter.measure([&]()
+        {
+            auto reader = std::thread([&spServer]()
+            {
+                auto receivedCount = int64_t(0);
+                while (receivedCount < messageCount)
+                {
+                    const auto count = spServer->readMessages([](const uint8_t *, int64_t) {});
+                    if (count == 0)
+                    {
+                        break;
+                    }
+                    receivedCount += count;
+                }
+            });
+            send();
+            reader.join();
+            return messageCount;
+        });
+    };
+
+    BENCHMARK_ADVANCED("size and body written separately")(Catch::Benchmark::Chronometer meter)
+    {
+        measure(meter, [&]()
+        {
+            const auto header = uint32_t(payload.size());
+            for (auto i = 0; i < messageCount; ++i)
+            {
+                spClient->write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+                spClient->write(payload.data(), payload.size());
+            }
+        });
+    };
+
+    BENCHMARK_ADVANCED("writeMessage")(Catch::Benchmark::Chronometer meter)
+    {
+        measure(meter, [&]()
+        {
+            for (auto i = 0; i < messageCount; ++i)
+            {
+                spClient->writeMessage(payload.data(), payload.size());
+            }
+        });
+    };
+
+    BENCHMARK_ADVANCED("writeMessages in batches of 64")(Catch::Benchmark::Chronometer meter)
+    {
+        auto messages = std::vector<vfs::io_vector>(batchSize, vfs::io_vector{ const_cast<uint8_t*>(payload.data()), payload.size() });
+        measure(meter, [&]()
+        {
+            for (auto i = 0; i < messageCount; i += batchSize)
+            {
+                spClient->writeMessages(messages.data(), std::min(batchSize, messageCount - i));
+            }
+        });
+    };
+}
+
+TEST_CASE("Pipe handle handoff.", "[.][benchmark]")
+{
+    vfs::create_path(test_directory + "\\test\\pipe");
+    const auto pipeName = vfs::path(test_directory + "\\test\\pipe\\handoff");
+
+    auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+    auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+    spServer->waitForConnection();
+
+    // The reader ends up with 16MB it can read in both cases.
+    constexpr auto size = int64_t(16 * 1024 * 1024);
+    auto spMemory       = vfs::create_anonymous_shared_memory(size);
+    memset(spMemory->cursor(), 0x5a, size);
+
+    BENCHMARK_ADVANCED("copied through the pipe")(Catch::Benchmark::Chronometer meter)
+    {
+        auto received = std::vector<uint8_t>(size);
+        meter.measure([&]()
+        {
+            auto writer = std::thread([&]() { spClient->writeMessage(spMemory->cursor(), size); });
+            const auto receivedSize = spServer->readMessage(received.data(), received.size());
+            writer.join();
+            return receivedSize;
+        });
+    };
+
+    BENCHMARK_ADVANCED("handle sent and mapped")(Catch::Benchmark::Chronometer meter)
+    {
+        meter.measure([&]()
+        {
+            spClient->writeHandle(spMemory->nativeHandle());
+            auto handle = vfs::pipe::native_handle(-1);
+            spServer->readHandle(handle);
+            return vfs::open_view_from_handle(handle, vfs::file_access::read_only)->totalSize();
+        });
+    };
+}
+#endif
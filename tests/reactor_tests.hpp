@@ -0,0 +1,264 @@
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Reactor.", "[reactor]")
+{
+    vfs::create_path(test_directory + "\\test\\reactor");
+    auto reactor = vfs::reactor{};
+    REQUIRE(reactor.isValid());
+
+    SECTION("tasks return values and rethrow exceptions to the awaiting task")
+    {
+        const auto square = [](int32_t value) -> vfs::task<int32_t> { co_return value * value; };
+        const auto fail   = []() -> vfs::task<> { throw std::runtime_error("failed"); co_return; };
+
+        auto sum        = 0;
+        auto isThrown   = false;
+        reactor.spawn([&]() -> vfs::task<>
+        {
+            for (auto i = 1; i <= 10; ++i)
+            {
+                sum += co_await square(i);
+            }
+            try
+            {
+                co_await fail();
+            }
+            catch (const std::runtime_error &)
+            {
+                isThrown = true;
+            }
+        }());
+        REQUIRE(reactor.run());
+        REQUIRE(sum == 385);
+        REQUIRE(isThrown);
+    }
+
+    SECTION("exceptions thrown out of spawned tasks are rethrown by run()")
+    {
+        auto isResumed = false;
+        reactor.spawn([]() -> vfs::task<> { throw std::runtime_error("failed"); co_return; }());
+        reactor.spawn([&]() -> vfs::task<> { isResumed = true; co_return; }());
+        REQUIRE_THROWS_AS(reactor.run(), std::runtime_error);
+        REQUIRE(reactor.run());
+        REQUIRE(isResumed);
+    }
+
+    SECTION("forgotten handles resume their waiters")
+    {
+        const auto pipeName = vfs::path(test_directory + "\\test\\reactor\\forgotten");
+        auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+        auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+        REQUIRE(spServer->waitForConnection());
+
+        auto bytesRead = int64_t(-1);
+        auto buffer    = std::vector<uint8_t>(16);
+        reactor.spawn([&]() -> vfs::task<> { bytesRead = co_await reactor.read(*spServer, buffer.data(), buffer.size()); }());
+        // Runs once the reading task is suspended, nothing is ever sent.
+        reactor.spawn([&]() -> vfs::task<> { reactor.forget(spServer->nativeHandle()); spServer->close(); co_return; }());
+        REQUIRE(reactor.run());
+        REQUIRE(bytesRead == 0);
+    }
+
+    SECTION("many pipe clients are served by coroutines on a single thread")
+    {
+        constexpr auto clientCount  = 100;
+        constexpr auto messageSize  = 64 * 1024;
+
+        auto servers = std::vector<vfs::pipe_sptr>{};
+        auto clients = std::vector<vfs::pipe_sptr>{};
+        for (auto i = 0; i < clientCount; ++i)
+        {
+            const auto pipeName = vfs::path(test_directory + "\\test\\reactor\\echo" + std::to_string(i));
+            servers.push_back(vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex));
+            clients.push_back(vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write));
+        }
+
+        // Echoes what it receives, the messages are larger than the socket buffers so each side
+        // suspends many times.
+        const auto echo = [&reactor](vfs::pipe_stream &server) -> vfs::task<>
+        {
+            if (!co_await reactor.accept(server))
+            {
+                co_return;
+            }
+            auto buffer = std::vector<uint8_t>(messageSize);
+            const auto bytesRead = co_await reactor.read(server, buffer.data(), buffer.size());
+            co_await reactor.write(server, buffer.data(), bytesRead);
+        };
+
+        auto echoedCount = 0;
+        const auto call = [&reactor, &echoedCount](vfs::pipe_stream &client, uint8_t seed) -> vfs::task<>
+        {
+            auto message = std::vector<uint8_t>(messageSize);
+            for (auto i = size_t(0); i < message.size(); ++i)
+            {
+                message[i] = uint8_t(seed + i);
+            }
+            auto reply = std::vector<uint8_t>(messageSize);
+            co_await reactor.write(client, message.data(), message.size());
+            if (co_await reactor.read(client, reply.data(), reply.size()) == int64_t(reply.size()) && reply == message)
+            {
+                ++echoedCount;
+            }
+        };
+
+        for (auto i = 0; i < clientCount; ++i)
+        {
+            reactor.spawn(echo(*servers[i]));
+            reactor.spawn(call(*clients[i], uint8_t(i)));
+        }
+        REQUIRE(reactor.run());
+        REQUIRE(echoedCount == clientCount);
+    }
+
+    SECTION("file reads and writes at an offset are batched")
+    {
+        constexpr auto blockCount   = 64;
+        constexpr auto blockSize    = 4096;
+        auto spFile = vfs::open_read_write(test_directory + "\\test\\reactor\\blocks.bin", vfs::file_creation_options::create_or_overwrite);
+
+        auto blocks = std::vector<std::vector<uint8_t>>{};
+        for (auto i = 0; i < blockCount; ++i)
+        {
+            blocks.emplace_back(blockSize, uint8_t(i));
+        }
+
+        auto matchCount = 0;
+        const auto roundTrip = [&](int32_t index) -> vfs::task<>
+        {
+            const auto offset = int64_t(index) * blockSize;
+            if (co_await reactor.writeAt(*spFile, offset, blocks[index].data(), blockSize) != blockSize)
+            {
+                co_return;
+            }
+            auto block = std::vector<uint8_t>(blockSize);
+            if (co_await reactor.readAt(*spFile, offset, block.data(), blockSize) == blockSize && block == blocks[index])
+            {
+                ++matchCount;
+            }
+        };
+
+        for (auto i = 0; i < blockCount; ++i)
+        {
+            reactor.spawn(roundTrip(i));
+        }
+        REQUIRE(reactor.run());
+        REQUIRE(matchCount == blockCount);
+        REQUIRE(spFile->size() == blockCount * blockSize);
+    }
+
+    SECTION("requests in flight are waited for when the reactor is destroyed")
+    {
+        constexpr auto requestCount = 32;
+        constexpr auto requestSize  = 1024 * 1024;
+        auto spFile = vfs::open_read_write(test_directory + "\\test\\reactor\\inflight.bin", vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(spFile->resize(int64_t(requestCount) * requestSize));
+
+        auto completedCount = 0;
+        {
+            auto shortLived = vfs::reactor{};
+            for (auto i = 0; i < requestCount; ++i)
+            {
+                shortLived.spawn([&, i]() -> vfs::task<>
+                {
+                    auto buffer = std::vector<uint8_t>(requestSize);
+                    co_await shortLived.readAt(*spFile, int64_t(i) * requestSize, buffer.data(), buffer.size());
+                    // The first completion stops the reactor, the other requests may still be running.
+                    ++completedCount;
+                    shortLived.stop();
+                }());
+            }
+            REQUIRE(shortLived.run());
+        }
+        REQUIRE(completedCount >= 1);
+    }
+
+    SECTION("changes in a watched directory are awaited")
+    {
+        const auto root = vfs::path(test_directory + "/test/reactor/watched");
+        vfs::create_path(root);
+        auto spWatch = reactor.watch(root);
+        REQUIRE(spWatch != nullptr);
+
+        const auto filePath = vfs::path::combine(root, "file.txt");
+        auto events         = std::vector<vfs::watch_event>{};
+        reactor.spawn([&]() -> vfs::task<> { events = co_await reactor.nextEvents(*spWatch); }());
+        // Runs once the watching task is suspended.
+        reactor.spawn([&]() -> vfs::task<> { vfs::open_write_only(filePath, vfs::file_creation_options::create_or_overwrite); co_return; }());
+        REQUIRE(reactor.run());
+
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].kind == vfs::watch_event_kind::created);
+        REQUIRE(events[0].entryPath.str() == filePath.str());
+    }
+
+    SECTION("stop() returns from run() with tasks still waiting")
+    {
+        const auto pipeName = vfs::path(test_directory + "\\test\\reactor\\idle");
+        auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+
+        auto isConnected = false;
+        reactor.spawn([&]() -> vfs::task<> { isConnected = co_await reactor.accept(*spServer); }());
+        auto stopper = std::thread([&reactor]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); reactor.stop(); });
+        REQUIRE(reactor.run());
+        stopper.join();
+        REQUIRE_FALSE(isConnected);
+
+        // The next run picks up where the previous one stopped.
+        auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+        REQUIRE(reactor.run());
+        REQUIRE(isConnected);
+    }
+}
+
+TEST_CASE("Reactor throughput.", "[.][benchmark]")
+{
+    vfs::create_path(test_directory + "\\test\\reactor");
+    constexpr auto clientCount  = 200;
+    constexpr auto requestCount = 100;
+    constexpr auto requestSize  = 256;
+
+    auto reactor = vfs::reactor{};
+    auto servers = std::vector<vfs::pipe_sptr>{};
+    auto clients = std::vector<vfs::pipe_sptr>{};
+    for (auto i = 0; i < clientCount; ++i)
+    {
+        const auto pipeName = vfs::path(test_directory + "\\test\\reactor\\throughput" + std::to_string(i));
+        servers.push_back(vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex));
+        clients.push_back(vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write));
+        servers.back()->waitForConnection();
+    }
+
+    // Request and reply round trips of every client at once, on one thread.
+    BENCHMARK_ADVANCED("200 concurrent clients, 100 round trips each")(Catch::Benchmark::Chronometer meter)
+    {
+        const auto serve = [&reactor](vfs::pipe_stream &server) -> vfs::task<>
+        {
+            auto buffer = std::vector<uint8_t>(requestSize);
+            for (auto i = 0; i < requestCount; ++i)
+            {
+                co_await reactor.read(server, buffer.data(), buffer.size());
+                co_await reactor.write(server, buffer.data(), buffer.size());
+            }
+        };
+        const auto call = [&reactor](vfs::pipe_stream &client) -> vfs::task<>
+        {
+            auto buffer = std::vector<uint8_t>(requestSize, 0x5a);
+            for (auto i = 0; i < requestCount; ++i)
+            {
+                co_await reactor.write(client, buffer.data(), buffer.size());
+                co_await reactor.read(client, buffer.data(), buffer.size());
+            }
+        };
+
+        meter.measure([&]()
+        {
+            for (auto i = 0; i < clientCount; ++i)
+            {
+                reactor.spawn(serve(*servers[i]));
+                reactor.spawn(call(*clients[i]));
+            }
+            return reactor.run();
+        });
+    };
+}
+#endif
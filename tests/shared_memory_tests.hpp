@@ -69,3 +69,284 @@ TEST_CASE("Shared memory.", "[sharedmemory]")
         }
     }
 }
+
+TEST_CASE("Shared memory mapping flags.", "[sharedmemory]")
+{
+#if VFS_PLATFORM_WIN
+    const auto sharedMemoryName = "mrsFlags";
+#elif VFS_PLATFORM_POSIX
+    const auto sharedMemoryName = "/mrsFlags";
+#endif
+
+    SECTION("populated, locked and transparent huge page memory is shared like any other")
+    {
+        const auto flags = vfs::mapping_flags::populate | vfs::mapping_flags::lock | vfs::mapping_flags::transparent_huge_pages;
+        auto spSharedMemory = vfs::create_shared_memory(sharedMemoryName, text.size(), flags);
+        REQUIRE(spSharedMemory->isValid());
+        memcpy(spSharedMemory->cursor(), text.data(), text.size());
+
+        auto spOpenedMemory = vfs::open_shared_memory(sharedMemoryName, 0, vfs::mapping_flags::populate);
+        REQUIRE(spOpenedMemory->isValid());
+        REQUIRE(memcmp(spOpenedMemory->cursor(), text.data(), text.size()) == 0);
+    }
+
+    SECTION("a populated file view holds the content of the file")
+    {
+        vfs::create_path(test_directory + "\\test\\mappingflags");
+        const auto fileName = vfs::path(test_directory + "\\test\\mappingflags\\populated.txt");
+
+        auto spFileView = vfs::open_read_write_view(fileName, vfs::file_creation_options::create_or_overwrite, vfs::file_flags::none, vfs::file_attributes::normal, text.size(), vfs::mapping_flags::populate | vfs::mapping_flags::lock);
+        REQUIRE(spFileView != nullptr);
+        REQUIRE(spFileView->isValid());
+        memcpy(spFileView->cursor(), text.data(), text.size());
+        spFileView.reset();
+
+        auto spFile     = vfs::open_read_only(fileName, vfs::file_creation_options::open_if_existing);
+        auto textRead   = std::string(text.size(), '\0');
+        REQUIRE(spFile->read(textRead) == text.size());
+        REQUIRE(textRead == text);
+    }
+
+#if VFS_PLATFORM_POSIX
+    SECTION("huge page memory needs a hugetlbfs mount with free huge pages")
+    {
+        auto mounts                     = std::ifstream("/proc/mounts");
+        const auto isHugetlbfsMounted   = std::string(std::istreambuf_iterator<char>(mounts), {}).find(" hugetlbfs ") != std::string::npos;
+
+        auto spSharedMemory = vfs::create_shared_memory(sharedMemoryName, text.size(), vfs::mapping_flags::huge_pages);
+        if (spSharedMemory->isValid())
+        {
+            REQUIRE(isHugetlbfsMounted);
+            REQUIRE(spSharedMemory->totalSize() >= int64_t(2 * 1024 * 1024));
+            memcpy(spSharedMemory->cursor(), text.data(), text.size());
+
+            auto spOpenedMemory = vfs::open_shared_memory(sharedMemoryName, 0, vfs::mapping_flags::huge_pages);
+            REQUIRE(spOpenedMemory->isValid());
+            REQUIRE(memcmp(spOpenedMemory->cursor(), text.data(), text.size()) == 0);
+        }
+        else
+        {
+            // Nowhere to create it, or no huge page reserved.
+            REQUIRE(!vfs::open_shared_memory(sharedMemoryName, 0, vfs::mapping_flags::huge_pages)->isValid());
+        }
+    }
+#endif
+}
+
+TEST_CASE("Shared memory first touch.", "[.][benchmark]")
+{
+#if VFS_PLATFORM_WIN
+    const auto sharedMemoryName = "mrsBenchmark";
+#elif VFS_PLATFORM_POSIX
+    const auto sharedMemoryName = "/mrsBenchmark";
+#endif
+    constexpr auto memorySize   = int64_t(256 * 1024 * 1024);
+    constexpr auto pageSize     = int64_t(4096);
+
+    // Creates the memory and writes one byte per page.
+    const auto firstTouch = [&](vfs::mapping_flags flags)
+    {
+        auto spSharedMemory = vfs::create_shared_memory(sharedMemoryName, memorySize, flags);
+        if (!spSharedMemory->isValid())
+        {
+            return int64_t(0);
+        }
+
+        auto pData = spSharedMemory->cursor();
+        for (auto i = int64_t(0); i < memorySize; i += pageSize)
+        {
+            pData[i] = uint8_t(i);
+        }
+        return spSharedMemory->totalSize();
+    };
+
+    BENCHMARK("first touch without flags")
+    {
+        return firstTouch(vfs::mapping_flags::none);
+    };
+
+    BENCHMARK("first touch with populate")
+    {
+        return firstTouch(vfs::mapping_flags::populate);
+    };
+
+    BENCHMARK("first touch with transparent huge pages")
+    {
+        return firstTouch(vfs::mapping_flags::transparent_huge_pages);
+    };
+
+    BENCHMARK("first touch with huge pages")
+    {
+        return firstTouch(vfs::mapping_flags::huge_pages);
+    };
+
+    // Random reads over memory that is already faulted in, where the TLB reach makes the difference.
+    const auto randomAccess = [&](vfs::mapping_flags flags, Catch::Benchmark::Chronometer meter)
+    {
+        auto spSharedMemory = vfs::create_shared_memory(sharedMemoryName, memorySize, flags | vfs::mapping_flags::populate);
+        if (!spSharedMemory->isValid())
+        {
+            meter.measure([] { return 0; });
+            return;
+        }
+
+        auto pData = spSharedMemory->cursor<uint64_t>();
+        memset(pData, 1, memorySize);
+
+        meter.measure([&]
+        {
+            auto sum    = uint64_t(0);
+            auto index  = uint64_t(12345);
+            for (auto i = 0; i < 1000000; ++i)
+            {
+                index   = index * 6364136223846793005ull + 1442695040888963407ull;
+                sum     += pData[(index >> 20) % (memorySize / sizeof(uint64_t))];
+            }
+            return sum;
+        });
+    };
+
+    BENCHMARK_ADVANCED("random reads without flags")(Catch::Benchmark::Chronometer meter)
+    {
+        randomAccess(vfs::mapping_flags::none, meter);
+    };
+
+    BENCHMARK_ADVANCED("random reads with transparent huge pages")(Catch::Benchmark::Chronometer meter)
+    {
+        randomAccess(vfs::mapping_flags::transparent_huge_pages, meter);
+    };
+
+    BENCHMARK_ADVANCED("random reads with huge pages")(Catch::Benchmark::Chronometer meter)
+    {
+        randomAccess(vfs::mapping_flags::huge_pages, meter);
+    };
+}
+
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Shared memory ring.", "[sharedmemory]")
+{
+    SECTION("records of any size go through a byte ring, across its end")
+    {
+        auto spRing = vfs::create_shm_byte_ring("/mrsByteRing", 1024);
+        REQUIRE(spRing->isValid());
+        REQUIRE(spRing->capacity() == 1024);
+
+        auto spOpenedRing = vfs::open_shm_byte_ring("/mrsByteRing");
+        REQUIRE(spOpenedRing->isValid());
+        REQUIRE(spOpenedRing->capacity() == 1024);
+
+        auto record = std::vector<uint8_t>{};
+        REQUIRE(!spOpenedRing->tryRead(record));
+        REQUIRE(!spOpenedRing->read(record, std::chrono::milliseconds(1)));
+
+        // Wraps the ring several times with sizes that don't divide its capacity.
+        for (auto i = 0; i < 64; ++i)
+        {
+            const auto sizeInBytes = (i * 37) % text.size();
+            REQUIRE(spRing->tryWrite(reinterpret_cast<const uint8_t*>(text.data()), sizeInBytes));
+            REQUIRE(spOpenedRing->tryRead(record));
+            REQUIRE(record.size() == sizeInBytes);
+            REQUIRE(memcmp(record.data(), text.data(), sizeInBytes) == 0);
+        }
+
+        // Full ring.
+        auto recordCount = 0;
+        while (spRing->tryWrite(reinterpret_cast<const uint8_t*>(text.data()), 100))
+        {
+            ++recordCount;
+        }
+        REQUIRE(recordCount > 0);
+        REQUIRE(!spRing->write(reinterpret_cast<const uint8_t*>(text.data()), 100, std::chrono::milliseconds(1)));
+        REQUIRE(!spRing->tryWrite(reinterpret_cast<const uint8_t*>(text.data()), spRing->maxRecordSize() + 1));
+
+        auto consumedCount = 0;
+        while (spOpenedRing->tryConsume([](const uint8_t *pRecord, int64_t sizeInBytes)
+        {
+            REQUIRE(sizeInBytes == 100);
+            REQUIRE(memcmp(pRecord, text.data(), 100) == 0);
+        }))
+        {
+            ++consumedCount;
+        }
+        REQUIRE(consumedCount == recordCount);
+    }
+
+    SECTION("a byte ring wakes up a blocked consumer")
+    {
+        constexpr auto record_count = 10000;
+
+        auto spRing = vfs::create_shm_byte_ring("/mrsByteRing", 4096);
+        REQUIRE(spRing->isValid());
+
+        // Opened through its own mapping, as another process would.
+        auto spOpenedRing   = vfs::open_shm_byte_ring("/mrsByteRing");
+        auto mismatchCount  = 0;
+        auto consumer       = std::thread([&]
+        {
+            auto record = std::vector<uint8_t>{};
+            for (auto i = 0; i < record_count; ++i)
+            {
+                if (!spOpenedRing->read(record) || record.size() != size_t(i % 300) || memcmp(record.data(), text.data(), record.size()) != 0)
+                {
+                    ++mismatchCount;
+                }
+            }
+        });
+
+        for (auto i = 0; i < record_count; ++i)
+        {
+            REQUIRE(spRing->write(reinterpret_cast<const uint8_t*>(text.data()), i % 300));
+        }
+        consumer.join();
+        REQUIRE(mismatchCount == 0);
+    }
+
+    SECTION("elements are exchanged by several producers and consumers")
+    {
+        constexpr auto thread_count     = 2;
+        constexpr auto element_count    = 20000;
+
+        auto spRing = vfs::create_shm_ring<uint64_t>("/mrsRing", 100);
+        REQUIRE(spRing->isValid());
+        REQUIRE(spRing->capacity() == 128);
+
+        auto spOpenedRing = vfs::open_shm_ring<uint64_t>("/mrsRing");
+        REQUIRE(spOpenedRing->isValid());
+
+        auto sums       = std::vector<uint64_t>(thread_count, 0);
+        auto threads    = std::vector<std::thread>{};
+        for (auto t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([&sums, &spOpenedRing, t]
+            {
+                for (auto i = 0; i < element_count; ++i)
+                {
+                    auto value = uint64_t(0);
+                    spOpenedRing->pop(value);
+                    sums[t] += value;
+                }
+            });
+            threads.emplace_back([&spRing]
+            {
+                for (auto i = 1; i <= element_count; ++i)
+                {
+                    spRing->push(uint64_t(i));
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        auto value = uint64_t(0);
+        REQUIRE(!spRing->tryPop(value));
+        REQUIRE(sums[0] + sums[1] == uint64_t(thread_count) * element_count * (element_count + 1) / 2);
+
+        SECTION("a ring cannot be opened with another element type")
+        {
+            REQUIRE(!vfs::open_shm_ring<uint32_t>("/mrsRing")->isValid());
+        }
+    }
+}
+#endif
@@ -0,0 +1,148 @@
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Stream transfer.", "[transfer]")
+{
+    vfs::create_path(test_directory + "\\test\\transfer");
+    const auto sourceName       = vfs::path(test_directory + "\\test\\transfer\\source.bin");
+    const auto destinationName  = vfs::path(test_directory + "\\test\\transfer\\destination.bin");
+    const auto pipeName         = vfs::path(test_directory + "\\test\\transfer\\pipe");
+
+    // More than a kernel pipe holds, with a pattern that shows misplaced bytes.
+    auto content = std::vector<uint8_t>(3 * 1024 * 1024 + 17);
+    for (auto i = size_t(0); i < content.size(); ++i)
+    {
+        content[i] = uint8_t(i * 7 + i / 4096);
+    }
+    REQUIRE(vfs::open_read_write(sourceName, vfs::file_creation_options::create_or_overwrite)->write(content.data(), content.size()) == content.size());
+
+    const auto readFile = [](const vfs::path &name)
+    {
+        auto spFile = vfs::open_read_only(name, vfs::file_creation_options::open_if_existing);
+        auto data   = std::vector<uint8_t>(spFile->size());
+        spFile->read(data.data(), data.size());
+        return data;
+    };
+
+    auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+    auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+    REQUIRE(spServer->waitForConnection());
+
+    SECTION("from a file to a file")
+    {
+        auto spSource       = vfs::open_read_only(sourceName, vfs::file_creation_options::open_if_existing);
+        auto spDestination  = vfs::open_read_write(destinationName, vfs::file_creation_options::create_or_overwrite);
+
+        // The transfer stops at the end of the source.
+        REQUIRE(vfs::transfer(spSource, spDestination, content.size() * 2) == int64_t(content.size()));
+        spDestination.reset();
+        REQUIRE(readFile(destinationName) == content);
+    }
+
+    SECTION("from a file to a pipe and back")
+    {
+        auto spSource   = vfs::open_read_only(sourceName, vfs::file_creation_options::open_if_existing);
+        auto received   = std::vector<uint8_t>(content.size());
+        auto reader     = std::thread([&spServer, &received]() { spServer->read(received.data(), received.size()); });
+        REQUIRE(vfs::transfer(spSource, spClient, content.size()) == int64_t(content.size()));
+        reader.join();
+        REQUIRE(received == content);
+
+        auto spDestination  = vfs::open_read_write(destinationName, vfs::file_creation_options::create_or_overwrite);
+        auto writer         = std::thread([&spServer, &content]() { spServer->write(content.data(), content.size()); });
+        REQUIRE(vfs::transfer(spClient, spDestination, content.size()) == int64_t(content.size()));
+        writer.join();
+        spDestination.reset();
+        REQUIRE(readFile(destinationName) == content);
+    }
+
+    SECTION("bytes received by message reads are transferred first")
+    {
+        const auto message = std::string("header");
+        REQUIRE(spClient->writeMessage(reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+        REQUIRE(spClient->write(content.data(), 1000) == 1000);
+
+        auto received = std::string(16, '\0');
+        REQUIRE(spServer->readMessage(reinterpret_cast<uint8_t*>(received.data()), received.size()) == int64_t(message.size()));
+        REQUIRE(spServer->bufferedBytesToRead() == 1000);
+
+        auto spDestination = vfs::open_read_write(destinationName, vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(vfs::transfer(spServer, spDestination, 1000) == 1000);
+        REQUIRE(spServer->bufferedBytesToRead() == 0);
+        spDestination.reset();
+        REQUIRE(readFile(destinationName) == std::vector<uint8_t>(content.begin(), content.begin() + 1000));
+    }
+
+    SECTION("destinations splice() cannot write to get the data through the buffer")
+    {
+        // Files opened with O_APPEND refuse splice(), what is already in the kernel pipe is copied.
+        auto spSource   = vfs::open_read_only(sourceName, vfs::file_creation_options::open_if_existing);
+        const auto fd   = ::open(destinationName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        REQUIRE(fd != -1);
+
+        auto buffer         = std::vector<uint8_t>(4096);
+        auto isSupported    = true;
+        const auto bytesMoved = vfs::posix_transfer::splice(spSource->nativeHandle(), fd, content.size(), isSupported, buffer.data(), buffer.size());
+        ::close(fd);
+        REQUIRE_FALSE(isSupported);
+
+        // Only the first chunk went through the pipe, the rest is left to the caller.
+        REQUIRE(bytesMoved > 0);
+        const auto written = readFile(destinationName);
+        REQUIRE(int64_t(written.size()) == bytesMoved);
+        REQUIRE(std::equal(written.begin(), written.end(), content.begin()));
+    }
+
+    SECTION("other streams are copied")
+    {
+        auto spSource       = vfs::open_read_only_view(sourceName, vfs::file_creation_options::open_if_existing);
+        auto spDestination  = vfs::open_read_write(destinationName, vfs::file_creation_options::create_or_overwrite);
+        REQUIRE(vfs::transfer(spSource, spDestination, content.size()) == int64_t(content.size()));
+        spDestination.reset();
+        REQUIRE(readFile(destinationName) == content);
+    }
+}
+
+TEST_CASE("Stream transfer throughput.", "[.][benchmark]")
+{
+    vfs::create_path(test_directory + "\\test\\transfer");
+    const auto sourceName   = vfs::path(test_directory + "\\test\\transfer\\throughput.bin");
+    const auto pipeName     = vfs::path(test_directory + "\\test\\transfer\\throughput");
+
+    constexpr auto size = int64_t(64 * 1024 * 1024);
+    const auto content  = std::vector<uint8_t>(size, 0x5a);
+    vfs::open_read_write(sourceName, vfs::file_creation_options::create_or_overwrite)->write(content.data(), content.size());
+
+    auto spServer = vfs::create_named_pipe(pipeName, vfs::pipe_access::duplex);
+    auto spClient = vfs::connect_to_named_pipe(pipeName, vfs::file_access::read_write);
+    spServer->waitForConnection();
+
+    // Ships a file to a pipe, the other end drains it the same way in both cases.
+    const auto measure = [&](Catch::Benchmark::Chronometer &meter, const auto &move)
+    {
+        meter.measure([&]()
+        {
+            auto spSource   = vfs::open_read_only(sourceName, vfs::file_creation_options::open_if_existing);
+            auto reader     = std::thread([&spServer]()
+            {
+                auto buffer = std::vector<uint8_t>(1024 * 1024);
+                for (auto received = int64_t(0); received < size; received += int64_t(buffer.size()))
+                {
+                    spServer->read(buffer.data(), buffer.size());
+                }
+            });
+            const auto bytesMoved = move(*spSource, *spClient);
+            reader.join();
+            return bytesMoved;
+        });
+    };
+
+    BENCHMARK_ADVANCED("read() and write() through a buffer")(Catch::Benchmark::Chronometer meter)
+    {
+        measure(meter, [](vfs::file_stream &source, vfs::pipe_stream &destination) { return vfs::buffered_transfer(source, destination, size); });
+    };
+
+    BENCHMARK_ADVANCED("transfer()")(Catch::Benchmark::Chronometer meter)
+    {
+        measure(meter, [](vfs::file_stream &source, vfs::pipe_stream &destination) { return vfs::transfer(source, destination, size); });
+    };
+}
+#endif
@@ -3,11 +3,17 @@
 
 #include <filesystem>
 #include <fstream>
+#include <thread>
 #include <unordered_set>
 
 #include "vfs.hpp"
+#include "vfs/virtual_array.hpp"
 #include "vfs/logging.hpp"
 
+#if VFS_PLATFORM_POSIX
+#   include <sys/resource.h>
+#endif
+
 // Change test working directory here (without a trailing slash).
 // Make sure to ONLY use the directory separator / and not \\. More information in clean up test case below.
 const std::string test_directory = ".";
@@ -40,8 +46,16 @@ TEST_CASE("Setup.", "[cleanup]")
 
 #include "move_tests.hpp"
 
+#include "pipe_tests.hpp"
+
+#include "reactor_tests.hpp"
+
 #include "shared_memory_tests.hpp"
 
+#include "transfer_tests.hpp"
+
+#include "virtual_array_tests.hpp"
+
 #include "watcher_tests.hpp"
 
 TEST_CASE("Teardown.", "[cleanup]")
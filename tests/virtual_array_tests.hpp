@@ -0,0 +1,597 @@
+TEST_CASE("Virtual array.", "[virtualarray]")
+{
+    struct element
+    {
+        uint32_t owner;
+        uint32_t value;
+    };
+    using array_type = vfs::virtual_array<element, 1u << 20>;
+
+    SECTION("we can add, access and remove elements")
+    {
+        auto arr = array_type();
+        const auto first    = arr.emplace(element{ 0, 1 });
+        const auto second   = arr.emplace(element{ 0, 2 });
+        REQUIRE(first != second);
+        REQUIRE(arr.size() == 2);
+        REQUIRE(arr[first].value == 1);
+        REQUIRE(arr[second].value == 2);
+
+        arr.remove(first);
+        REQUIRE(arr.size() == 1);
+        REQUIRE_FALSE(arr.isIndexValid(first));
+        REQUIRE(arr.isIndexValid(second));
+
+        // The slot freed by this thread is reused first.
+        REQUIRE(arr.emplace(element{ 0, 3 }) == first);
+        REQUIRE(arr[first].value == 3);
+    }
+
+    SECTION("handles detect the reuse of their slot")
+    {
+        auto arr = array_type();
+        const auto first = arr.emplaceHandle(element{ 0, 1 });
+        REQUIRE(arr.isHandleValid(first));
+        REQUIRE(arr.get(first) == &arr[first.index]);
+        REQUIRE(arr.get(first)->value == 1);
+        REQUIRE(arr.makeHandle(first.index) == first);
+
+        REQUIRE(arr.remove(first));
+        REQUIRE_FALSE(arr.isHandleValid(first));
+        REQUIRE(arr.get(first) == nullptr);
+        REQUIRE_FALSE(arr.remove(first));
+
+        // The slot is reused but the stale handle does not see the new element.
+        const auto second = arr.emplaceHandle(element{ 0, 2 });
+        REQUIRE(second.index == first.index);
+        REQUIRE(second.generation != first.generation);
+        REQUIRE(arr.get(first) == nullptr);
+        REQUIRE(arr.get(second)->value == 2);
+
+        // Removing by index makes the handles stale too.
+        arr.remove(second.index);
+        REQUIRE(arr.get(second) == nullptr);
+
+        REQUIRE_FALSE(arr.isHandleValid(array_type::handle{}));
+        REQUIRE(arr.size() == 0);
+    }
+
+    SECTION("a handle is removed only once by concurrent threads")
+    {
+        auto arr = array_type();
+        auto handles = std::vector<array_type::handle>{};
+        for (auto i = 0u; i < 10000; ++i)
+        {
+            handles.push_back(arr.emplaceHandle(element{ 0, i }));
+        }
+
+        auto removedCount = std::atomic<uint32_t>(0);
+        auto threads = std::vector<std::thread>();
+        for (auto t = 0u; t < 4; ++t)
+        {
+            threads.emplace_back([&arr, &handles, &removedCount]()
+            {
+                for (const auto &h : handles)
+                {
+                    if (arr.remove(h))
+                    {
+                        ++removedCount;
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(removedCount == handles.size());
+        REQUIRE(arr.size() == 0);
+    }
+
+    SECTION("we can grow over many pages")
+    {
+        auto arr = array_type();
+        constexpr auto elementCount = 100000u;
+        for (auto i = 0u; i < elementCount; ++i)
+        {
+            REQUIRE(arr.emplace(element{ 0, i }) == i);
+        }
+        REQUIRE(arr.size() == elementCount);
+
+        auto sum = uint64_t(0);
+        for (const auto &e : arr)
+        {
+            sum += e.value;
+        }
+        REQUIRE(sum == uint64_t(elementCount) * (elementCount - 1) / 2);
+    }
+
+    SECTION("we can give back the pages past the last element")
+    {
+        auto arr = array_type();
+        auto handles = std::vector<array_type::handle>{};
+        for (auto i = 0u; i < 100000; ++i)
+        {
+            handles.push_back(arr.emplaceHandle(element{ 0, i }));
+        }
+        const auto committedPageCount = arr.getCommittedPageCount();
+
+        // Keep a few elements at the start, with holes.
+        for (auto i = 0u; i < handles.size(); ++i)
+        {
+            if (i >= 1000 || i % 2 == 0)
+            {
+                arr.remove(handles[i]);
+            }
+        }
+        REQUIRE(arr.size() == 500);
+
+        const auto releasedPageCount = arr.shrinkToFit();
+        REQUIRE(releasedPageCount > 0);
+        REQUIRE(arr.getCommittedPageCount() == committedPageCount - releasedPageCount);
+        REQUIRE(arr.getLastValidIndex() == 1000);
+        REQUIRE(arr.shrinkToFit() == 0);
+
+        auto sum = uint64_t(0);
+        for (const auto &e : arr)
+        {
+            sum += e.value;
+        }
+        REQUIRE(sum == 500u * 500u);
+
+        // The holes are reused first, then the array grows again without reviving old handles.
+        for (auto i = 0u; i < 500; ++i)
+        {
+            REQUIRE(arr.emplace(element{ 1, i }) == 2 * i);
+        }
+        const auto grownIndex = arr.emplace(element{ 1, 500 });
+        REQUIRE(grownIndex == 1000);
+        for (auto i = 0u; i < 50000; ++i)
+        {
+            arr.emplace(element{ 1, i });
+        }
+        REQUIRE(arr.get(handles[1001]) == nullptr);
+        REQUIRE(arr.get(handles[5000]) == nullptr);
+        REQUIRE(arr.get(handles[1])->value == 1);
+    }
+
+    SECTION("threads can add and remove elements concurrently")
+    {
+        auto arr = array_type();
+        constexpr auto threadCount      = 16u;
+        constexpr auto iterationCount   = 20000u;
+        constexpr auto keptCount        = 1000u;
+
+        auto mismatchCount = std::atomic<uint32_t>(0);
+        auto threads = std::vector<std::thread>();
+        for (auto t = 0u; t < threadCount; ++t)
+        {
+            threads.emplace_back([&arr, &mismatchCount, t]()
+            {
+                auto indices = std::vector<uint32_t>();
+                for (auto i = 0u; i < iterationCount; ++i)
+                {
+                    indices.push_back(arr.emplace(element{ t, i }));
+                    // Remove every other element right away, and the others in reverse order
+                    // from another thread's shard once the loop is over.
+                    if (i % 2 == 0)
+                    {
+                        const auto index = indices.back();
+                        indices.pop_back();
+                        if (arr[index].owner != t || arr[index].value != i)
+                        {
+                            ++mismatchCount;
+                        }
+                        arr.remove(index);
+                    }
+                }
+                for (auto i = 0u; i < indices.size(); ++i)
+                {
+                    const auto &e = arr[indices[i]];
+                    if (e.owner != t || e.value != 2 * i + 1)
+                    {
+                        ++mismatchCount;
+                    }
+                }
+                while (indices.size() > keptCount)
+                {
+                    arr.remove(indices.back());
+                    indices.pop_back();
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(mismatchCount == 0);
+        REQUIRE(arr.size() == threadCount * keptCount);
+
+        // Every live element is reached exactly once by the iteration.
+        auto seen = std::vector<uint32_t>(threadCount, 0);
+        for (const auto &e : arr)
+        {
+            ++seen[e.owner];
+        }
+        for (auto count : seen)
+        {
+            REQUIRE(count == keptCount);
+        }
+
+        // Slots freed by the other threads are reused before growing.
+        const auto lastValidIndex = arr.getLastValidIndex();
+        for (auto i = 0u; i < iterationCount; ++i)
+        {
+            arr.emplace(element{ 0, i });
+        }
+        REQUIRE(arr.getLastValidIndex() == lastValidIndex);
+    }
+}
+
+TEST_CASE("Virtual allocator.", "[virtualarray]")
+{
+    constexpr auto size = int64_t(16 * 4096);
+    auto pData = reinterpret_cast<uint8_t*>(vfs::virtual_allocator::reserve(size));
+    REQUIRE(pData != nullptr);
+    REQUIRE(vfs::virtual_allocator::commit(pData, size) == pData);
+    memset(pData, 0xab, size);
+
+    // Decommitted pages come back zeroed.
+    REQUIRE(vfs::virtual_allocator::decommit(pData + size / 2, size / 2));
+    REQUIRE(vfs::virtual_allocator::commit(pData + size / 2, size / 2) == pData + size / 2);
+    REQUIRE(pData[size / 2 - 1] == 0xab);
+    REQUIRE(pData[size / 2] == 0);
+    REQUIRE(pData[size - 1] == 0);
+
+    REQUIRE(vfs::virtual_allocator::deallocate(pData, size));
+}
+
+TEST_CASE("NUMA placement.", "[virtualarray]")
+{
+    const auto nodeCount = vfs::virtual_allocator::numaNodeCount();
+    REQUIRE(nodeCount >= 1);
+    REQUIRE(vfs::virtual_allocator::currentNumaNode() >= 0);
+    REQUIRE(vfs::virtual_allocator::currentNumaNode() < nodeCount);
+
+    SECTION("we can commit memory with a NUMA policy")
+    {
+        constexpr auto size = int64_t(4 * 4096);
+        for (auto placement : { vfs::numa_placement{ vfs::numa_policy::local },
+                                vfs::numa_placement{ vfs::numa_policy::interleave },
+                                vfs::numa_placement{ vfs::numa_policy::bind, nodeCount - 1 } })
+        {
+            auto pData = reinterpret_cast<uint8_t*>(vfs::virtual_allocator::reserve(size));
+            REQUIRE(pData != nullptr);
+            REQUIRE(vfs::virtual_allocator::commit(pData, size, placement) == pData);
+            memset(pData, 0xab, size);
+            REQUIRE(pData[size - 1] == 0xab);
+
+#if VFS_PLATFORM_POSIX
+            auto mode = -1;
+            REQUIRE(syscall(SYS_get_mempolicy, &mode, nullptr, 0, pData, MPOL_F_ADDR) == 0);
+            switch (placement.policy)
+            {
+            case vfs::numa_policy::local:       REQUIRE(mode == MPOL_LOCAL);        break;
+            case vfs::numa_policy::interleave:  REQUIRE(mode == MPOL_INTERLEAVE);   break;
+            case vfs::numa_policy::bind:        REQUIRE(mode == MPOL_BIND);         break;
+            }
+#endif
+
+            REQUIRE(vfs::virtual_allocator::deallocate(pData, size));
+        }
+    }
+
+    SECTION("we can have one virtual array per node")
+    {
+        auto arrays = vfs::numa_virtual_array<uint64_t, 1u << 20>();
+        REQUIRE(arrays.nodeCount() == nodeCount);
+
+        for (auto node = 0; node < arrays.nodeCount(); ++node)
+        {
+            for (auto i = 0u; i < 10000; ++i)
+            {
+                arrays.node(node).emplace(uint64_t(node));
+            }
+            REQUIRE(arrays.node(node).size() == 10000);
+        }
+
+        const auto index = arrays.local().emplace(uint64_t(42));
+        REQUIRE(arrays.local()[index] == 42);
+    }
+}
+
+TEST_CASE("Virtual array iteration.", "[virtualarray]")
+{
+    using array_type = vfs::virtual_array<uint64_t, 1u << 20>;
+
+    // Keep one element out of every 100, with gaps longer than a control register word.
+    constexpr auto elementCount = 100000u;
+    auto arr = array_type();
+    for (auto i = 0u; i < elementCount; ++i)
+    {
+        arr.emplace(uint64_t(i));
+    }
+    auto expectedSum = uint64_t(0);
+    for (auto i = 0u; i < elementCount; ++i)
+    {
+        if (i % 100 == 7)
+        {
+            expectedSum += i;
+        }
+        else
+        {
+            arr.remove(i);
+        }
+    }
+
+    SECTION("iterators skip the empty slots")
+    {
+        auto sum = uint64_t(0);
+        auto count = 0u;
+        for (auto it = arr.begin(); it != arr.end(); ++it)
+        {
+            REQUIRE(it.index() % 100 == 7);
+            REQUIRE(*it == it.index());
+            sum += *it;
+            ++count;
+        }
+        REQUIRE(count == elementCount / 100);
+        REQUIRE(sum == expectedSum);
+    }
+
+    SECTION("iteration ends when the array grows in between begin() and end()")
+    {
+        auto grown = array_type();
+        for (auto i = 0u; i < 10; ++i)
+        {
+            grown.emplace(uint64_t(i));
+        }
+
+        auto it = grown.begin();
+        const auto lastIndex = grown.getLastValidIndex();
+        for (auto i = 0u; i < 100; ++i)
+        {
+            grown.emplace(uint64_t(i));
+        }
+        REQUIRE(grown.getLastValidIndex() > lastIndex);
+
+        // Elements added after begin() may or may not be visited, the loop must end either way.
+        auto count = 0u;
+        for (; it != grown.end() && count <= 110; ++it)
+        {
+            ++count;
+        }
+        REQUIRE(it == grown.end());
+        REQUIRE(count == lastIndex);
+    }
+
+    SECTION("we can iterate over a range of indices")
+    {
+        auto indices = std::vector<uint32_t>{};
+        const auto &constArr = arr;
+        for (auto it = constArr.range(150, 407).begin(); it != constArr.range(150, 407).end(); ++it)
+        {
+            indices.push_back(it.index());
+        }
+        REQUIRE(indices == std::vector<uint32_t>{ 207, 307 });
+
+        auto count = 0u;
+        for (auto &element : arr.range(0, 1000000000))
+        {
+            element += 1;
+            ++count;
+        }
+        REQUIRE(count == elementCount / 100);
+        REQUIRE(arr[7] == 8);
+
+        REQUIRE(arr.range(507, 507).begin() == arr.range(507, 507).end());
+    }
+
+    SECTION("we can visit the elements of a range")
+    {
+        auto indices = std::vector<uint32_t>{};
+        arr.for_each([&indices](uint64_t &element, uint32_t index)
+        {
+            REQUIRE(element == index);
+            indices.push_back(index);
+        }, 7, 208);
+        REQUIRE(indices == std::vector<uint32_t>{ 7, 107, 207 });
+
+        auto sum = uint64_t(0);
+        arr.for_each([&sum](uint64_t &element) { sum += element; });
+        REQUIRE(sum == expectedSum);
+    }
+
+    SECTION("threads can visit all the elements")
+    {
+        for (auto threadCount : { 0, 1, 3, 64 })
+        {
+            auto sum            = std::atomic<uint64_t>(0);
+            auto count          = std::atomic<uint32_t>(0);
+            auto threadIds      = std::vector<std::thread::id>{};
+            auto threadIdsMutex = std::mutex{};
+            arr.parallel_for_each([&](uint64_t &element, uint32_t index)
+            {
+                if (element == index)
+                {
+                    sum += element;
+                }
+                ++count;
+
+                auto lock = std::lock_guard<std::mutex>(threadIdsMutex);
+                if (std::find(threadIds.begin(), threadIds.end(), std::this_thread::get_id()) == threadIds.end())
+                {
+                    threadIds.push_back(std::this_thread::get_id());
+                }
+            }, threadCount);
+
+            REQUIRE(count == elementCount / 100);
+            REQUIRE(sum == expectedSum);
+            if (threadCount > 0)
+            {
+                REQUIRE(threadIds.size() <= size_t(threadCount));
+            }
+        }
+    }
+
+    SECTION("we can visit an empty array")
+    {
+        auto empty = array_type();
+        auto count = 0u;
+        empty.parallel_for_each([&count](uint64_t &) { ++count; }, 4);
+        for ([[maybe_unused]] auto &element : empty)
+        {
+            ++count;
+        }
+        REQUIRE(count == 0);
+    }
+}
+
+TEST_CASE("Virtual array sweep.", "[.][benchmark]")
+{
+    // One live element out of 64, spread over 4 million slots.
+    using array_type = vfs::virtual_array<uint64_t, 1u << 22>;
+    auto arr = array_type();
+    for (auto i = 0u; i < (1u << 22); ++i)
+    {
+        arr.emplace(uint64_t(i));
+    }
+    for (auto i = 0u; i < (1u << 22); ++i)
+    {
+        if (i % 64 != 0)
+        {
+            arr.remove(i);
+        }
+    }
+
+    BENCHMARK("iterators")
+    {
+        auto sum = uint64_t(0);
+        for (auto element : arr)
+        {
+            sum += element;
+        }
+        return sum;
+    };
+
+    BENCHMARK("for_each")
+    {
+        auto sum = uint64_t(0);
+        arr.for_each([&sum](uint64_t &element) { sum += element; });
+        return sum;
+    };
+
+    BENCHMARK("parallel_for_each")
+    {
+        auto sum = std::atomic<uint64_t>(0);
+        arr.parallel_for_each([&sum](uint64_t &element) { sum.fetch_add(element, std::memory_order_relaxed); });
+        return sum.load();
+    };
+}
+
+TEST_CASE("NUMA access throughput.", "[.][benchmark]")
+{
+    // Sums a buffer bound to each node from the current thread, then one interleaved over all nodes.
+    constexpr auto size         = int64_t(64) << 20;
+    const auto nodeCount        = vfs::virtual_allocator::numaNodeCount();
+    const auto currentNode      = vfs::virtual_allocator::currentNumaNode();
+
+    const auto sumBuffer = [](vfs::numa_placement placement, Catch::Benchmark::Chronometer &meter)
+    {
+        auto pData = reinterpret_cast<uint64_t*>(vfs::virtual_allocator::reserve(size));
+        vfs::virtual_allocator::commit(pData, size, placement);
+        for (auto i = 0u; i < size / sizeof(uint64_t); ++i)
+        {
+            pData[i] = i;
+        }
+
+        meter.measure([pData]()
+        {
+            auto sum = uint64_t(0);
+            for (auto i = 0u; i < size / sizeof(uint64_t); ++i)
+            {
+                sum += pData[i];
+            }
+            return sum;
+        });
+
+        vfs::virtual_allocator::deallocate(pData, size);
+    };
+
+    for (auto node = 0; node < nodeCount; ++node)
+    {
+        const auto name = "64MB bound to node " + std::to_string(node) + (node == currentNode ? " (local)" : " (remote)");
+        BENCHMARK_ADVANCED(name.c_str())(Catch::Benchmark::Chronometer meter)
+        {
+            sumBuffer(vfs::numa_placement{ vfs::numa_policy::bind, node }, meter);
+        };
+    }
+
+    BENCHMARK_ADVANCED("64MB interleaved")(Catch::Benchmark::Chronometer meter)
+    {
+        sumBuffer(vfs::numa_placement{ vfs::numa_policy::interleave }, meter);
+    };
+}
+
+TEST_CASE("Virtual array emplace/remove.", "[.][benchmark]")
+{
+    using array_type = vfs::virtual_array<uint64_t, 1u << 24>;
+    constexpr auto operationCount = 1u << 16;
+
+    // Each thread keeps a small working set alive while adding and removing elements.
+    const auto churn = [](uint32_t threadCount, Catch::Benchmark::Chronometer &meter)
+    {
+        auto arr = array_type();
+        meter.measure([&arr, threadCount]()
+        {
+            auto threads = std::vector<std::thread>();
+            for (auto t = 0u; t < threadCount; ++t)
+            {
+                threads.emplace_back([&arr, threadCount]()
+                {
+                    uint32_t indices[16];
+                    for (auto i = 0u; i < operationCount / threadCount; ++i)
+                    {
+                        auto &index = indices[i % 16];
+                        if (i >= 16)
+                        {
+                            arr.remove(index);
+                        }
+                        index = arr.emplace(uint64_t(i));
+                    }
+                    for (auto i = 0u; i < std::min(16u, operationCount / threadCount); ++i)
+                    {
+                        arr.remove(indices[i]);
+                    }
+                });
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+            return arr.size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("1 thread")(Catch::Benchmark::Chronometer meter)
+    {
+        churn(1, meter);
+    };
+
+    BENCHMARK_ADVANCED("4 threads")(Catch::Benchmark::Chronometer meter)
+    {
+        churn(4, meter);
+    };
+
+    BENCHMARK_ADVANCED("16 threads")(Catch::Benchmark::Chronometer meter)
+    {
+        churn(16, meter);
+    };
+
+    BENCHMARK_ADVANCED("64 threads")(Catch::Benchmark::Chronometer meter)
+    {
+        churn(64, meter);
+    };
+}
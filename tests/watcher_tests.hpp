@@ -64,3 +64,235 @@ TEST_CASE("Watcher.", "[watcher]")
         REQUIRE(isValid);
     }
 }
+
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Recursive watcher.", "[watcher]")
+{
+    using namespace std::chrono_literals;
+
+    const auto root = vfs::path(test_directory + "/test/recursivewatcher");
+    vfs::create_path(vfs::path::combine(root, "a"));
+
+    auto mutex  = std::mutex{};
+    auto events = std::vector<vfs::watch_event>{};
+    auto batchCount = 0;
+
+    auto watcher = vfs::recursive_watcher(root, 100ms, [&](const std::vector<vfs::watch_event> &batch)
+    {
+        const auto lock = std::lock_guard<std::mutex>(mutex);
+        events.insert(events.end(), batch.begin(), batch.end());
+        ++batchCount;
+    });
+    REQUIRE(watcher.startWatching(true, true));
+
+    const auto countEvents = [&](vfs::watch_event_kind kind, const vfs::path &entryPath)
+    {
+        const auto lock = std::lock_guard<std::mutex>(mutex);
+        return std::count_if(events.begin(), events.end(), [&](const vfs::watch_event &event)
+        {
+            return event.kind == kind && event.entryPath.str() == entryPath.str();
+        });
+    };
+
+    SECTION("events carry the path and kind and bursts are coalesced")
+    {
+        const auto filePath = vfs::path::combine(root, "a\\file.txt");
+        {
+            auto spFile = vfs::open_write_only(filePath, vfs::file_creation_options::create_or_overwrite);
+            for (auto i = 0; i < 10; ++i)
+            {
+                spFile->write(text);
+            }
+        }
+        std::this_thread::sleep_for(400ms);
+
+        REQUIRE(countEvents(vfs::watch_event_kind::created, filePath) == 1);
+        // The writes happened in the same window as the creation.
+        REQUIRE(countEvents(vfs::watch_event_kind::modified, filePath) == 0);
+        REQUIRE(batchCount == 1);
+
+        vfs::file::delete_file(filePath);
+        std::this_thread::sleep_for(400ms);
+        REQUIRE(countEvents(vfs::watch_event_kind::deleted, filePath) == 1);
+    }
+
+    SECTION("new subdirectories are watched")
+    {
+        vfs::create_path(vfs::path::combine(root, "a\\b\\c"));
+        std::this_thread::sleep_for(50ms);
+        const auto filePath = vfs::path::combine(root, "a\\b\\c\\file.txt");
+        vfs::open_write_only(filePath, vfs::file_creation_options::create_or_overwrite);
+        std::this_thread::sleep_for(400ms);
+
+        REQUIRE(countEvents(vfs::watch_event_kind::created, vfs::path::combine(root, "a\\b")) == 1);
+        REQUIRE(countEvents(vfs::watch_event_kind::created, vfs::path::combine(root, "a\\b\\c")) == 1);
+        REQUIRE(countEvents(vfs::watch_event_kind::created, filePath) == 1);
+    }
+
+    SECTION("both halves of a move are paired")
+    {
+        const auto srcPath = vfs::path::combine(root, "a\\src.txt");
+        const auto dstPath = vfs::path::combine(root, "dst.txt");
+        vfs::open_write_only(srcPath, vfs::file_creation_options::create_or_overwrite);
+        std::this_thread::sleep_for(400ms);
+
+        REQUIRE(vfs::file::move(srcPath, dstPath));
+        std::this_thread::sleep_for(400ms);
+
+        const auto lock = std::lock_guard<std::mutex>(mutex);
+        const auto it = std::find_if(events.begin(), events.end(), [](const vfs::watch_event &event)
+        {
+            return event.kind == vfs::watch_event_kind::moved;
+        });
+        REQUIRE(it != events.end());
+        REQUIRE(it->entryPath.str() == dstPath.str());
+        REQUIRE(it->previousPath.str() == srcPath.str());
+        REQUIRE(it->cookie != 0);
+    }
+
+    SECTION("moved directories keep reporting with their new path")
+    {
+        vfs::create_path(vfs::path::combine(root, "a\\old"));
+        std::this_thread::sleep_for(400ms);
+        REQUIRE(vfs::directory::exists(vfs::path::combine(root, "a\\old")));
+
+        REQUIRE(vfs::file::move(vfs::path::combine(root, "a\\old"), vfs::path::combine(root, "new")));
+        std::this_thread::sleep_for(50ms);
+        const auto filePath = vfs::path::combine(root, "new\\file.txt");
+        vfs::open_write_only(filePath, vfs::file_creation_options::create_or_overwrite);
+        std::this_thread::sleep_for(400ms);
+
+        REQUIRE(countEvents(vfs::watch_event_kind::created, filePath) == 1);
+    }
+
+    watcher.stopWatching();
+    watcher.wait();
+    std::filesystem::remove_all(root.str());
+}
+#endif
+
+#if VFS_PLATFORM_POSIX
+TEST_CASE("Watcher hub.", "[watcher]")
+{
+    using namespace std::chrono_literals;
+
+    constexpr auto directoryCount = 64;
+    const auto root = vfs::path(test_directory + "/test/watcherhub");
+
+    auto directories = std::vector<vfs::path>{};
+    for (auto i = 0; i < directoryCount; ++i)
+    {
+        directories.emplace_back(vfs::path::combine(root, "dir" + std::to_string(i)));
+        vfs::create_path(directories.back());
+    }
+
+    auto executedTaskCount = std::atomic<int32_t>(0);
+    auto hub = vfs::watcher_hub([&executedTaskCount](vfs::watcher_hub::task_t &&task)
+    {
+        ++executedTaskCount;
+        task();
+    });
+    REQUIRE(hub.start());
+
+    SECTION("one thread serves many directories")
+    {
+        auto callCounts = std::vector<std::atomic<int32_t>>(directoryCount);
+        auto ids = std::vector<vfs::watcher_hub::watch_id>{};
+        for (auto i = 0; i < directoryCount; ++i)
+        {
+            ids.push_back(hub.addWatch(directories[i], true, true, [&callCounts, i](const vfs::path &)
+            {
+                ++callCounts[i];
+            }));
+            REQUIRE(ids.back() != vfs::watcher_hub::invalid_watch_id);
+        }
+        REQUIRE(hub.watchCount() == directoryCount);
+
+        // Initial call, like vfs::watcher.
+        std::this_thread::sleep_for(200ms);
+        for (auto i = 0; i < directoryCount; ++i)
+        {
+            REQUIRE(callCounts[i] == 1);
+        }
+
+        for (auto i = 0; i < directoryCount; i += 2)
+        {
+            vfs::open_write_only(vfs::path::combine(directories[i], "file.txt"), vfs::file_creation_options::create_or_overwrite);
+        }
+        std::this_thread::sleep_for(200ms);
+
+        for (auto i = 0; i < directoryCount; ++i)
+        {
+            REQUIRE(callCounts[i] == ((i % 2) == 0 ? 2 : 1));
+        }
+        REQUIRE(executedTaskCount >= directoryCount + directoryCount / 2);
+
+        // Removed watches are not called anymore.
+        REQUIRE(hub.removeWatch(ids[0]));
+        REQUIRE(!hub.removeWatch(ids[0]));
+        vfs::create_path(vfs::path::combine(directories[0], "subdir"));
+        std::this_thread::sleep_for(200ms);
+        REQUIRE(callCounts[0] == 2);
+    }
+
+    SECTION("timeouts and wake ups are handled by the same loop")
+    {
+        auto tickCount  = std::atomic<int32_t>(0);
+        auto wakeCount  = std::atomic<int32_t>(0);
+        hub.addWatch(directories[0], true, true, [&tickCount](const vfs::path &) { ++tickCount; }, 50ms);
+        const auto id = hub.addWatch(directories[1], true, true, [&wakeCount](const vfs::path &) { ++wakeCount; });
+
+        std::this_thread::sleep_for(500ms);
+        REQUIRE(tickCount >= 4);
+
+        REQUIRE(wakeCount == 1);
+        hub.wakeUp(id);
+        std::this_thread::sleep_for(100ms);
+        REQUIRE(wakeCount == 2);
+    }
+
+    SECTION("watches of a deleted directory can be removed")
+    {
+        const auto dir = vfs::path::combine(root, "deleted");
+        vfs::create_path(dir);
+        const auto deletedId = hub.addWatch(dir, true, true, [](const vfs::path &) {});
+        std::this_thread::sleep_for(100ms);
+        std::filesystem::remove_all(dir.str());
+        std::this_thread::sleep_for(100ms);
+
+        // The new watch of the same path must survive the removal of the old one.
+        vfs::create_path(dir);
+        auto callCount = std::atomic<int32_t>(0);
+        REQUIRE(hub.addWatch(dir, true, true, [&callCount](const vfs::path &) { ++callCount; }) != vfs::watcher_hub::invalid_watch_id);
+        REQUIRE(hub.removeWatch(deletedId));
+        std::this_thread::sleep_for(100ms);
+        vfs::open_write_only(vfs::path::combine(dir, "file.txt"), vfs::file_creation_options::create_or_overwrite);
+        std::this_thread::sleep_for(200ms);
+        REQUIRE(callCount == 2);
+    }
+
+    SECTION("recursive watches share the loop")
+    {
+        auto mutex  = std::mutex{};
+        auto events = std::vector<vfs::watch_event>{};
+        REQUIRE(hub.addRecursiveWatch(root, true, true, [&](const std::vector<vfs::watch_event> &batch)
+        {
+            const auto lock = std::lock_guard<std::mutex>(mutex);
+            events.insert(events.end(), batch.begin(), batch.end());
+        }, 50ms) != vfs::watcher_hub::invalid_watch_id);
+
+        const auto filePath = vfs::path::combine(directories[3], "file.txt");
+        vfs::open_write_only(filePath, vfs::file_creation_options::create_or_overwrite);
+        std::this_thread::sleep_for(300ms);
+
+        const auto lock = std::lock_guard<std::mutex>(mutex);
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].kind == vfs::watch_event_kind::created);
+        REQUIRE(events[0].entryPath.str() == filePath.str());
+    }
+
+    hub.stop();
+    hub.wait();
+    std::filesystem::remove_all(root.str());
+}
+#endif